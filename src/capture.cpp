@@ -11,6 +11,7 @@
 #include <stdexcept>
 #include <system_error>
 #include <string>
+#include <chrono>
 
 #include <string.h>
 #include <errno.h>
@@ -136,7 +137,7 @@ void VideoCapture::enumerateMenu(__u32 id, __u32 min_i, __u32 max_i){
 
 VideoCapture::VideoCapture(std::string name)
 :fd(-1), imgSize(0), deviceName{name}, isOpened(false),
-windows{0,0}, buffersNum(0), videoBuffers(nullptr)
+windows{0,0}, captureTime_us(0), buffersNum(0), videoBuffers(nullptr)
 {
 }
 
@@ -429,6 +430,121 @@ void VideoCapture::setH264ProfileAndLevel(H264Profile profile,
     }
 }
 
+bool VideoCapture::setControl(uint32_t id, int32_t value, const char *name)
+{
+    struct v4l2_control control;
+
+    memset(&control, 0, sizeof(control));
+    control.id = id;
+    control.value = value;
+    if(ioctl(fd, VIDIOC_S_CTRL, &control) == -1)
+    {
+        ERROR_MESSAGE("VIDIOC_S_CTRL %s=%d (%s(%d)).",
+            name, value, strerror(errno), errno);
+        return false;
+    }
+    V4L2_MESSAGE("set %s: %d", name, value);
+    return true;
+}
+
+bool VideoCapture::setIntraRefresh(unsigned int period_frames,
+                                   unsigned int idrPeriod_frames)
+{
+    bool isSet = false;
+
+    if(!isOpened){
+        ERROR_MESSAGE("device(%s) has not opened.",
+            deviceName.c_str());
+        throw std::runtime_error("device has not been opened.");
+    }
+    if(period_frames == 0)
+    {
+        return false;
+    }
+
+#if defined(V4L2_CID_MPEG_VIDEO_INTRA_REFRESH_PERIOD)
+    isSet = setControl(V4L2_CID_MPEG_VIDEO_INTRA_REFRESH_PERIOD,
+                       int32_t(period_frames), "intra refresh period");
+#endif
+#if defined(V4L2_CID_MPEG_VIDEO_CYCLIC_INTRA_REFRESH_MB)
+    if(!isSet)
+    {
+        // older drivers take the macroblocks which are refreshed per frame
+        uint32_t macroblocks = ((windows.width + 15) / 16) * ((windows.height + 15) / 16);
+        isSet = setControl(V4L2_CID_MPEG_VIDEO_CYCLIC_INTRA_REFRESH_MB,
+                           int32_t((macroblocks + period_frames - 1) / period_frames),
+                           "cyclic intra refresh MB");
+    }
+#endif
+    if(!isSet)
+    {
+        ERROR_MESSAGE("device(%s) has no intra refresh.", deviceName.c_str());
+        return false;
+    }
+    if(idrPeriod_frames > 0)
+    {
+        setControl(V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, int32_t(idrPeriod_frames),
+                   "h.264 IDR period");
+    }
+    return true;
+}
+
+bool VideoCapture::setMultiSlice(H264SliceMode mode, unsigned int limit)
+{
+    if(!isOpened){
+        ERROR_MESSAGE("device(%s) has not opened.",
+            deviceName.c_str());
+        throw std::runtime_error("device has not been opened.");
+    }
+
+    if(!setControl(V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MODE, int32_t(mode),
+                   "multi slice mode"))
+    {
+        return false;
+    }
+    switch(mode)
+    {
+        case H264SliceMode::MaxMacroblocks:
+            return setControl(V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_MB, int32_t(limit),
+                              "macroblocks of a slice");
+        case H264SliceMode::MaxBytes:
+            return setControl(V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_BYTES, int32_t(limit),
+                              "bytes of a slice");
+        default:
+            return true;
+    }
+}
+
+bool VideoCapture::setTemporalLayers(unsigned int layers)
+{
+    if(!isOpened){
+        ERROR_MESSAGE("device(%s) has not opened.",
+            deviceName.c_str());
+        throw std::runtime_error("device has not been opened.");
+    }
+
+    if(!setControl(V4L2_CID_MPEG_VIDEO_H264_HIERARCHICAL_CODING, 1,
+                   "hierarchical coding")
+       || !setControl(V4L2_CID_MPEG_VIDEO_H264_HIERARCHICAL_CODING_TYPE,
+                      V4L2_MPEG_VIDEO_H264_HIERARCHICAL_CODING_P, "hierarchical coding type"))
+    {
+        ERROR_MESSAGE("device(%s) has no hierarchical-P.", deviceName.c_str());
+        return false;
+    }
+    return setControl(V4L2_CID_MPEG_VIDEO_H264_HIERARCHICAL_CODING_LAYER, int32_t(layers),
+                      "hierarchical coding layers");
+}
+
+bool VideoCapture::forceKeyframe()
+{
+    if(!isOpened){
+        ERROR_MESSAGE("device(%s) has not opened.",
+            deviceName.c_str());
+        return false;
+    }
+    return setControl(V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 1, "force key frame");
+}
+
 void VideoCapture::setWindow(WindowsSize win){
     switch (win)
     {
@@ -449,6 +565,18 @@ void VideoCapture::setWindow(WindowsSize win){
             windows.height = 1944;
             windows.width = 2592;
             break;
+        }
+        case WindowsSize::pixel_360p:
+        {
+            windows.height = 360;
+            windows.width = 640;
+            break;
+        }
+        case WindowsSize::pixel_180p:
+        {
+            windows.height = 180;
+            windows.width = 320;
+            break;
         }    
     }
 
@@ -692,6 +820,14 @@ void VideoCapture::handleLoop()
                           buf.index, int(buffersNum));
         }
 
+        if((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+        {
+            captureTime_us = uint64_t(buf.timestamp.tv_sec) * 1000000 + buf.timestamp.tv_usec;
+        }else
+        {
+            captureTime_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
         onSample(videoBuffers[buf.index].start, buf.bytesused);
 
         if (ioctl(fd, VIDIOC_QBUF, &buf) == -1)
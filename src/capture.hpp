@@ -62,6 +62,13 @@ enum class H264Level: int
     Level4_2 = V4L2_MPEG_VIDEO_H264_LEVEL_4_2
 };
 
+enum class H264SliceMode: int
+{
+    Single = V4L2_MPEG_VIDEO_MULTI_SLICE_MODE_SINGLE,
+    MaxMacroblocks = V4L2_MPEG_VIDEO_MULTI_SLICE_MODE_MAX_MB,
+    MaxBytes = V4L2_MPEG_VIDEO_MULTI_SLICE_MODE_MAX_BYTES
+};
+
 struct buffer
 {
     void *start;
@@ -80,6 +87,8 @@ class VideoCapture
             uint32_t width;
         }windows;
         unsigned int fps;
+        /* CLOCK_MONOTONIC time of the sample in onSample */
+        uint64_t captureTime_us;
 
     #if(ENUM_CTRL > 0)
         void enumerateMenu(uint32_t id, uint32_t min_i, uint32_t max_i);
@@ -89,12 +98,22 @@ class VideoCapture
         size_t buffersNum=0;
 
         struct buffer *videoBuffers;
+
+        /**
+         * @brief set a control of the encoder, a missing control is not fatal
+         * 
+         * @return false if the driver has refused it
+         */
+        bool setControl(uint32_t id, int32_t value, const char *name);
         
     public:
         enum class WindowsSize{
             pixel_720p,
             pixel_1080p,
             pixel_5MP,
+            /* the lower encodings of a simulcast camera */
+            pixel_360p,
+            pixel_180p,
         };
         
         VideoCapture()=delete;
@@ -139,6 +158,13 @@ class VideoCapture
         void setVideoFormat(void);
 
         unsigned int getVideoStreamFps(){return fps;}
+        /**
+         * @brief when the driver has captured the sample which is passed to
+         * onSample, in us of CLOCK_MONOTONIC (std::chrono::steady_clock)
+         */
+        uint64_t getCaptureTime_us(){return captureTime_us;}
+        uint32_t getWidth(){return windows.width;}
+        uint32_t getHeight(){return windows.height;}
 
         void setH264ProfileAndLevel();
 
@@ -184,6 +210,42 @@ class VideoCapture
         void setWindow(WindowsSize win);
 
         void setH264ProfileAndLevel(H264Profile profile, H264Level level);
+
+        /**
+         * @brief refresh the picture in stripes over period frames instead
+         * of sending a large IDR frame, the encoder marks the start of a
+         * refresh with a recovery point SEI.
+         * 
+         * @param period_frames frames of a refresh cycle
+         * @param idrPeriod_frames frames between IDRs, 0 keeps the default
+         * @return false if the encoder has no intra refresh
+         */
+        bool setIntraRefresh(unsigned int period_frames, unsigned int idrPeriod_frames);
+
+        /**
+         * @brief split a frame into slices, with MaxBytes every slice fits
+         * into one RTP packet and a lost packet costs only its slice.
+         * 
+         * @param limit macroblocks or bytes of a slice, unused for Single
+         * @return false if the encoder has no multi slice mode
+         */
+        bool setMultiSlice(H264SliceMode mode, unsigned int limit);
+
+        /**
+         * @brief hierarchical-P with layers temporal layers, the frames of
+         * the top layer are not referenced and can be dropped for a viewer.
+         * 
+         * @return false if the encoder has no hierarchical coding
+         */
+        bool setTemporalLayers(unsigned int layers);
+
+        /**
+         * @brief the encoder sends an IDR next, e.g. for a viewer which is
+         * switched to this encoding
+         * 
+         * @return false if the encoder cannot be asked
+         */
+        bool forceKeyframe();
 };
 
 #endif /* __CAPTURE_H */
\ No newline at end of file
@@ -0,0 +1,215 @@
+/**
+ * @file certificate.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdexcept>
+#include <system_error>
+#include <ctime>
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/rand.h>
+#include <openssl/bn.h>
+
+#include "certificate.hpp"
+#include "utility.h"
+
+constexpr long secondsPerDay = 24L*60*60;
+
+/**
+ * @brief open a file which only can be read by the owner, because it
+ * will store the private key.
+ */
+static FILE *openPrivateFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0600);
+    if(fd == -1)
+    {
+        return nullptr;
+    }
+    return fdopen(fd, "w");
+}
+
+DtlsCertificate::DtlsCertificate(std::string certFile, std::string keyFile,
+                                 unsigned int validity, unsigned int rotation):
+certificateFile(certFile), keyFile(keyFile), validityDays(validity),
+rotationDays(rotation), isLoaded(false)
+{
+    if(rotationDays >= validityDays)
+    {
+        throw std::invalid_argument("rotation days must be less than validity days.");
+    }
+}
+
+bool DtlsCertificate::isUsable()
+{
+    bool usable = false;
+    FILE *file;
+    X509 *cert = nullptr;
+    EVP_PKEY *key = nullptr;
+
+    file = fopen(certificateFile.c_str(), "r");
+    if(file != nullptr)
+    {
+        cert = PEM_read_X509(file, nullptr, nullptr, nullptr);
+        fclose(file);
+    }
+    file = fopen(keyFile.c_str(), "r");
+    if(file != nullptr)
+    {
+        key = PEM_read_PrivateKey(file, nullptr, nullptr, nullptr);
+        fclose(file);
+    }
+
+    if(cert != nullptr && key != nullptr && X509_check_private_key(cert, key) == 1)
+    {
+        // rotate before it expires, a running session must not see an expired one
+        time_t deadline = time(nullptr) + rotationDays*secondsPerDay;
+        usable = X509_cmp_time(X509_get0_notAfter(cert), &deadline) > 0;
+        if(!usable)
+        {
+            APP_MESSAGE("DTLS certificate (%s) will expire, rotate it.",
+                certificateFile.c_str());
+        }
+    }
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return usable;
+}
+
+void DtlsCertificate::generate()
+{
+    EVP_PKEY *key = nullptr;
+    X509 *cert = nullptr;
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    unsigned char serial[8];
+    BIGNUM *serialNumber = nullptr;
+    std::string tmpCertFile = certificateFile + ".tmp";
+    std::string tmpKeyFile = keyFile + ".tmp";
+    FILE *file;
+    bool ok;
+
+    ok = ctx != nullptr
+         && EVP_PKEY_keygen_init(ctx) > 0
+         && EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) > 0
+         && EVP_PKEY_keygen(ctx, &key) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    if(!ok)
+    {
+        ERROR_MESSAGE("cannot generate the DTLS key.");
+        throw std::runtime_error("cannot generate the DTLS key.");
+    }
+
+    if(RAND_bytes(serial, sizeof(serial)) == 1)
+    {
+        serialNumber = BN_bin2bn(serial, sizeof(serial), nullptr);
+    }
+    cert = X509_new();
+    ok = cert != nullptr && serialNumber != nullptr
+         && X509_set_version(cert, 2) == 1
+         && BN_to_ASN1_INTEGER(serialNumber, X509_get_serialNumber(cert)) != nullptr
+         && X509_gmtime_adj(X509_getm_notBefore(cert), -secondsPerDay) != nullptr
+         && X509_gmtime_adj(X509_getm_notAfter(cert), validityDays*secondsPerDay) != nullptr
+         && X509_set_pubkey(cert, key) == 1
+         && X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN",
+                MBSTRING_ASC, (const unsigned char *)"LiveStreamServer", -1, -1, 0) == 1
+         && X509_set_issuer_name(cert, X509_get_subject_name(cert)) == 1
+         && X509_sign(cert, key, EVP_sha256()) > 0;
+    BN_free(serialNumber);
+    if(!ok)
+    {
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        ERROR_MESSAGE("cannot create the DTLS certificate.");
+        throw std::runtime_error("cannot create the DTLS certificate.");
+    }
+
+    // write to temporary files first, a crash must not leave a broken pair
+    file = openPrivateFile(tmpKeyFile);
+    ok = file != nullptr
+         && PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    if(file != nullptr) fclose(file);
+
+    if(ok)
+    {
+        file = fopen(tmpCertFile.c_str(), "w");
+        ok = file != nullptr && PEM_write_X509(file, cert) == 1;
+        if(file != nullptr) fclose(file);
+    }
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+
+    if(!ok
+       || rename(tmpKeyFile.c_str(), keyFile.c_str()) == -1
+       || rename(tmpCertFile.c_str(), certificateFile.c_str()) == -1)
+    {
+        int err = errno;
+        unlink(tmpKeyFile.c_str());
+        unlink(tmpCertFile.c_str());
+        ERROR_MESSAGE("cannot store the DTLS certificate (%s(%d)).",
+            strerror(err), err);
+        throw std::system_error(err, std::generic_category(),
+            "cannot store the DTLS certificate");
+    }
+
+    APP_MESSAGE("new DTLS certificate is stored in %s.", certificateFile.c_str());
+}
+
+void DtlsCertificate::load()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(!isUsable())
+    {
+        generate();
+    }
+    isLoaded = true;
+    nextCheck = std::chrono::steady_clock::now();
+}
+
+bool DtlsCertificate::refresh(std::chrono::seconds checkInterval)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto now = std::chrono::steady_clock::now();
+    if(!isLoaded || now < nextCheck)
+    {
+        return false;
+    }
+    nextCheck = now + checkInterval;
+    if(isUsable())
+    {
+        return false;
+    }
+    generate();
+    return true;
+}
+
+std::unique_lock<std::mutex> DtlsCertificate::lockFiles()
+{
+    return std::unique_lock<std::mutex>(lock);
+}
+
+void DtlsCertificate::applyTo(rtc::Configuration &config)
+{
+    if(!isLoaded)
+    {
+        load();
+    }
+    config.certificatePemFile = certificateFile;
+    config.keyPemFile = keyFile;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file certificate.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __CERTIFICATE_H
+#define __CERTIFICATE_H
+
+#include <string>
+#include <mutex>
+#include <chrono>
+
+#include <rtc/rtc.hpp>
+
+/**
+ * @brief DTLS certificate shared by all peer connections.
+ * The certificate and key are stored as PEM files, so that they survive a
+ * restart. They will be generated again when they are missing, broken or
+ * going to expire in the next rotationDays. A running camera checks them
+ * again with refresh(), the new peer connections read the rotated files.
+ */
+class DtlsCertificate
+{
+    private:
+        std::string certificateFile;
+        std::string keyFile;
+        unsigned int validityDays;
+        unsigned int rotationDays;
+        bool isLoaded;
+        /* the files are not rotated while a peer connection reads them */
+        std::mutex lock;
+        std::chrono::steady_clock::time_point nextCheck;
+
+        bool isUsable();
+        void generate();
+    public:
+        DtlsCertificate()=delete;
+        DtlsCertificate(std::string certFile, std::string keyFile,
+                        unsigned int validity=365, unsigned int rotation=30);
+        ~DtlsCertificate()=default;
+
+        /**
+         * @brief load the certificate from disk, generate a new one if the
+         * stored one is not usable.
+         *
+         */
+        void load();
+
+        /**
+         * @brief let all peer connections created by this configuration use
+         * the certificate instead of generating their own one.
+         *
+         * @param config configuration of the peer connections
+         */
+        void applyTo(rtc::Configuration &config);
+
+        /**
+         * @brief rotate the certificate if it is going to expire. The files
+         * are checked at most once per checkInterval.
+         *
+         * @return true if a new certificate has been stored
+         */
+        bool refresh(std::chrono::seconds checkInterval=std::chrono::hours(1));
+
+        /**
+         * @brief hold it while a peer connection is created, it reads the
+         * certificate and the key
+         */
+        std::unique_lock<std::mutex> lockFiles();
+};
+
+#endif /* __CERTIFICATE_H */
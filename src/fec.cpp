@@ -0,0 +1,344 @@
+/**
+ * @file fec.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "fec.hpp"
+#include "rate_control.hpp"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <sstream>
+#include <tuple>
+
+#include <nlohmann/json.hpp>
+
+constexpr size_t rtpHeaderSize = 12;
+constexpr size_t fecHeaderSize = 10;
+
+/* bytes after the fixed RTP header: CSRCs, extension, payload and padding */
+static size_t dataSizeOf(const rtc::binary& packet)
+{
+    return packet.size() - rtpHeaderSize;
+}
+
+static bool hasExtension(const rtc::binary& packet)
+{
+    return (uint8_t(packet[0]) & 0x10) != 0;
+}
+
+static uint16_t sequenceOf(const rtc::binary& packet)
+{
+    return uint16_t((uint8_t(packet[2]) << 8) | uint8_t(packet[3]));
+}
+
+static void setSequence(rtc::binary& packet, uint16_t sequence)
+{
+    packet[2] = std::byte(sequence >> 8);
+    packet[3] = std::byte(sequence & 0xff);
+}
+
+static void xorData(std::vector<uint8_t>& block, const rtc::binary& packet)
+{
+    size_t size = dataSizeOf(packet);
+    if(block.size() < size)
+    {
+        block.resize(size, 0);
+    }
+    auto data = reinterpret_cast<const uint8_t *>(packet.data()) + rtpHeaderSize;
+    for(size_t i = 0; i < size; i++)
+    {
+        block[i] ^= data[i];
+    }
+}
+
+bool FecCache::Key::operator<(const Key& other) const
+{
+    return std::tie(frameId, groupSize, group, packets, bytes)
+           < std::tie(other.frameId, other.groupSize, other.group, other.packets, other.bytes);
+}
+
+FecCache::FecCache(): hits(0), misses(0), fecPackets(0), mediaPackets(0)
+{}
+
+FecCache::Block FecCache::find(const Key& key)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = blocks.find(key);
+    if(it == blocks.end())
+    {
+        misses++;
+        return nullptr;
+    }
+    hits++;
+    return it->second;
+}
+
+void FecCache::insert(const Key& key, const Block& block)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    // the keys are sorted by the frame, the old frames are in front
+    while(!blocks.empty() && blocks.begin()->first.frameId + keptFrames < key.frameId)
+    {
+        blocks.erase(blocks.begin());
+    }
+    blocks[key] = block;
+}
+
+void FecCache::count(uint64_t media, uint64_t fec)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    mediaPackets += media;
+    fecPackets += fec;
+}
+
+std::string FecCache::getStatistics()
+{
+    nlohmann::ordered_json json;
+    std::lock_guard<std::mutex> guard(lock);
+    json["mediaPackets"] = mediaPackets;
+    json["fecPackets"] = fecPackets;
+    json["overhead"] = mediaPackets > 0 ? double(fecPackets) / mediaPackets : 0.0;
+    json["sharedBlocks"] = hits;
+    json["computedBlocks"] = misses;
+    hits = 0;
+    misses = 0;
+    mediaPackets = 0;
+    fecPackets = 0;
+    return json.dump();
+}
+
+UlpfecEncoder::UlpfecEncoder(const std::shared_ptr<FecCache>& c):
+cache(c), lossFraction(0), sequenceNumber(0), hasSequenceNumber(false)
+{}
+
+void UlpfecEncoder::setPayloadTypes(int red, int fec)
+{
+    bool isValid = red > 0 && red < 128 && fec > 0 && fec < 128;
+    redPayloadType = isValid ? red : 0;
+    fecPayloadType = isValid ? fec : 0;
+}
+
+void UlpfecEncoder::setLossFraction(double loss)
+{
+    // rises at once, falls slowly
+    lossFraction = loss > lossFraction ? loss : 0.8 * lossFraction + 0.2 * loss;
+    uint32_t size = 0;
+    if(lossFraction >= 0.20)
+    {
+        size = 2;
+    }else if(lossFraction >= 0.10)
+    {
+        size = 3;
+    }else if(lossFraction >= 0.06)
+    {
+        size = 5;
+    }else if(lossFraction >= 0.03)
+    {
+        size = 8;
+    }else if(lossFraction >= 0.01)
+    {
+        size = 12;
+    }
+    groupSize = size;
+}
+
+void UlpfecEncoder::wrapInRed(rtc::binary& packet, int blockPayloadType)
+{
+    size_t headerSize = rtpHeaderSize + 4 * (uint8_t(packet[0]) & 0x0f);
+    if(hasExtension(packet) && packet.size() >= headerSize + 4)
+    {
+        size_t words = (uint8_t(packet[headerSize + 2]) << 8) | uint8_t(packet[headerSize + 3]);
+        headerSize += 4 + 4 * words;
+    }
+    headerSize = std::min(headerSize, packet.size());
+    // the primary encoding only, its block header has F = 0
+    packet.insert(packet.begin() + headerSize, std::byte(blockPayloadType & 0x7f));
+    packet[1] = (packet[1] & std::byte(0x80)) | std::byte(redPayloadType & 0x7f);
+}
+
+rtc::binary UlpfecEncoder::makeFecPacket(const std::vector<rtc::binary *>& group,
+                                         uint32_t groupIndex, uint16_t sequence)
+{
+    // the data of the packets which are the same for all tracks
+    FecCache::Key key{frameId, uint32_t(group.size()), groupIndex, 0, 0};
+    for(auto packet: group)
+    {
+        if(!hasExtension(*packet))
+        {
+            key.packets++;
+            key.bytes += packet->size();
+        }
+    }
+    FecCache::Block shared = key.frameId != 0 ? cache->find(key) : nullptr;
+    if(!shared)
+    {
+        auto block = std::make_shared<std::vector<uint8_t>>();
+        for(auto packet: group)
+        {
+            if(!hasExtension(*packet))
+            {
+                xorData(*block, *packet);
+            }
+        }
+        if(key.frameId != 0)
+        {
+            cache->insert(key, block);
+        }
+        shared = block;
+    }
+    std::vector<uint8_t> block(*shared);
+    uint8_t recovery[8] = {0};
+    uint16_t lengthRecovery = 0;
+    for(auto packet: group)
+    {
+        if(hasExtension(*packet))
+        {
+            xorData(block, *packet);
+        }
+        // P, X, CC, M, PT and the timestamp
+        recovery[0] ^= uint8_t((*packet)[0]) & 0x3f;
+        for(int i = 1; i < 8; i++)
+        {
+            recovery[i] ^= i < 2 || i > 3 ? uint8_t((*packet)[i]) : 0;
+        }
+        lengthRecovery ^= uint16_t(dataSizeOf(*packet));
+    }
+
+    // the mask has a bit for every sequence number from the base on
+    uint16_t sequenceBase = sequenceOf(*group.front());
+    uint16_t span = uint16_t(sequenceOf(*group.back()) - sequenceBase) + 1;
+    bool isLongMask = span > 16;
+    size_t maskSize = isLongMask ? 6 : 2;
+    uint64_t mask = 0;
+    for(auto packet: group)
+    {
+        mask |= uint64_t(1) << (maskSize * 8 - 1 - uint16_t(sequenceOf(*packet) - sequenceBase));
+    }
+    auto first = group.front();
+
+    rtc::binary packet(rtpHeaderSize + fecHeaderSize + 2 + maskSize + block.size());
+    auto out = reinterpret_cast<uint8_t *>(packet.data());
+    // the RTP header of the first packet with the FEC payload type, no marker
+    std::copy(first->begin(), first->begin() + rtpHeaderSize, packet.begin());
+    out[0] = 0x80;
+    out[1] = uint8_t(fecPayloadType & 0x7f);
+    out[2] = uint8_t(sequence >> 8);
+    out[3] = uint8_t(sequence & 0xff);
+
+    // FEC header: E, L, P/X/CC, M/PT, SN base, TS and length recovery
+    uint8_t *fec = out + rtpHeaderSize;
+    fec[0] = (isLongMask ? 0x40 : 0x00) | recovery[0];
+    fec[1] = recovery[1];
+    fec[2] = uint8_t(sequenceBase >> 8);
+    fec[3] = uint8_t(sequenceBase & 0xff);
+    std::copy(recovery + 4, recovery + 8, fec + 4);
+    fec[8] = uint8_t(lengthRecovery >> 8);
+    fec[9] = uint8_t(lengthRecovery & 0xff);
+
+    // level 0 header: protection length and mask
+    uint8_t *level = fec + fecHeaderSize;
+    level[0] = uint8_t(block.size() >> 8);
+    level[1] = uint8_t(block.size() & 0xff);
+    for(size_t i = 0; i < maskSize; i++)
+    {
+        level[2 + i] = uint8_t(mask >> (8 * (maskSize - 1 - i)));
+    }
+    std::copy(block.begin(), block.end(), level + 2 + maskSize);
+    return packet;
+}
+
+rtc::MediaHandlerElement::ChainedOutgoingProduct
+UlpfecEncoder::processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                            rtc::message_ptr control)
+{
+    int red = redPayloadType;
+    if(red == 0 || !messages || messages->empty())
+    {
+        return {messages, control};
+    }
+
+    // the FEC packets take sequence numbers, so all packets are numbered here
+    for(auto& packet: *messages)
+    {
+        if(!hasSequenceNumber)
+        {
+            sequenceNumber = sequenceOf(packet);
+            hasSequenceNumber = true;
+        }
+        setSequence(packet, sequenceNumber++);
+    }
+
+    std::vector<rtc::binary> fecPackets;
+    uint32_t size = std::min(groupSize.load(), maxGroupSize);
+    if(size > 0)
+    {
+        // the groups of a block of up to 48 packets are interleaved, a burst
+        // of lost packets hits several groups with one loss each
+        std::vector<rtc::binary *> group;
+        for(size_t block = 0; block < messages->size(); block += maxGroupSize)
+        {
+            size_t count = std::min(size_t(maxGroupSize), messages->size() - block);
+            size_t groups = (count + size - 1) / size;
+            for(size_t i = 0; i < groups; i++)
+            {
+                group.clear();
+                for(size_t j = i; j < count; j += groups)
+                {
+                    group.push_back(&(*messages)[block + j]);
+                }
+                fecPackets.push_back(makeFecPacket(group, uint32_t(block + i), sequenceNumber++));
+            }
+        }
+    }
+    cache->count(messages->size(), fecPackets.size());
+
+    for(auto& packet: *messages)
+    {
+        wrapInRed(packet, uint8_t(packet[1]) & 0x7f);
+    }
+    for(auto& packet: fecPackets)
+    {
+        wrapInRed(packet, fecPayloadType);
+        messages->push_back(std::move(packet));
+    }
+    return {messages, control};
+}
+
+rtc::MediaHandlerElement::ChainedIncomingControlProduct
+UlpfecEncoder::processIncomingControlMessage(rtc::message_ptr message)
+{
+    double loss;
+    if(ReportedLossOf(*message, loss))
+    {
+        setLossFraction(loss);
+    }
+    return {message};
+}
+
+int UlpfecEncoder::findPayloadType(const std::string& sdp, const std::string& format)
+{
+    // a=rtpmap:<payload type> <format>
+    std::istringstream lines(sdp);
+    std::string line;
+    while(std::getline(lines, line))
+    {
+        if(line.compare(0, 9, "a=rtpmap:") != 0)
+        {
+            continue;
+        }
+        size_t space = line.find(' ');
+        if(space != std::string::npos && line.compare(space + 1, format.size(), format) == 0)
+        {
+            return atoi(line.c_str() + 9);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file fec.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __FEC_H
+#define __FEC_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <rtc/rtc.hpp>
+
+/**
+ * @brief the XOR of the packet data of a frame for every protection level,
+ * it is computed for the first track and shared with the other tracks of
+ * the same level. A track adds the packets which differ, e.g. the first
+ * packet with its header extensions.
+ */
+class FecCache
+{
+    public:
+        struct Key
+        {
+            uint64_t frameId;
+            uint32_t groupSize;
+            uint32_t group;
+            /* the shared packets of the group and their bytes, a check */
+            uint32_t packets;
+            uint32_t bytes;
+            bool operator<(const Key& other) const;
+        };
+        using Block = std::shared_ptr<const std::vector<uint8_t>>;
+    private:
+        /* frames which may still be sent by a slower track, the frame ids
+           of the encodings of all cameras are counted together */
+        static constexpr uint64_t keptFrames = 16;
+        std::mutex lock;
+        std::map<Key, Block> blocks;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t fecPackets;
+        uint64_t mediaPackets;
+    public:
+        FecCache();
+        ~FecCache()=default;
+
+        Block find(const Key& key);
+        void insert(const Key& key, const Block& block);
+        void count(uint64_t media, uint64_t fec);
+        /**
+         * @brief the FEC overhead and how often a block was shared
+         */
+        std::string getStatistics();
+};
+
+/**
+ * @brief ULPFEC (RFC 5109) in RED (RFC 2198) for the H.264 track, chained
+ * after the packetizer and the header extensions.
+ *
+ * Every media packet is sent in RED. The media packets of a frame are
+ * split into blocks of up to 48 packets and the packets of a block into
+ * interleaved groups, each group is protected by one FEC packet after the
+ * frame. A single lost packet of a group can be recovered. The group size
+ * follows the loss fraction of the receiver reports, without loss there is
+ * no FEC packet.
+ */
+class UlpfecEncoder: public rtc::MediaHandlerElement
+{
+    private:
+        std::shared_ptr<FecCache> cache;
+        std::atomic<int> redPayloadType{0};
+        std::atomic<int> fecPayloadType{0};
+        std::atomic<uint32_t> groupSize{0};
+        std::atomic<uint64_t> frameId{0};
+        double lossFraction;
+        uint16_t sequenceNumber;
+        bool hasSequenceNumber;
+
+        rtc::binary makeFecPacket(const std::vector<rtc::binary *>& group,
+                                  uint32_t groupIndex, uint16_t sequence);
+        void wrapInRed(rtc::binary& packet, int blockPayloadType);
+    public:
+        /* in the offers of the camera */
+        static constexpr int defaultRedPayloadType = 116;
+        static constexpr int defaultFecPayloadType = 117;
+        /* one FEC packet can cover 48 sequence numbers with the long mask */
+        static constexpr uint32_t maxGroupSize = 48;
+
+        UlpfecEncoder(const std::shared_ptr<FecCache>& cache);
+        ~UlpfecEncoder()=default;
+
+        /**
+         * @brief 0 for either turns FEC and RED off
+         */
+        void setPayloadTypes(int red, int fec);
+        int getRedPayloadType() {return redPayloadType;}
+        int getFecPayloadType() {return fecPayloadType;}
+        /**
+         * @brief the frame of the live stream which is sent next, its FEC
+         * is shared. 0 if it is not shared.
+         */
+        void setFrame(uint64_t id) {frameId = id;}
+        /**
+         * @brief smooth the reported loss and choose the group size
+         */
+        void setLossFraction(double loss);
+        uint32_t getGroupSize() {return groupSize;}
+
+        ChainedOutgoingProduct processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                                            rtc::message_ptr control) override;
+        ChainedIncomingControlProduct processIncomingControlMessage(rtc::message_ptr message) override;
+
+        /**
+         * @brief the payload type of an "a=rtpmap" line, e.g. "red/90000",
+         * 0 if the SDP has none
+         */
+        static int findPayloadType(const std::string& sdp, const std::string& format);
+};
+
+#endif /* __FEC_H */
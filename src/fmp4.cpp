@@ -0,0 +1,271 @@
+/**
+ * @file fmp4.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "fmp4.hpp"
+#include "h264_bitstream.hpp"
+
+#include <string.h>
+
+/**
+ * @brief big endian writer of ISO BMFF boxes, the size of a box is
+ * patched when it is closed.
+ */
+class BoxWriter
+{
+    private:
+        std::vector<uint8_t> &out;
+        std::vector<size_t> openBoxes;
+    public:
+        BoxWriter(std::vector<uint8_t> &o): out(o) {}
+
+        void u8(uint8_t v) {out.push_back(v);}
+        void u16(uint16_t v) {u8(v >> 8); u8(v);}
+        void u32(uint32_t v) {u16(v >> 16); u16(v);}
+        void u64(uint64_t v) {u32(v >> 32); u32(v);}
+        void zeros(size_t n) {out.insert(out.end(), n, 0);}
+        void bytes(const void *data, size_t len)
+        {
+            auto p = static_cast<const uint8_t *>(data);
+            out.insert(out.end(), p, p + len);
+        }
+        void fourcc(const char *type) {bytes(type, 4);}
+        size_t size() {return out.size();}
+        void patch32(size_t pos, uint32_t v)
+        {
+            out[pos] = v >> 24;
+            out[pos + 1] = v >> 16;
+            out[pos + 2] = v >> 8;
+            out[pos + 3] = v;
+        }
+
+        void begin(const char *type)
+        {
+            openBoxes.push_back(out.size());
+            u32(0);
+            fourcc(type);
+        }
+        void beginFull(const char *type, uint8_t version, uint32_t flags)
+        {
+            begin(type);
+            u32((uint32_t(version) << 24) | (flags & 0xffffff));
+        }
+        void end()
+        {
+            size_t start = openBoxes.back();
+            openBoxes.pop_back();
+            patch32(start, uint32_t(out.size() - start));
+        }
+        void matrix()
+        {
+            const uint32_t unity[] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+            for(auto v: unity)
+            {
+                u32(v);
+            }
+        }
+};
+
+Mp4Muxer::Mp4Muxer(): sequenceNumber(1)
+{}
+
+void Mp4Muxer::reset()
+{
+    sequenceNumber = 1;
+}
+
+bool Mp4Muxer::makeInitSegment(const Mp4ParameterSets& parameterSets,
+                               std::vector<uint8_t>& out)
+{
+    H264Sps sps;
+    if(!ParseSps(parameterSets.sps.data(), parameterSets.sps.size(), sps)
+       || parameterSets.pps.empty())
+    {
+        return false;
+    }
+
+    BoxWriter w(out);
+    w.begin("ftyp");
+    w.fourcc("iso6");
+    w.u32(0);
+    w.fourcc("iso6");
+    w.fourcc("cmfc");
+    w.fourcc("mp41");
+    w.end();
+
+    w.begin("moov");
+    w.beginFull("mvhd", 0, 0);
+    w.u32(0);                   /* creation_time */
+    w.u32(0);                   /* modification_time */
+    w.u32(1000);                /* timescale */
+    w.u32(0);                   /* duration, it is in the fragments */
+    w.u32(0x00010000);          /* rate */
+    w.u16(0x0100);              /* volume */
+    w.zeros(10);
+    w.matrix();
+    w.zeros(24);                /* pre_defined */
+    w.u32(2);                   /* next_track_ID */
+    w.end();
+
+    w.begin("trak");
+    w.beginFull("tkhd", 0, 0x000003);   /* enabled, in movie */
+    w.u32(0);
+    w.u32(0);
+    w.u32(1);                   /* track_ID */
+    w.u32(0);
+    w.u32(0);                   /* duration */
+    w.zeros(8);
+    w.u16(0);                   /* layer */
+    w.u16(0);                   /* alternate_group */
+    w.u16(0);                   /* volume */
+    w.u16(0);
+    w.matrix();
+    w.u32(sps.width << 16);
+    w.u32(sps.height << 16);
+    w.end();
+
+    w.begin("mdia");
+    w.beginFull("mdhd", 0, 0);
+    w.u32(0);
+    w.u32(0);
+    w.u32(timescale);
+    w.u32(0);
+    w.u16(0x55c4);              /* und */
+    w.u16(0);
+    w.end();
+    w.beginFull("hdlr", 0, 0);
+    w.u32(0);
+    w.fourcc("vide");
+    w.zeros(12);
+    w.bytes("VideoHandler", 13);
+    w.end();
+
+    w.begin("minf");
+    w.beginFull("vmhd", 0, 1);
+    w.zeros(8);
+    w.end();
+    w.begin("dinf");
+    w.beginFull("dref", 0, 0);
+    w.u32(1);
+    w.beginFull("url ", 0, 1);  /* the data is in this file */
+    w.end();
+    w.end();
+    w.end();
+
+    w.begin("stbl");
+    w.beginFull("stsd", 0, 0);
+    w.u32(1);
+    w.begin("avc1");
+    w.zeros(6);
+    w.u16(1);                   /* data_reference_index */
+    w.zeros(16);
+    w.u16(sps.width);
+    w.u16(sps.height);
+    w.u32(0x00480000);          /* 72 dpi */
+    w.u32(0x00480000);
+    w.u32(0);
+    w.u16(1);                   /* frame_count */
+    w.zeros(32);                /* compressorname */
+    w.u16(0x0018);              /* depth */
+    w.u16(0xffff);
+    w.begin("avcC");
+    w.u8(1);
+    w.u8(sps.profileIdc);
+    w.u8(sps.constraintFlags);
+    w.u8(sps.levelIdc);
+    w.u8(0xff);                 /* 4 byte NAL unit length */
+    w.u8(0xe1);                 /* one SPS */
+    w.u16(parameterSets.sps.size());
+    w.bytes(parameterSets.sps.data(), parameterSets.sps.size());
+    w.u8(1);                    /* one PPS */
+    w.u16(parameterSets.pps.size());
+    w.bytes(parameterSets.pps.data(), parameterSets.pps.size());
+    if(sps.profileIdc == 100 || sps.profileIdc == 110
+       || sps.profileIdc == 122 || sps.profileIdc == 144)
+    {
+        w.u8(0xfc | sps.chromaFormatIdc);
+        w.u8(0xf8 | (sps.bitDepthLuma - 8));
+        w.u8(0xf8 | (sps.bitDepthChroma - 8));
+        w.u8(0);
+    }
+    w.end();
+    w.end();
+    w.end();
+
+    // the samples are in the fragments
+    const char *emptyTables[] = {"stts", "stsc", "stco"};
+    for(auto type: emptyTables)
+    {
+        w.beginFull(type, 0, 0);
+        w.u32(0);
+        w.end();
+    }
+    w.beginFull("stsz", 0, 0);
+    w.u32(0);
+    w.u32(0);
+    w.end();
+    w.end();    /* stbl */
+    w.end();    /* minf */
+    w.end();    /* mdia */
+    w.end();    /* trak */
+
+    w.begin("mvex");
+    w.beginFull("trex", 0, 0);
+    w.u32(1);                   /* track_ID */
+    w.u32(1);                   /* default_sample_description_index */
+    w.u32(0);
+    w.u32(0);
+    w.u32(0);
+    w.end();
+    w.end();
+    w.end();    /* moov */
+    return true;
+}
+
+void Mp4Muxer::makeFragmentHeader(const Mp4Fragment& fragment, uint64_t baseTime,
+                                  std::vector<uint8_t>& out)
+{
+    BoxWriter w(out);
+    size_t moofStart = w.size();
+
+    w.begin("moof");
+    w.beginFull("mfhd", 0, 0);
+    w.u32(sequenceNumber++);
+    w.end();
+
+    w.begin("traf");
+    w.beginFull("tfhd", 0, 0x020000);   /* default-base-is-moof */
+    w.u32(1);
+    w.end();
+    w.beginFull("tfdt", 1, 0);
+    w.u64(baseTime);
+    w.end();
+
+    // data offset, duration, size and flags of every sample
+    w.beginFull("trun", 0, 0x000701);
+    w.u32(fragment.samples.size());
+    size_t dataOffset = w.size();
+    w.u32(0);
+    for(auto& sample: fragment.samples)
+    {
+        w.u32(sample.duration);
+        w.u32(sample.size);
+        // sync samples depend on nothing, the others on other samples
+        w.u32(sample.isSync ? 0x02000000 : 0x01010000);
+    }
+    w.end();
+    w.end();    /* traf */
+    w.end();    /* moof */
+
+    // the data starts after the header of the mdat
+    w.patch32(dataOffset, uint32_t(w.size() - moofStart + 8));
+    w.u32(uint32_t(fragment.data.size() + 8));
+    w.fourcc("mdat");
+}
@@ -0,0 +1,83 @@
+/**
+ * @file fmp4.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __FMP4_H
+#define __FMP4_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief the parameter sets of a H.264 track without start codes
+ */
+struct Mp4ParameterSets
+{
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+};
+
+/**
+ * @brief a group of pictures, which becomes one CMAF fragment. The data
+ * is the mdat payload, every NAL unit has a 4 byte length instead of the
+ * start code.
+ */
+struct Mp4Fragment
+{
+    struct Sample
+    {
+        uint32_t size;
+        uint32_t duration;
+        bool isSync;
+    };
+    std::shared_ptr<const Mp4ParameterSets> parameterSets;
+    /* a decoder can start at the first sample: an IDR or a recovery point */
+    bool isJoinPoint = false;
+    /* capture time of the first sample in us */
+    uint64_t time_us = 0;
+    uint64_t duration_us = 0;
+    std::vector<Sample> samples;
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @brief write fragmented MP4 (CMAF) with one H.264 track
+ */
+class Mp4Muxer
+{
+    private:
+        uint32_t sequenceNumber;
+    public:
+        static constexpr uint32_t timescale = 90000;
+
+        Mp4Muxer();
+        ~Mp4Muxer()=default;
+
+        /**
+         * @brief ftyp and moov of a file, false if the SPS cannot be parsed
+         */
+        static bool makeInitSegment(const Mp4ParameterSets& parameterSets,
+                                    std::vector<uint8_t>& out);
+        /**
+         * @brief moof and mdat header of a fragment, the data of the
+         * fragment follows them in the file.
+         *
+         * @param baseTime decode time of the first sample in the timescale
+         */
+        void makeFragmentHeader(const Mp4Fragment& fragment, uint64_t baseTime,
+                                std::vector<uint8_t>& out);
+        /* a new file starts with the sequence number 1 */
+        void reset();
+};
+
+#endif /* __FMP4_H */
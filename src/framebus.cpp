@@ -0,0 +1,417 @@
+/**
+ * @file framebus.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "framebus.hpp"
+#include "utility.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <system_error>
+
+/* the first message to a client, the descriptors are in the control data */
+struct FrameBusHello
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t mapSize;
+};
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static sockaddr_un socketAddress(const std::string& path)
+{
+    sockaddr_un address{};
+    if(path.size() >= sizeof(address.sun_path))
+    {
+        throw std::invalid_argument("the socket path is too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+FrameBus::FrameBus(const std::string& path, size_t dataSize, uint32_t slotCount):
+socketPath(path), memFd(-1), mapSize(0), map(nullptr), listenFd(-1), wakeFd(-1)
+{
+    if(dataSize == 0 || slotCount == 0)
+    {
+        throw std::invalid_argument("the frame bus cannot be empty.");
+    }
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t headerSize = alignUp(sizeof(FrameBusHeader), 64);
+    size_t dataOffset = alignUp(headerSize + sizeof(FrameBusSlot) * slotCount, pageSize);
+    mapSize = dataOffset + alignUp(dataSize, pageSize);
+
+    memFd = memfd_create("framebus", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(memFd < 0 || ftruncate(memFd, mapSize) < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "cannot create the frame bus");
+    }
+    map = static_cast<uint8_t *>(
+        mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0));
+    if(map == MAP_FAILED)
+    {
+        close(memFd);
+        throw std::system_error(errno, std::generic_category(), "cannot map the frame bus");
+    }
+
+    // the clients cannot resize it and cannot map it writable
+    int seals = F_SEAL_SHRINK | F_SEAL_GROW;
+#ifdef F_SEAL_FUTURE_WRITE
+    seals |= F_SEAL_FUTURE_WRITE;
+#endif
+    if(fcntl(memFd, F_ADD_SEALS, seals | F_SEAL_SEAL) < 0)
+    {
+        ERROR_MESSAGE("cannot seal the frame bus: %s", strerror(errno));
+    }
+
+    header = new (map) FrameBusHeader;
+    header->magic = FrameBusMagic;
+    header->version = FrameBusVersion;
+    header->headerSize = headerSize;
+    header->slotCount = slotCount;
+    header->dataOffset = dataOffset;
+    header->dataSize = mapSize - dataOffset;
+    header->writeSeq = 0;
+    header->writeOffset = 0;
+    slots = reinterpret_cast<FrameBusSlot *>(map + headerSize);
+    for(uint32_t i = 0; i < slotCount; i++)
+    {
+        new (&slots[i]) FrameBusSlot;
+        slots[i].seq = 0;
+    }
+    data = map + dataOffset;
+
+    listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    wakeFd = eventfd(0, EFD_CLOEXEC);
+    auto address = socketAddress(socketPath);
+    unlink(socketPath.c_str());
+    if(listenFd < 0 || wakeFd < 0
+       || bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0
+       || listen(listenFd, 8) < 0)
+    {
+        int error = errno;
+        if(listenFd >= 0) close(listenFd);
+        if(wakeFd >= 0) close(wakeFd);
+        munmap(map, mapSize);
+        close(memFd);
+        throw std::system_error(error, std::generic_category(), "cannot listen on " + socketPath);
+    }
+    server = std::thread(&FrameBus::serverLoop, this);
+}
+
+FrameBus::~FrameBus()
+{
+    uint64_t one = 1;
+    if(write(wakeFd, &one, sizeof(one)) < 0)
+    {
+        ERROR_MESSAGE("cannot stop the frame bus: %s", strerror(errno));
+    }
+    server.join();
+    for(auto& client: clients)
+    {
+        close(client.socket);
+        close(client.event);
+    }
+    close(listenFd);
+    close(wakeFd);
+    unlink(socketPath.c_str());
+    munmap(map, mapSize);
+    close(memFd);
+}
+
+void FrameBus::publish(const void *sample, size_t len, uint64_t time_us, uint32_t flags)
+{
+    const uint64_t dataSize = header->dataSize;
+    if(len > dataSize)
+    {
+        ERROR_MESSAGE("the sample (%zu bytes) does not fit into the frame bus.", len);
+        return;
+    }
+
+    uint64_t seq = header->writeSeq.load(std::memory_order_relaxed);
+    auto& slot = slots[seq % header->slotCount];
+    uint64_t offset = header->writeOffset.load(std::memory_order_relaxed);
+    // keep the sample contiguous, skip the rest of the ring
+    if(offset % dataSize + len > dataSize)
+    {
+        offset += dataSize - offset % dataSize;
+    }
+
+    slot.seq.store(2 * seq + 1, std::memory_order_relaxed);
+    // the readers of the overwritten samples see the new end before the data
+    header->writeOffset.store(offset + len, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(data + offset % dataSize, sample, len);
+    slot.offset = offset;
+    slot.size = uint32_t(len);
+    slot.flags = flags;
+    slot.time_us = time_us;
+    slot.seq.store(2 * seq + 2, std::memory_order_release);
+    header->writeSeq.store(seq + 1, std::memory_order_release);
+
+    uint64_t one = 1;
+    std::lock_guard<std::mutex> guard(clientsLock);
+    for(auto& client: clients)
+    {
+        // a full counter means the reader is asleep anyway
+        if(write(client.event, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        {
+            ERROR_MESSAGE("cannot notify a frame bus client: %s", strerror(errno));
+        }
+    }
+}
+
+size_t FrameBus::getClientCount()
+{
+    std::lock_guard<std::mutex> guard(clientsLock);
+    return clients.size();
+}
+
+void FrameBus::serverLoop()
+{
+    while(true)
+    {
+        std::vector<pollfd> fds;
+        fds.push_back({wakeFd, POLLIN, 0});
+        fds.push_back({listenFd, POLLIN, 0});
+        clientsLock.lock();
+        for(auto& client: clients)
+        {
+            fds.push_back({client.socket, POLLIN, 0});
+        }
+        clientsLock.unlock();
+
+        if(poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            ERROR_MESSAGE("the frame bus stops: %s", strerror(errno));
+            return;
+        }
+        if(fds[0].revents)
+        {
+            return;
+        }
+        if(fds[1].revents & POLLIN)
+        {
+            acceptClient();
+        }
+        // the clients send nothing, readable means closed
+        for(size_t i = 2; i < fds.size(); i++)
+        {
+            if(fds[i].revents)
+            {
+                removeClient(fds[i].fd);
+            }
+        }
+    }
+}
+
+void FrameBus::acceptClient()
+{
+    int socket = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if(socket < 0)
+    {
+        ERROR_MESSAGE("cannot accept a frame bus client: %s", strerror(errno));
+        return;
+    }
+    int event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(event < 0)
+    {
+        close(socket);
+        return;
+    }
+
+    FrameBusHello hello{FrameBusMagic, FrameBusVersion, mapSize};
+    iovec iov{&hello, sizeof(hello)};
+    int fds[2] = {memFd, event};
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(fds))];
+        cmsghdr align;
+    } control{};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    auto cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if(sendmsg(socket, &message, MSG_NOSIGNAL) < 0)
+    {
+        ERROR_MESSAGE("cannot send the frame bus: %s", strerror(errno));
+        close(socket);
+        close(event);
+        return;
+    }
+    std::lock_guard<std::mutex> guard(clientsLock);
+    clients.push_back({socket, event});
+    APP_MESSAGE("frame bus client %zu has connected.", clients.size());
+}
+
+void FrameBus::removeClient(int socket)
+{
+    std::lock_guard<std::mutex> guard(clientsLock);
+    for(auto it = clients.begin(); it != clients.end(); ++it)
+    {
+        if(it->socket == socket)
+        {
+            close(it->socket);
+            close(it->event);
+            clients.erase(it);
+            APP_MESSAGE("a frame bus client has disconnected.");
+            break;
+        }
+    }
+}
+
+FrameBusReader::FrameBusReader(const std::string& path):
+socket(-1), memFd(-1), eventFd(-1), mapSize(0), map(nullptr), lost(0)
+{
+    socket = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    auto address = socketAddress(path);
+    if(socket < 0
+       || connect(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        int error = errno;
+        if(socket >= 0) close(socket);
+        throw std::system_error(error, std::generic_category(), "cannot connect to " + path);
+    }
+
+    FrameBusHello hello{};
+    iovec iov{&hello, sizeof(hello)};
+    int fds[2] = {-1, -1};
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(fds))];
+        cmsghdr align;
+    } control{};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    ssize_t len = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    auto cmsg = CMSG_FIRSTHDR(&message);
+    if(len != sizeof(hello) || cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS
+       || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+    {
+        close(socket);
+        throw std::runtime_error("invalid frame bus hello.");
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    memFd = fds[0];
+    eventFd = fds[1];
+
+    mapSize = hello.mapSize;
+    void *p = mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, memFd, 0);
+    if(hello.magic != FrameBusMagic || hello.version != FrameBusVersion || p == MAP_FAILED)
+    {
+        close(socket);
+        close(memFd);
+        close(eventFd);
+        throw std::runtime_error("cannot map the frame bus.");
+    }
+    map = static_cast<const uint8_t *>(p);
+    header = reinterpret_cast<const FrameBusHeader *>(map);
+    slots = reinterpret_cast<const FrameBusSlot *>(map + header->headerSize);
+    data = map + header->dataOffset;
+    nextSeq = header->writeSeq.load(std::memory_order_acquire);
+}
+
+FrameBusReader::~FrameBusReader()
+{
+    munmap(const_cast<uint8_t *>(map), mapSize);
+    close(memFd);
+    close(eventFd);
+    close(socket);
+}
+
+bool FrameBusReader::wait(int timeout_ms)
+{
+    pollfd fd{eventFd, POLLIN, 0};
+    if(poll(&fd, 1, timeout_ms) <= 0)
+    {
+        return false;
+    }
+    uint64_t count;
+    return read(eventFd, &count, sizeof(count)) == sizeof(count);
+}
+
+bool FrameBusReader::next(Sample& sample)
+{
+    while(true)
+    {
+        uint64_t writeSeq = header->writeSeq.load(std::memory_order_acquire);
+        if(nextSeq >= writeSeq)
+        {
+            return false;
+        }
+        // the slots have been reused, continue with the newest sample
+        if(writeSeq - nextSeq > header->slotCount)
+        {
+            lost += writeSeq - 1 - nextSeq;
+            nextSeq = writeSeq - 1;
+        }
+
+        auto& slot = slots[nextSeq % header->slotCount];
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        sample.seq = nextSeq++;
+        if(seq != 2 * sample.seq + 2)
+        {
+            lost++;
+            continue;
+        }
+        sample.offset = slot.offset;
+        sample.size = slot.size;
+        sample.flags = slot.flags;
+        sample.time_us = slot.time_us;
+        sample.data = data + sample.offset % header->dataSize;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.seq.load(std::memory_order_relaxed) != seq || !isValid(sample))
+        {
+            lost++;
+            continue;
+        }
+        return true;
+    }
+}
+
+bool FrameBusReader::isValid(const Sample& sample)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto& slot = slots[sample.seq % header->slotCount];
+    if(slot.seq.load(std::memory_order_relaxed) != 2 * sample.seq + 2)
+    {
+        return false;
+    }
+    return header->writeOffset.load(std::memory_order_relaxed)
+           <= sample.offset + header->dataSize;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file framebus.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __FRAMEBUS_H
+#define __FRAMEBUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * The frame bus hands the samples of a stream to local processes through
+ * shared memory. A client connects to the Unix socket (SOCK_SEQPACKET)
+ * and receives one message with two descriptors (SCM_RIGHTS): the memfd
+ * of the bus and an eventfd, which is signalled after every sample. The
+ * memfd is mapped read only by the clients.
+ *
+ * layout of the memfd, all numbers in host byte order:
+ *
+ *   0                  FrameBusHeader
+ *   headerSize         FrameBusSlot[slotCount]
+ *   dataOffset         data ring of dataSize bytes
+ *
+ * sample n is in slot n % slotCount, its bytes are contiguous at
+ * dataOffset + offset % dataSize. The slot is a seqlock: seq is 2n+1
+ * while the sample is written and 2n+2 when it is complete. A reader
+ * copies the fields, uses the data and checks afterwards that seq is
+ * unchanged and writeOffset - offset <= dataSize, otherwise the writer
+ * has overtaken it and it continues at writeSeq. The writer never waits
+ * for the readers, a slow reader only loses its own samples.
+ */
+
+constexpr uint32_t FrameBusMagic = 0x53554246;     /* "FBUS" */
+constexpr uint32_t FrameBusVersion = 1;
+
+/* the sample starts with an SPS or IDR, a reader can start to decode */
+constexpr uint32_t FrameBusKeyFrame = 0x01;
+
+struct FrameBusHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t slotCount;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+    /* the number of published samples */
+    std::atomic<uint64_t> writeSeq;
+    /* the end of the last sample in the data ring, it only grows */
+    std::atomic<uint64_t> writeOffset;
+};
+
+struct FrameBusSlot
+{
+    std::atomic<uint64_t> seq;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t flags;
+    uint64_t time_us;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the frame bus needs lock free 64 bit atomics");
+
+/**
+ * @brief the writer of the bus and the server which hands it out
+ */
+class FrameBus
+{
+    private:
+        struct Client
+        {
+            int socket;
+            int event;
+        };
+        std::string socketPath;
+        int memFd;
+        size_t mapSize;
+        uint8_t *map;
+        FrameBusHeader *header;
+        FrameBusSlot *slots;
+        uint8_t *data;
+
+        int listenFd;
+        int wakeFd;
+        std::vector<Client> clients;
+        std::mutex clientsLock;
+        std::thread server;
+
+        void serverLoop();
+        void acceptClient();
+        void removeClient(int socket);
+    public:
+        FrameBus(const std::string& path, size_t dataSize, uint32_t slotCount=256);
+        ~FrameBus();
+        FrameBus(const FrameBus&)=delete;
+        FrameBus& operator=(const FrameBus&)=delete;
+
+        /**
+         * @brief copy a sample into the ring and wake up the readers
+         */
+        void publish(const void *sample, size_t len, uint64_t time_us, uint32_t flags);
+        size_t getClientCount();
+};
+
+/**
+ * @brief a reader of the bus for C++ clients
+ */
+class FrameBusReader
+{
+    private:
+        int socket;
+        int memFd;
+        int eventFd;
+        size_t mapSize;
+        const uint8_t *map;
+        const FrameBusHeader *header;
+        const FrameBusSlot *slots;
+        const uint8_t *data;
+        uint64_t nextSeq;
+        uint64_t lost;
+    public:
+        struct Sample
+        {
+            const uint8_t *data;
+            size_t size;
+            uint64_t time_us;
+            uint32_t flags;
+            uint64_t seq;
+            uint64_t offset;
+        };
+
+        FrameBusReader(const std::string& path);
+        ~FrameBusReader();
+        FrameBusReader(const FrameBusReader&)=delete;
+        FrameBusReader& operator=(const FrameBusReader&)=delete;
+
+        /* wait for the eventfd, false on timeout */
+        bool wait(int timeout_ms);
+        /**
+         * @brief the next sample without copying, nothing is returned if
+         * there is no new one. The data is valid until isValid() is false.
+         */
+        bool next(Sample& sample);
+        /* the sample has not been overwritten while it was used */
+        bool isValid(const Sample& sample);
+        /* the samples which have been overwritten before they were read */
+        uint64_t getLost() {return lost;}
+        int getEventFd() {return eventFd;}
+};
+
+#endif /* __FRAMEBUS_H */
@@ -0,0 +1,192 @@
+/**
+ * @file governor.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "governor.hpp"
+#include "utility.h"
+
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
+/* the load of a viewer is averaged over at least this time */
+constexpr std::chrono::seconds sampleInterval{1};
+
+ResourceGovernor::ResourceGovernor(const ResourceBudget& b,
+                                   const std::map<std::string, int>& priorityClasses):
+budget(b), classes(priorityClasses), lastSample(std::chrono::steady_clock::now()),
+admitted(0), refused(0), preempted(0)
+{}
+
+int ResourceGovernor::getPriority(const std::string& className)
+{
+    auto it = classes.find(className);
+    return it == classes.end() ? 0 : it->second;
+}
+
+void ResourceGovernor::sample()
+{
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastSample).count();
+    if(now - lastSample < sampleInterval)
+    {
+        return;
+    }
+    lastSample = now;
+
+    for(auto& [key, viewer]: viewers)
+    {
+        uint64_t bytes = viewer.usage->bytes;
+        uint64_t cpu_ns = viewer.usage->cpu_ns;
+        // the first interval of a viewer is not complete
+        if(viewer.since + sampleInterval <= now)
+        {
+            viewer.cpu = double(cpu_ns - viewer.lastCpu_ns) / 1e9 / elapsed;
+            viewer.egress_kbps = double(bytes - viewer.lastBytes) * 8 / 1000 / elapsed;
+            viewer.isMeasured = true;
+        }
+        viewer.lastBytes = bytes;
+        viewer.lastCpu_ns = cpu_ns;
+    }
+}
+
+double ResourceGovernor::cpuOf(const Viewer& viewer)
+{
+    return viewer.isMeasured ? viewer.cpu : budget.viewerCpu;
+}
+
+double ResourceGovernor::egressOf(const Viewer& viewer)
+{
+    return viewer.isMeasured ? viewer.egress_kbps : budget.viewerEgress_kbps;
+}
+
+bool ResourceGovernor::admit(const std::string& key, int priority,
+                             const std::shared_ptr<TrackUsage>& usage,
+                             std::function<void()> preempt,
+                             std::vector<std::function<void()>>& preemptions)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    sample();
+
+    // a new viewer costs as much as the average of the measured ones
+    double cpu = 0, egress = 0;
+    double measuredCpu = 0, measuredEgress = 0;
+    size_t measured = 0;
+    for(auto& [k, viewer]: viewers)
+    {
+        cpu += cpuOf(viewer);
+        egress += egressOf(viewer);
+        if(viewer.isMeasured)
+        {
+            measuredCpu += viewer.cpu;
+            measuredEgress += viewer.egress_kbps;
+            measured++;
+        }
+    }
+    double needCpu = measured ? measuredCpu / measured : budget.viewerCpu;
+    double needEgress = measured ? measuredEgress / measured : budget.viewerEgress_kbps;
+
+    auto fits = [&]()
+    {
+        return (budget.cpuCores <= 0 || cpu + needCpu <= budget.cpuCores)
+            && (budget.egress_kbps == 0 || egress + needEgress <= budget.egress_kbps);
+    };
+
+    // the lowest priority gives way first, the newest of them before the older
+    std::vector<std::map<std::string, Viewer>::iterator> victims;
+    if(!fits())
+    {
+        std::vector<std::map<std::string, Viewer>::iterator> candidates;
+        for(auto it = viewers.begin(); it != viewers.end(); ++it)
+        {
+            if(it->second.priority < priority)
+            {
+                candidates.push_back(it);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+            [](const auto& a, const auto& b)
+            {
+                if(a->second.priority != b->second.priority)
+                {
+                    return a->second.priority < b->second.priority;
+                }
+                return a->second.since > b->second.since;
+            }
+        );
+        for(auto& it: candidates)
+        {
+            if(fits())
+            {
+                break;
+            }
+            cpu -= cpuOf(it->second);
+            egress -= egressOf(it->second);
+            victims.push_back(it);
+        }
+    }
+
+    if(!fits())
+    {
+        refused++;
+        APP_MESSAGE("refuse a viewer (priority %d), load: %.2f cores, %.0f kbit/s.",
+            priority, cpu, egress);
+        return false;
+    }
+
+    for(auto& it: victims)
+    {
+        APP_MESSAGE("preempt the viewer %s (priority %d) for priority %d.",
+            it->first.c_str(), it->second.priority, priority);
+        preemptions.push_back(std::move(it->second.preempt));
+        viewers.erase(it);
+        preempted++;
+    }
+
+    Viewer viewer;
+    viewer.priority = priority;
+    viewer.usage = usage;
+    viewer.preempt = std::move(preempt);
+    viewer.since = std::chrono::steady_clock::now();
+    viewer.lastBytes = usage->bytes;
+    viewer.lastCpu_ns = usage->cpu_ns;
+    viewers[key] = std::move(viewer);
+    admitted++;
+    return true;
+}
+
+void ResourceGovernor::remove(const std::string& key)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    viewers.erase(key);
+}
+
+std::string ResourceGovernor::getStatistics()
+{
+    nlohmann::ordered_json json;
+    double cpu = 0, egress = 0;
+
+    std::lock_guard<std::mutex> guard(lock);
+    sample();
+    for(auto& [key, viewer]: viewers)
+    {
+        cpu += cpuOf(viewer);
+        egress += egressOf(viewer);
+    }
+    json["viewers"] = viewers.size();
+    json["cpuCores"] = cpu;
+    json["egress_kbps"] = egress;
+    json["budget"]["cpuCores"] = budget.cpuCores;
+    json["budget"]["egress_kbps"] = budget.egress_kbps;
+    json["admitted"] = admitted;
+    json["refused"] = refused;
+    json["preempted"] = preempted;
+    return json.dump();
+}
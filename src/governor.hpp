@@ -0,0 +1,98 @@
+/**
+ * @file governor.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __GOVERNOR_H
+#define __GOVERNOR_H
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "streamer.hpp"
+
+struct ResourceBudget
+{
+    /* CPU time for sending in cores, 0 means unlimited */
+    double cpuCores = 0;
+    /* egress bitrate of all viewers in kbit/s, 0 means unlimited */
+    uint64_t egress_kbps = 0;
+    /* the load of a viewer before it has been measured */
+    double viewerCpu = 0.02;
+    uint64_t viewerEgress_kbps = 2500;
+};
+
+/**
+ * @brief admit the viewers of all streams against a CPU and uplink budget.
+ *
+ * the load of every viewer is measured by its track. A new viewer is
+ * refused if the estimated load exceeds the budget, unless viewers with a
+ * lower priority can be preempted to make room for it.
+ */
+class ResourceGovernor
+{
+    private:
+        struct Viewer
+        {
+            int priority;
+            std::shared_ptr<TrackUsage> usage;
+            std::function<void()> preempt;
+            std::chrono::steady_clock::time_point since;
+            uint64_t lastBytes = 0;
+            uint64_t lastCpu_ns = 0;
+            bool isMeasured = false;
+            double cpu = 0;
+            double egress_kbps = 0;
+        };
+        ResourceBudget budget;
+        std::map<std::string, int> classes;
+        std::map<std::string, Viewer> viewers;
+        std::chrono::steady_clock::time_point lastSample;
+        size_t admitted;
+        size_t refused;
+        size_t preempted;
+        std::mutex lock;
+
+        void sample();
+        double cpuOf(const Viewer& viewer);
+        double egressOf(const Viewer& viewer);
+    public:
+        ResourceGovernor(const ResourceBudget& b,
+                         const std::map<std::string, int>& priorityClasses={});
+        ~ResourceGovernor()=default;
+
+        /**
+         * @brief the priority of a class name, unknown classes have 0
+         */
+        int getPriority(const std::string& className);
+        /**
+         * @brief admit a viewer, it is registered with the key if it fits
+         * into the budget.
+         *
+         * @param preemptions the callbacks of the viewers which have to give
+         * way, they must be called by the caller without holding any locks.
+         * @return false if the viewer is refused
+         */
+        bool admit(const std::string& key, int priority,
+                   const std::shared_ptr<TrackUsage>& usage,
+                   std::function<void()> preempt,
+                   std::vector<std::function<void()>>& preemptions);
+        void remove(const std::string& key);
+        /**
+         * @brief load, budget and decisions as JSON
+         */
+        std::string getStatistics();
+};
+
+#endif /* __GOVERNOR_H */
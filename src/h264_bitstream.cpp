@@ -0,0 +1,619 @@
+/**
+ * @file h264_bitstream.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "h264_bitstream.hpp"
+
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+/* payloadType of the recovery point SEI message, D.1 */
+constexpr uint32_t seiRecoveryPoint = 6;
+
+BitWriter::BitWriter(): bitsUsed(8)
+{}
+
+void BitWriter::writeBit(uint32_t bit)
+{
+    if(bitsUsed == 8)
+    {
+        rbsp.push_back(0);
+        bitsUsed = 0;
+    }
+    bitsUsed++;
+    rbsp.back() |= (bit & 0x01) << (8 - bitsUsed);
+}
+
+void BitWriter::writeBits(uint32_t value, int n)
+{
+    for(int i = n - 1; i >= 0; i--)
+    {
+        writeBit(value >> i);
+    }
+}
+
+void BitWriter::writeUE(uint32_t value)
+{
+    // value + 1 with as many leading zeros as it has bits after the first 1
+    uint64_t code = uint64_t(value) + 1;
+    int bits = 64 - __builtin_clzll(code);
+    writeBits(0, bits - 1);
+    for(int i = bits - 1; i >= 0; i--)
+    {
+        writeBit(uint32_t(code >> i));
+    }
+}
+
+void BitWriter::writeTrailingBits()
+{
+    writeBit(1);
+    bitsUsed = 8;
+}
+
+std::vector<uint8_t> BitWriter::toNalUnit(uint8_t header)
+{
+    std::vector<uint8_t> nal{header};
+    int zeros = 0;
+    for(auto byte: rbsp)
+    {
+        if(zeros >= 2 && byte <= 0x03)
+        {
+            nal.push_back(0x03);
+            zeros = 0;
+        }
+        nal.push_back(byte);
+        zeros = byte == 0 ? zeros + 1 : 0;
+    }
+    return nal;
+}
+
+BitReader::BitReader(const uint8_t *d, size_t len):
+data(d), size(len), pos(0), current(0), bitsLeft(0), zeros(0), echo(nullptr)
+{}
+
+void BitReader::nextByte()
+{
+    if(pos >= size)
+    {
+        throw std::runtime_error("read over the end of the NAL unit.");
+    }
+    // 00 00 03 is an emulation prevention byte
+    if(zeros >= 2 && data[pos] == 0x03)
+    {
+        pos++;
+        zeros = 0;
+        if(pos >= size)
+        {
+            throw std::runtime_error("read over the end of the NAL unit.");
+        }
+    }
+    current = data[pos++];
+    zeros = current == 0 ? zeros + 1 : 0;
+    bitsLeft = 8;
+}
+
+uint32_t BitReader::readBit()
+{
+    if(bitsLeft == 0)
+    {
+        nextByte();
+    }
+    bitsLeft--;
+    uint32_t bit = (current >> bitsLeft) & 0x01;
+    if(echo != nullptr)
+    {
+        echo->writeBit(bit);
+    }
+    return bit;
+}
+
+uint32_t BitReader::readBits(int n)
+{
+    uint32_t value = 0;
+    for(int i = 0; i < n; i++)
+    {
+        value = (value << 1) | readBit();
+    }
+    return value;
+}
+
+void BitReader::skipBits(int n)
+{
+    for(int i = 0; i < n; i++)
+    {
+        readBit();
+    }
+}
+
+uint32_t BitReader::readUE()
+{
+    int leadingZeros = 0;
+    while(readBit() == 0)
+    {
+        leadingZeros++;
+        if(leadingZeros > 31)
+        {
+            throw std::runtime_error("invaild exp-Golomb code.");
+        }
+    }
+    if(leadingZeros == 0)
+    {
+        return 0;
+    }
+    return uint32_t((uint64_t(1) << leadingZeros) - 1 + readBits(leadingZeros));
+}
+
+int32_t BitReader::readSE()
+{
+    uint32_t code = readUE();
+    // 1, 2, 3, 4 ... maps to 1, -1, 2, -2 ...
+    int32_t value = int32_t((code + 1) / 2);
+    return (code & 0x01) ? value : -value;
+}
+
+bool BitReader::hasMoreData()
+{
+    // the last 1 bit of the payload is the rbsp stop bit
+    size_t last = size;
+    while(last > 0 && data[last - 1] == 0)
+    {
+        last--;
+    }
+    if(last == 0)
+    {
+        return false;
+    }
+    int stopBit = __builtin_ctz(data[last - 1]);
+
+    // the byte and the bits which will be read next
+    size_t byte = bitsLeft == 0 ? pos : pos - 1;
+    int bits = bitsLeft == 0 ? 8 : bitsLeft;
+    if(byte != last - 1)
+    {
+        return byte < last - 1;
+    }
+    return bits - 1 > stopBit;
+}
+
+bool ParseSliceHeaderStart(const uint8_t *nal, size_t len, SliceHeaderStart& header)
+{
+    if(len < 2 || !IsVclNal(nal))
+    {
+        return false;
+    }
+    try
+    {
+        BitReader reader(nal + 1, len - 1);
+        header.firstMbInSlice = reader.readUE();
+        uint32_t sliceType = reader.readUE();
+        if(sliceType > 9)
+        {
+            return false;
+        }
+        // 5..9 mean that all slices of the picture have the same type
+        header.sliceType = H264SliceType(sliceType % 5);
+        header.ppsId = reader.readUE();
+    }catch(const std::runtime_error&)
+    {
+        return false;
+    }
+    return true;
+}
+
+static void skipScalingList(BitReader& reader, int size)
+{
+    int32_t lastScale = 8, nextScale = 8;
+    for(int i = 0; i < size; i++)
+    {
+        if(nextScale != 0)
+        {
+            nextScale = (lastScale + reader.readSE() + 256) % 256;
+        }
+        lastScale = nextScale == 0 ? lastScale : nextScale;
+    }
+}
+
+/* 7.3.2.1.1 up to vui_parameters_present_flag */
+static void readSpsUntilVui(BitReader& reader, H264Sps& sps)
+{
+    sps.profileIdc = reader.readBits(8);
+    sps.constraintFlags = reader.readBits(8);
+    sps.levelIdc = reader.readBits(8);
+    sps.id = reader.readUE();
+
+    switch(sps.profileIdc)
+    {
+        case 100: case 110: case 122: case 244: case 44:
+        case 83: case 86: case 118: case 128: case 138:
+        case 139: case 134: case 135:
+        {
+            sps.chromaFormatIdc = reader.readUE();
+            if(sps.chromaFormatIdc == 3)
+            {
+                reader.skipBits(1);     /* separate_colour_plane_flag */
+            }
+            sps.bitDepthLuma = reader.readUE() + 8;
+            sps.bitDepthChroma = reader.readUE() + 8;
+            reader.skipBits(1);         /* qpprime_y_zero_transform_bypass_flag */
+            if(reader.readBit())        /* seq_scaling_matrix_present_flag */
+            {
+                int lists = sps.chromaFormatIdc != 3 ? 8 : 12;
+                for(int i = 0; i < lists; i++)
+                {
+                    if(reader.readBit())
+                    {
+                        skipScalingList(reader, i < 6 ? 16 : 64);
+                    }
+                }
+            }
+            break;
+        }
+    }
+
+    sps.log2MaxFrameNum = reader.readUE() + 4;
+    sps.picOrderCntType = reader.readUE();
+    if(sps.picOrderCntType == 0)
+    {
+        reader.readUE();                /* log2_max_pic_order_cnt_lsb_minus4 */
+    }else if(sps.picOrderCntType == 1)
+    {
+        reader.skipBits(1);             /* delta_pic_order_always_zero_flag */
+        reader.readSE();                /* offset_for_non_ref_pic */
+        reader.readSE();                /* offset_for_top_to_bottom_field */
+        uint32_t cycle = reader.readUE();
+        for(uint32_t i = 0; i < cycle; i++)
+        {
+            reader.readSE();
+        }
+    }
+    sps.maxNumRefFrames = reader.readUE();
+    reader.skipBits(1);                 /* gaps_in_frame_num_value_allowed_flag */
+    uint32_t widthInMbs = reader.readUE() + 1;
+    uint32_t heightInMapUnits = reader.readUE() + 1;
+    sps.frameMbsOnly = reader.readBit();
+    if(!sps.frameMbsOnly)
+    {
+        reader.skipBits(1);             /* mb_adaptive_frame_field_flag */
+    }
+    reader.skipBits(1);                 /* direct_8x8_inference_flag */
+
+    sps.width = widthInMbs * 16;
+    sps.height = (2 - sps.frameMbsOnly) * heightInMapUnits * 16;
+    if(reader.readBit())                /* frame_cropping_flag */
+    {
+        uint32_t left = reader.readUE(), right = reader.readUE();
+        uint32_t top = reader.readUE(), bottom = reader.readUE();
+        uint32_t cropX = 1, cropY = 2 - sps.frameMbsOnly;
+        if(sps.chromaFormatIdc == 1 || sps.chromaFormatIdc == 2)
+        {
+            cropX = 2;
+        }
+        if(sps.chromaFormatIdc == 1)
+        {
+            cropY *= 2;
+        }
+        sps.width -= (left + right) * cropX;
+        sps.height -= (top + bottom) * cropY;
+    }
+}
+
+/* E.1.2 */
+static void readHrd(BitReader& reader)
+{
+    uint32_t cpbCount = reader.readUE() + 1;
+    reader.skipBits(8);                     /* bit_rate_scale, cpb_size_scale */
+    for(uint32_t i = 0; i < cpbCount; i++)
+    {
+        reader.readUE();                    /* bit_rate_value_minus1 */
+        reader.readUE();                    /* cpb_size_value_minus1 */
+        reader.skipBits(1);                 /* cbr_flag */
+    }
+    reader.skipBits(20);                    /* the delay and offset lengths */
+}
+
+/**
+ * E.1.1, with a writer the VUI is copied to it, the timing info is added
+ * and the bitstream_restriction is replaced for an output without delay.
+ */
+static void readVui(BitReader& reader, H264Sps& sps, BitWriter *out=nullptr,
+                    unsigned int fps=0)
+{
+    reader.setEcho(out);
+    if(reader.readBit())                    /* aspect_ratio_info_present_flag */
+    {
+        if(reader.readBits(8) == 255)       /* aspect_ratio_idc is Extended_SAR */
+        {
+            reader.skipBits(32);            /* sar_width, sar_height */
+        }
+    }
+    if(reader.readBit())                    /* overscan_info_present_flag */
+    {
+        reader.skipBits(1);
+    }
+    if(reader.readBit())                    /* video_signal_type_present_flag */
+    {
+        reader.skipBits(4);                 /* video_format, video_full_range_flag */
+        if(reader.readBit())                /* colour_description_present_flag */
+        {
+            reader.skipBits(24);
+        }
+    }
+    if(reader.readBit())                    /* chroma_loc_info_present_flag */
+    {
+        reader.readUE();
+        reader.readUE();
+    }
+
+    reader.setEcho(nullptr);
+    sps.hasTimingInfo = reader.readBit();
+    if(out != nullptr)
+    {
+        // two fields per frame, the time stamps of the RTP packets are not changed
+        out->writeBit(sps.hasTimingInfo || fps > 0);
+        if(!sps.hasTimingInfo && fps > 0)
+        {
+            out->writeBits(1, 32);          /* num_units_in_tick */
+            out->writeBits(2 * fps, 32);    /* time_scale */
+            out->writeBit(1);               /* fixed_frame_rate_flag */
+        }
+    }
+    reader.setEcho(out);
+    if(sps.hasTimingInfo)
+    {
+        sps.numUnitsInTick = reader.readBits(32);
+        sps.timeScale = reader.readBits(32);
+        reader.skipBits(1);                 /* fixed_frame_rate_flag */
+    }
+
+    bool hasNalHrd = reader.readBit();
+    if(hasNalHrd)
+    {
+        readHrd(reader);
+    }
+    bool hasVclHrd = reader.readBit();
+    if(hasVclHrd)
+    {
+        readHrd(reader);
+    }
+    if(hasNalHrd || hasVclHrd)
+    {
+        reader.skipBits(1);                 /* low_delay_hrd_flag */
+    }
+    reader.skipBits(1);                     /* pic_struct_present_flag */
+
+    reader.setEcho(nullptr);
+    // the values of E.2.1 for a missing bitstream_restriction
+    uint32_t motionVectorsOverBoundaries = 1;
+    uint32_t limits[4] = {2, 1, 16, 16};
+    sps.hasBitstreamRestriction = reader.readBit();
+    if(sps.hasBitstreamRestriction)
+    {
+        motionVectorsOverBoundaries = reader.readBit();
+        for(auto& limit: limits)
+        {
+            limit = reader.readUE();
+        }
+        sps.maxNumReorderFrames = reader.readUE();
+        sps.maxDecFrameBuffering = reader.readUE();
+    }
+    if(out != nullptr)
+    {
+        out->writeBit(1);
+        out->writeBit(motionVectorsOverBoundaries);
+        for(auto limit: limits)
+        {
+            out->writeUE(limit);
+        }
+        out->writeUE(0);                    /* max_num_reorder_frames */
+        // it may not be less than the reference frames
+        out->writeUE(std::max<uint32_t>(1, sps.maxNumRefFrames));
+    }
+}
+
+bool ParseSps(const uint8_t *nal, size_t len, H264Sps& sps)
+{
+    if(len < 4 || NalTypeOf(nal) != H264NalType::SPS)
+    {
+        return false;
+    }
+    BitReader reader(nal + 1, len - 1);
+    try
+    {
+        readSpsUntilVui(reader, sps);
+        sps.hasVui = reader.readBit();
+    }catch(const std::runtime_error&)
+    {
+        return false;
+    }
+    if(sps.hasVui)
+    {
+        try
+        {
+            readVui(reader, sps);
+        }catch(const std::runtime_error&)
+        {
+            // the fields up to the VUI are still valid
+        }
+    }
+    return true;
+}
+
+bool RewriteSpsForLowDelay(const uint8_t *nal, size_t len, unsigned int fps,
+                           std::vector<uint8_t>& out)
+{
+    if(len < 4 || NalTypeOf(nal) != H264NalType::SPS)
+    {
+        return false;
+    }
+    H264Sps declared;
+    if(ParseSps(nal, len, declared) && declared.hasBitstreamRestriction
+       && declared.maxNumReorderFrames > 0)
+    {
+        out.assign(nal, nal + len);
+        return true;
+    }
+    try
+    {
+        H264Sps sps;
+        BitWriter writer;
+        BitReader reader(nal + 1, len - 1);
+        reader.setEcho(&writer);
+        readSpsUntilVui(reader, sps);
+        reader.setEcho(nullptr);
+        sps.hasVui = reader.readBit();
+        writer.writeBit(1);
+        if(sps.hasVui)
+        {
+            readVui(reader, sps, &writer, fps);
+        }else
+        {
+            // a missing VUI is read as one with all flags 0
+            static const uint8_t emptyVui[] = {0x00, 0x00};
+            BitReader empty(emptyVui, sizeof(emptyVui));
+            readVui(empty, sps, &writer, fps);
+        }
+        writer.writeTrailingBits();
+        out = writer.toNalUnit(nal[0]);
+    }catch(const std::runtime_error&)
+    {
+        return false;
+    }
+    return true;
+}
+
+const uint8_t *FindStartCode(const uint8_t *data, const uint8_t *end)
+{
+    // look for the 01 with memchr, then check the two zeros in front of it
+    const uint8_t *p = data + 2;
+    while(p < end)
+    {
+        p = static_cast<const uint8_t *>(memchr(p, 0x01, end - p));
+        if(p == nullptr)
+        {
+            return end;
+        }
+        if(p[-1] == 0 && p[-2] == 0)
+        {
+            return p - 2;
+        }
+        p++;
+    }
+    return end;
+}
+
+void ForEachNalUnit(const uint8_t *data, size_t len,
+                    const std::function<void(const uint8_t *nal, size_t len)>& handler)
+{
+    const uint8_t *end = data + len;
+    const uint8_t *start = FindStartCode(data, end);
+
+    while(start < end)
+    {
+        const uint8_t *nal = start + 3;
+        const uint8_t *next = FindStartCode(nal, end);
+        const uint8_t *nalEnd = next;
+        // the zero of a 4 byte start code and trailing zeros are no payload
+        while(nalEnd > nal && nalEnd[-1] == 0)
+        {
+            nalEnd--;
+        }
+        if(nalEnd > nal)
+        {
+            handler(nal, nalEnd - nal);
+        }
+        start = next;
+    }
+}
+
+void ForEachLeadingNalUnit(const uint8_t *data, size_t len,
+                           const std::function<void(const uint8_t *nal, size_t len)>& handler)
+{
+    const uint8_t *end = data + len;
+    const uint8_t *start = FindStartCode(data, end);
+
+    while(start < end)
+    {
+        const uint8_t *nal = start + 3;
+        if(nal < end && IsVclNal(nal))
+        {
+            handler(nal, end - nal);
+            return;
+        }
+        const uint8_t *next = FindStartCode(nal, end);
+        const uint8_t *nalEnd = next;
+        while(nalEnd > nal && nalEnd[-1] == 0)
+        {
+            nalEnd--;
+        }
+        if(nalEnd > nal)
+        {
+            handler(nal, nalEnd - nal);
+        }
+        start = next;
+    }
+}
+
+bool HasRecoveryPoint(const uint8_t *sei, size_t len)
+{
+    if(len < 2 || NalTypeOf(sei) != H264NalType::SEI)
+    {
+        return false;
+    }
+    try
+    {
+        // sei_message(): payloadType and payloadSize are coded in bytes,
+        // 0xff adds 255
+        BitReader reader(sei + 1, len - 1);
+        while(reader.hasMoreData())
+        {
+            uint32_t type = 0, size = 0, byte;
+            while((byte = reader.readBits(8)) == 0xff)
+            {
+                type += 255;
+            }
+            type += byte;
+            while((byte = reader.readBits(8)) == 0xff)
+            {
+                size += 255;
+            }
+            size += byte;
+            if(type == seiRecoveryPoint)
+            {
+                return true;
+            }
+            for(uint32_t i = 0; i < size; i++)
+            {
+                reader.readBits(8);
+            }
+        }
+    }catch(const std::runtime_error&)
+    {
+    }
+    return false;
+}
+
+bool IsJoinPoint(const uint8_t *data, size_t len)
+{
+    bool isJoinPoint = false;
+    ForEachLeadingNalUnit(data, len,
+        [&isJoinPoint](const uint8_t *nal, size_t len)
+        {
+            auto type = NalTypeOf(nal);
+            if(type == H264NalType::IDR
+               || (type == H264NalType::SEI && HasRecoveryPoint(nal, len)))
+            {
+                isJoinPoint = true;
+            }
+        }
+    );
+    return isJoinPoint;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file h264_bitstream.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __H264_BITSTREAM_H
+#define __H264_BITSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+enum class H264NalType : uint8_t
+{
+    Slice = 1,
+    SliceA = 2,
+    IDR = 5,
+    SEI = 6,
+    SPS = 7,
+    PPS = 8,
+    AUD = 9
+};
+
+enum class H264SliceType : uint8_t
+{
+    P = 0,
+    B,
+    I,
+    SP,
+    SI
+};
+
+/**
+ * @brief write the bits of a NAL unit payload (RBSP), the emulation
+ * prevention bytes are inserted by toNalUnit().
+ */
+class BitWriter
+{
+    private:
+        std::vector<uint8_t> rbsp;
+        int bitsUsed;
+    public:
+        BitWriter();
+        ~BitWriter()=default;
+
+        void writeBit(uint32_t bit);
+        void writeBits(uint32_t value, int n);
+        /* unsigned exp-Golomb ue(v) */
+        void writeUE(uint32_t value);
+        /* the stop bit and the zeros up to the next byte */
+        void writeTrailingBits();
+        /**
+         * @brief the NAL unit without start code
+         */
+        std::vector<uint8_t> toNalUnit(uint8_t header);
+};
+
+/**
+ * @brief read the bits of a NAL unit payload, the emulation prevention
+ * bytes (00 00 03) are skipped while reading. It throws std::runtime_error
+ * if it reads over the end.
+ */
+class BitReader
+{
+    private:
+        const uint8_t *data;
+        size_t size;
+        size_t pos;
+        uint8_t current;
+        int bitsLeft;
+        int zeros;
+        BitWriter *echo;
+
+        void nextByte();
+    public:
+        BitReader(const uint8_t *d, size_t len);
+        ~BitReader()=default;
+
+        uint32_t readBit();
+        uint32_t readBits(int n);
+        /* unsigned exp-Golomb ue(v) */
+        uint32_t readUE();
+        /* signed exp-Golomb se(v) */
+        int32_t readSE();
+        void skipBits(int n);
+        bool isByteAligned() {return bitsLeft == 0 || bitsLeft == 8;}
+        /* more data before the rbsp trailing bits */
+        bool hasMoreData();
+        /**
+         * @brief copy every bit which is read to the writer, nullptr stops
+         * it. An exp-Golomb code is copied unchanged.
+         */
+        void setEcho(BitWriter *writer) {echo = writer;}
+};
+
+inline H264NalType NalTypeOf(const uint8_t *nal)
+{
+    return H264NalType(nal[0] & 0x1f);
+}
+
+inline uint8_t NalRefIdcOf(const uint8_t *nal)
+{
+    return (nal[0] >> 5) & 0x03;
+}
+
+inline bool IsVclNal(const uint8_t *nal)
+{
+    uint8_t type = nal[0] & 0x1f;
+    return type >= 1 && type <= 5;
+}
+
+/**
+ * @brief the first fields of a slice header, they need no SPS or PPS
+ */
+struct SliceHeaderStart
+{
+    uint32_t firstMbInSlice;
+    H264SliceType sliceType;
+    uint32_t ppsId;
+};
+
+bool ParseSliceHeaderStart(const uint8_t *nal, size_t len, SliceHeaderStart& header);
+
+/**
+ * @brief the fields of a sequence parameter set up to the VUI
+ */
+struct H264Sps
+{
+    uint8_t profileIdc;
+    uint8_t constraintFlags;
+    uint8_t levelIdc;
+    uint32_t id;
+    uint32_t chromaFormatIdc = 1;
+    uint32_t bitDepthLuma = 8;
+    uint32_t bitDepthChroma = 8;
+    uint32_t log2MaxFrameNum;
+    uint32_t picOrderCntType;
+    uint32_t maxNumRefFrames;
+    bool frameMbsOnly;
+    uint32_t width;
+    uint32_t height;
+    bool hasVui;
+    /* from the VUI, E.1.1 */
+    bool hasTimingInfo = false;
+    uint32_t numUnitsInTick = 0;
+    uint32_t timeScale = 0;
+    bool hasBitstreamRestriction = false;
+    uint32_t maxNumReorderFrames = 0;
+    uint32_t maxDecFrameBuffering = 0;
+};
+
+bool ParseSps(const uint8_t *nal, size_t len, H264Sps& sps);
+
+/**
+ * @brief rewrite the VUI of an SPS so that a decoder outputs every frame at
+ * once: bitstream_restriction with max_num_reorder_frames 0 and the
+ * smallest max_dec_frame_buffering. Without it, a decoder has to assume
+ * reordering and may hold frames until its DPB is full. The timing info is
+ * added for fps > 0 if the SPS has none, the other fields are kept.
+ * An SPS whose bitstream_restriction declares reordering (B-frames) is
+ * copied unchanged, its frames must be output in the declared order.
+ *
+ * @param out the new SPS NAL unit without start code
+ * @return false if the SPS cannot be parsed
+ */
+bool RewriteSpsForLowDelay(const uint8_t *nal, size_t len, unsigned int fps,
+                           std::vector<uint8_t>& out);
+
+/**
+ * @brief call the handler for every NAL unit of an Annex-B buffer, the NAL
+ * unit starts with its header, the start code is not passed.
+ */
+void ForEachNalUnit(const uint8_t *data, size_t len,
+                    const std::function<void(const uint8_t *nal, size_t len)>& handler);
+
+/**
+ * @brief call the handler for the NAL units of an access unit up to and
+ * including its first slice. The slice data is not scanned, the slice is
+ * passed with the rest of the buffer.
+ */
+void ForEachLeadingNalUnit(const uint8_t *data, size_t len,
+                           const std::function<void(const uint8_t *nal, size_t len)>& handler);
+
+/**
+ * @brief the SEI NAL unit has a recovery point message, a decoder which
+ * starts at its access unit shows correct pictures after a few frames.
+ */
+bool HasRecoveryPoint(const uint8_t *sei, size_t len);
+
+/**
+ * @brief a decoder can start at the access unit of an Annex-B buffer: it
+ * has an IDR slice or a recovery point SEI.
+ */
+bool IsJoinPoint(const uint8_t *data, size_t len);
+
+/**
+ * @brief the position of the next 3 byte start code at or after data,
+ * or end if there is none.
+ */
+const uint8_t *FindStartCode(const uint8_t *data, const uint8_t *end);
+
+#endif /* __H264_BITSTREAM_H */
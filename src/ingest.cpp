@@ -0,0 +1,380 @@
+/**
+ * @file ingest.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "ingest.hpp"
+#include "h264_bitstream.hpp"
+#include "utility.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#include <nlohmann/json.hpp>
+
+static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+
+/* the buffer is compacted if less is free, a pipe delivers 64 KiB at most */
+constexpr size_t minReadSize = 64 * 1024;
+/* how long handleLoop waits without a pending slice */
+constexpr int idleTimeout_ms = 500;
+
+AnnexBSource::AnnexBSource(const std::string& s, size_t bufferSize,
+                           size_t maxAU, int flushTimeout):
+source(s), listenFd(-1), fd(-1), buffer(std::max(bufferSize, 2 * minReadSize)),
+fill(0), nalStart(0), scanPos(0), hasNal(false), maxAccessUnit(maxAU),
+hasVcl(false), isDiscarding(false), flushTimeout_ms(flushTimeout),
+bytesRead(0), accessUnits(0), dropped(0), connections(0)
+{
+    if(source == "stdin" || source == "-")
+    {
+        kind = Kind::Stdin;
+    }else if(source.rfind("unix:", 0) == 0)
+    {
+        kind = Kind::Socket;
+        source = source.substr(5);
+    }else
+    {
+        kind = Kind::Fifo;
+    }
+    accessUnit.reserve(std::min(maxAccessUnit, size_t(1024 * 1024)));
+}
+
+AnnexBSource::~AnnexBSource()
+{
+    close();
+}
+
+void AnnexBSource::open()
+{
+    resetParser();
+    switch(kind)
+    {
+        case Kind::Stdin:
+        {
+            fd = STDIN_FILENO;
+            break;
+        }
+        case Kind::Socket:
+        {
+            sockaddr_un address{};
+            if(source.size() >= sizeof(address.sun_path))
+            {
+                throw std::invalid_argument("the socket path is too long: " + source);
+            }
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, source.c_str(), sizeof(address.sun_path) - 1);
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            unlink(source.c_str());
+            if(listenFd < 0
+               || bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0
+               || listen(listenFd, 1) < 0)
+            {
+                int error = errno;
+                close();
+                throw std::system_error(error, std::generic_category(), "cannot listen on " + source);
+            }
+            break;
+        }
+        case Kind::Fifo:
+        {
+            struct stat st;
+            if(stat(source.c_str(), &st) < 0)
+            {
+                if(mkfifo(source.c_str(), 0660) < 0)
+                {
+                    throw std::system_error(errno, std::generic_category(), "cannot create " + source);
+                }
+            }else if(!S_ISFIFO(st.st_mode))
+            {
+                throw std::invalid_argument(source + " is no FIFO.");
+            }
+            // read and write, the FIFO has no end if the encoder restarts
+            fd = ::open(source.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+            if(fd < 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "cannot open " + source);
+            }
+            break;
+        }
+    }
+    APP_MESSAGE("read the H.264 stream from %s.", source.c_str());
+}
+
+void AnnexBSource::close()
+{
+    if(fd >= 0 && kind != Kind::Stdin)
+    {
+        ::close(fd);
+    }
+    fd = -1;
+    if(listenFd >= 0)
+    {
+        ::close(listenFd);
+        listenFd = -1;
+        unlink(source.c_str());
+    }
+}
+
+bool AnnexBSource::acceptProducer()
+{
+    fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if(fd < 0)
+    {
+        ERROR_MESSAGE("cannot accept the encoder: %s", strerror(errno));
+        return false;
+    }
+    connections++;
+    resetParser();
+    APP_MESSAGE("an encoder has connected to %s.", source.c_str());
+    return true;
+}
+
+void AnnexBSource::closeProducer()
+{
+    ::close(fd);
+    fd = -1;
+    resetParser();
+    APP_MESSAGE("the encoder has disconnected from %s.", source.c_str());
+}
+
+void AnnexBSource::resetParser()
+{
+    fill = 0;
+    nalStart = 0;
+    scanPos = 0;
+    hasNal = false;
+    accessUnit.clear();
+    hasVcl = false;
+    isDiscarding = false;
+}
+
+void AnnexBSource::handleLoop()
+{
+    if(kind == Kind::Socket && fd < 0)
+    {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if(poll(&pfd, 1, idleTimeout_ms) > 0)
+        {
+            acceptProducer();
+        }
+        return;
+    }
+
+    // a slice at the end of the buffer is probably the end of its frame
+    bool isSlicePending = flushTimeout_ms > 0 && hasNal && fill > nalStart + 3
+                          && IsVclNal(buffer.data() + nalStart + 3);
+    pollfd pfd{fd, POLLIN, 0};
+    int r = poll(&pfd, 1, isSlicePending ? flushTimeout_ms : idleTimeout_ms);
+    if(r < 0)
+    {
+        if(errno == EINTR)
+        {
+            return;
+        }
+        throw std::system_error(errno, std::generic_category(), "poll:");
+    }else if(r == 0)
+    {
+        if(isSlicePending)
+        {
+            flush();
+        }
+        return;
+    }
+
+    ssize_t len = read(fd, buffer.data() + fill, buffer.size() - fill);
+    if(len < 0)
+    {
+        if(errno == EINTR || errno == EAGAIN)
+        {
+            return;
+        }
+        if(kind == Kind::Socket)
+        {
+            ERROR_MESSAGE("cannot read from the encoder: %s", strerror(errno));
+            closeProducer();
+            return;
+        }
+        throw std::system_error(errno, std::generic_category(), "read:");
+    }else if(len == 0)
+    {
+        flush();
+        if(kind == Kind::Socket)
+        {
+            closeProducer();
+            return;
+        }
+        throw std::runtime_error("the end of the H.264 stream.");
+    }
+    fill += len;
+    bytesRead += len;
+    parse();
+}
+
+void AnnexBSource::parse()
+{
+    uint8_t *begin = buffer.data();
+    const uint8_t *end = begin + fill;
+    if(!hasNal)
+    {
+        auto start = FindStartCode(begin + scanPos, end);
+        if(start == end)
+        {
+            // no start code yet, keep the bytes which can be the start of one
+            size_t keep = std::min(fill, size_t(2));
+            memmove(begin, end - keep, keep);
+            fill = keep;
+            scanPos = 0;
+            return;
+        }
+        nalStart = start - begin;
+        scanPos = nalStart + 3;
+        hasNal = true;
+    }
+
+    while(true)
+    {
+        auto next = FindStartCode(begin + scanPos, end);
+        if(next == end)
+        {
+            break;
+        }
+        addNalUnit(begin + nalStart + 3, next);
+        nalStart = next - begin;
+        scanPos = nalStart + 3;
+    }
+    // the next read can complete a start code at the end
+    if(fill >= 2)
+    {
+        scanPos = std::max(scanPos, fill - 2);
+    }
+
+    if(buffer.size() - fill >= minReadSize)
+    {
+        return;
+    }
+    // only the incomplete NAL unit is moved, once per buffer
+    memmove(begin, begin + nalStart, fill - nalStart);
+    fill -= nalStart;
+    scanPos -= nalStart;
+    nalStart = 0;
+    if(buffer.size() - fill < minReadSize)
+    {
+        ERROR_MESSAGE("a NAL unit is larger than the buffer (%zu bytes), drop it.",
+            buffer.size());
+        dropped++;
+        accessUnit.clear();
+        hasVcl = false;
+        isDiscarding = true;
+        hasNal = false;
+        memmove(begin, begin + fill - 2, 2);
+        fill = 2;
+        scanPos = 0;
+    }
+}
+
+void AnnexBSource::addNalUnit(const uint8_t *nal, const uint8_t *end)
+{
+    // the zero of a following 4 byte start code and trailing zeros
+    while(end > nal && end[-1] == 0)
+    {
+        end--;
+    }
+    if(end == nal)
+    {
+        return;
+    }
+    size_t len = end - nal;
+
+    if(hasVcl || isDiscarding)
+    {
+        // the first NAL unit of the next access unit, 7.4.1.2.3
+        bool isFirst;
+        if(IsVclNal(nal))
+        {
+            SliceHeaderStart header;
+            isFirst = ParseSliceHeaderStart(nal, len, header) && header.firstMbInSlice == 0;
+        }else
+        {
+            uint8_t type = nal[0] & 0x1f;
+            isFirst = (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+        }
+        if(isFirst)
+        {
+            endAccessUnit();
+        }
+    }
+    if(isDiscarding)
+    {
+        return;
+    }
+
+    if(accessUnit.size() + sizeof(startCode) + len > maxAccessUnit)
+    {
+        ERROR_MESSAGE("an access unit is larger than %zu bytes, drop it.", maxAccessUnit);
+        dropped++;
+        accessUnit.clear();
+        hasVcl = false;
+        isDiscarding = true;
+        return;
+    }
+    accessUnit.insert(accessUnit.end(), startCode, startCode + sizeof(startCode));
+    accessUnit.insert(accessUnit.end(), nal, end);
+    if(IsVclNal(nal))
+    {
+        hasVcl = true;
+    }
+}
+
+void AnnexBSource::endAccessUnit()
+{
+    if(hasVcl && !isDiscarding && onSample)
+    {
+        onSample(accessUnit.data(), accessUnit.size());
+        accessUnits++;
+    }
+    accessUnit.clear();
+    hasVcl = false;
+    isDiscarding = false;
+}
+
+void AnnexBSource::flush()
+{
+    if(hasNal)
+    {
+        addNalUnit(buffer.data() + nalStart + 3, buffer.data() + fill);
+        hasNal = false;
+        fill = 0;
+        scanPos = 0;
+    }
+    if(hasVcl || isDiscarding)
+    {
+        endAccessUnit();
+    }
+}
+
+std::string AnnexBSource::getStatistics()
+{
+    nlohmann::ordered_json json;
+    json["bytes"] = bytesRead.load();
+    json["accessUnits"] = accessUnits.load();
+    json["dropped"] = dropped.load();
+    json["connections"] = connections.load();
+    return json.dump();
+}
@@ -0,0 +1,105 @@
+/**
+ * @file ingest.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __INGEST_H
+#define __INGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief reads an H.264 Annex-B byte stream of an external encoder, e.g.
+ * libcamera-vid or gstreamer, and hands it on in access units like the
+ * V4L2 capture: one call of onSample per frame, every NAL unit with a 4
+ * byte start code, the parameter sets in front of their slice.
+ *
+ * the source is
+ *   "stdin" or "-"     the standard input, the end of it ends the stream
+ *   "unix:/path"       a Unix stream socket, one encoder at a time connects
+ *   "/path"            a FIFO, the encoder can be restarted
+ *
+ * The input is read into a fixed buffer and only if the previous access
+ * unit has been handed on, so a slow consumer blocks the encoder in its
+ * write instead of growing the memory.
+ */
+class AnnexBSource
+{
+    private:
+        enum class Kind
+        {
+            Stdin,
+            Socket,
+            Fifo
+        };
+        std::string source;
+        Kind kind;
+        int listenFd;
+        int fd;
+
+        std::vector<uint8_t> buffer;
+        size_t fill;
+        /* the start code of the current NAL unit in buffer, if hasNal */
+        size_t nalStart;
+        /* where the search for the next start code continues */
+        size_t scanPos;
+        bool hasNal;
+
+        std::vector<uint8_t> accessUnit;
+        size_t maxAccessUnit;
+        bool hasVcl;
+        bool isDiscarding;
+        int flushTimeout_ms;
+
+        std::atomic<uint64_t> bytesRead;
+        std::atomic<uint64_t> accessUnits;
+        std::atomic<uint64_t> dropped;
+        std::atomic<uint64_t> connections;
+
+        bool acceptProducer();
+        void closeProducer();
+        void resetParser();
+        void parse();
+        void addNalUnit(const uint8_t *nal, const uint8_t *end);
+        void endAccessUnit();
+        void flush();
+    public:
+        AnnexBSource(const std::string& source, size_t bufferSize=2*1024*1024,
+                     size_t maxAccessUnit=4*1024*1024, int flushTimeout_ms=0);
+        ~AnnexBSource();
+        AnnexBSource(const AnnexBSource&)=delete;
+        AnnexBSource& operator=(const AnnexBSource&)=delete;
+
+        /* an access unit, it starts with a start code */
+        std::function<void(void *, size_t)> onSample = nullptr;
+
+        void open();
+        void close();
+        /**
+         * @brief wait for input and hand on the complete access units, it
+         * returns at least every 500 ms. It throws at the end of stdin.
+         *
+         * An access unit ends with the first NAL unit of the next one, a
+         * frame is handed on when the next one starts (flushTimeout_ms 0).
+         * For low latency sources which write every frame at once,
+         * flushTimeout_ms > 0 takes a slice as the end of its frame if no
+         * data arrives for that time. A pause in a large frame cuts it
+         * then, so it is opt-in.
+         */
+        void handleLoop();
+        std::string getStatistics();
+};
+
+#endif /* __INGEST_H */
@@ -18,18 +18,123 @@
 #include <functional>
 #include <optional>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 #include <rtc/rtc.hpp>
 #include <nlohmann/json.hpp>
 
 #include "capture.hpp"
+#include "certificate.hpp"
+#include "framebus.hpp"
+#include "governor.hpp"
+#include "h264_bitstream.hpp"
+#include "ingest.hpp"
+#include "motion.hpp"
+#include "recorder.hpp"
 #include "utility.h"
 #include "session.hpp"
+#include "signaling.hpp"
+#include "whep.hpp"
 #include "mqtt_connect.hpp"
 
-bool awaitExit = false;
+std::atomic<bool> awaitExit{false};
 int count=0;
 
+/**
+ * @brief a lower resolution encoding of a simulcast camera, e.g. the
+ * second output of the ISP with its own encoder
+ */
+struct SimulcastEncoding
+{
+    std::shared_ptr<VideoCapture> camera;
+    std::shared_ptr<H264VideoStream> videoStream;
+    std::thread loop;
+};
+
+/**
+ * @brief a camera with its own sessions, all cameras share one MQTT
+ * connection
+ */
+struct CameraStream
+{
+    std::string name;
+    std::shared_ptr<VideoCapture> camera;
+    /* instead of the camera, the stream of an external encoder */
+    std::unique_ptr<AnnexBSource> ingest;
+    std::shared_ptr<H264VideoStream> videoStream;
+    std::unique_ptr<RTCPeerSessionManager> peers;
+    std::unique_ptr<MotionDetector> motion;
+    std::unique_ptr<Recorder> recorder;
+    std::unique_ptr<FrameBus> bus;
+    /* frames of an intra refresh cycle and between IDRs, 0 is off */
+    unsigned int intraRefreshPeriod = 0;
+    unsigned int idrPeriod = 0;
+    /* slices of a frame, single or limited by macroblocks or bytes */
+    H264SliceMode sliceMode = H264SliceMode::Single;
+    unsigned int sliceLimit = 0;
+    /* temporal layers of hierarchical-P, 1 is off */
+    unsigned int temporalLayers = 1;
+    /* the viewers are switched between the encodings, the largest first */
+    std::vector<std::unique_ptr<SimulcastEncoding>> encodings;
+    std::thread loop;
+};
+
+VideoCapture::WindowsSize windowOf(const std::string& resolution)
+{
+    if(resolution == "1080p")
+    {
+        return VideoCapture::WindowsSize::pixel_1080p;
+    }else if(resolution == "5MP")
+    {
+        return VideoCapture::WindowsSize::pixel_5MP;
+    }else if(resolution == "360p")
+    {
+        return VideoCapture::WindowsSize::pixel_360p;
+    }else if(resolution == "180p")
+    {
+        return VideoCapture::WindowsSize::pixel_180p;
+    }
+    return VideoCapture::WindowsSize::pixel_720p;
+}
+
+void captureLoop(CameraStream *stream)
+{
+    try
+    {
+        while(!awaitExit)
+        {
+            if(stream->ingest)
+            {
+                stream->ingest->handleLoop();
+            }else
+            {
+                stream->camera->handleLoop();
+            }
+        }
+    }catch(const std::exception& e)
+    {
+        ERROR_MESSAGE("camera %s stops: %s", stream->name.c_str(), e.what());
+        awaitExit = true;
+    }
+}
+
+void encodingLoop(CameraStream *stream, SimulcastEncoding *encoding)
+{
+    try
+    {
+        while(!awaitExit)
+        {
+            encoding->camera->handleLoop();
+        }
+    }catch(const std::exception& e)
+    {
+        ERROR_MESSAGE("an encoding of camera %s stops: %s", stream->name.c_str(), e.what());
+        awaitExit = true;
+    }
+}
+
 void signal_handler(int sig){
     APP_MESSAGE("programm will exit...");
     awaitExit = true;
@@ -43,9 +148,13 @@ int main(int argc, char *argv[]) {
     FILE *configFile;
     rtc::Configuration rtcConfig;
     std::shared_ptr<MqttConnect> mqttConn;
-    std::shared_ptr<VideoCapture> camera;
-    std::shared_ptr<H264VideoStream> videoStream;
-    std::unique_ptr<RTCPeerSessionManager> peers;
+    std::unique_ptr<SignalingRouter> router;
+    std::vector<std::unique_ptr<CameraStream>> streams;
+    /* after the streams, it is destroyed before their session managers */
+    std::unique_ptr<WhepServer> whep;
+    RTCPeerSessionLimits sessionLimits;
+    std::shared_ptr<ResourceGovernor> governor;
+    std::shared_ptr<DtlsCertificate> certificate;
 
     signal(SIGINT, signal_handler);
     
@@ -72,19 +181,380 @@ int main(int argc, char *argv[]) {
             rtcConfig.iceServers.emplace_back(rtc::IceServer(url));
         }
 
-        camera = std::make_shared<VideoCapture>("/dev/video0");
+        if(configJson.contains("ice"))
+        {
+            // all sessions share one UDP port, libjuice demultiplexes
+            // the peers by ICE ufrag and remote address. It saves ports
+            // and firewall rules, the packets are still received and sent
+            // one by one by libjuice.
+            auto iceJson = configJson["ice"];
+            rtcConfig.enableIceUdpMux = iceJson.value("udpMux", false);
+            if(rtcConfig.enableIceUdpMux)
+            {
+                if(iceJson.contains("port"))
+                {
+                    rtcConfig.portRangeBegin = iceJson["port"].get<uint16_t>();
+                    rtcConfig.portRangeEnd = rtcConfig.portRangeBegin;
+                }
+                APP_MESSAGE("all sessions share the UDP port %u.",
+                    unsigned(rtcConfig.portRangeBegin));
+            }else if(iceJson.contains("portRange"))
+            {
+                // without the mux every session needs its own port
+                auto rangeJson = iceJson["portRange"];
+                rtcConfig.portRangeBegin = rangeJson.value("begin", rtcConfig.portRangeBegin);
+                rtcConfig.portRangeEnd = rangeJson.value("end", rtcConfig.portRangeEnd);
+            }else if(iceJson.contains("port"))
+            {
+                ERROR_MESSAGE("ice.port needs ice.udpMux, the default port range is used.");
+            }
+        }
+
+        if(configJson.contains("dtls"))
+        {
+            auto dtlsJson = configJson["dtls"];
+            certificate = std::make_shared<DtlsCertificate>(
+                dtlsJson["certificate"].get<std::string>(),
+                dtlsJson["key"].get<std::string>(),
+                dtlsJson.value("validityDays", 365u),
+                dtlsJson.value("rotationDays", 30u));
+            certificate->applyTo(rtcConfig);
+        }
+
+        if(configJson.contains("sessions"))
+        {
+            auto sessionsJson = configJson["sessions"];
+            sessionLimits.maxSessions =
+                sessionsJson.value("maxSessions", sessionLimits.maxSessions);
+            sessionLimits.reapInterval = std::chrono::seconds(
+                sessionsJson.value("reapInterval", 5));
+            sessionLimits.reportInterval = std::chrono::seconds(
+                sessionsJson.value("reportInterval", 60));
+            sessionLimits.gatherTimeout = std::chrono::milliseconds(
+                sessionsJson.value("gatherTimeout", 5000));
+            sessionLimits.nackHistory = std::chrono::milliseconds(
+                sessionsJson.value("nackHistory", 1000));
+            if(sessionsJson.contains("playoutDelay"))
+            {
+                // e.g. {"min": 0, "max": 0} to render every frame at once
+                auto delayJson = sessionsJson["playoutDelay"];
+                sessionLimits.minPlayoutDelay_ms = delayJson.value("min", 0);
+                sessionLimits.maxPlayoutDelay_ms =
+                    delayJson.value("max", sessionLimits.minPlayoutDelay_ms);
+            }
+            if(sessionsJson.contains("pacing"))
+            {
+                auto pacingJson = sessionsJson["pacing"];
+                sessionLimits.isPaced = pacingJson.value("enable", true);
+                sessionLimits.pacing.fraction =
+                    pacingJson.value("fraction", sessionLimits.pacing.fraction);
+                sessionLimits.pacing.rate_kbps =
+                    pacingJson.value("rate", sessionLimits.pacing.rate_kbps);
+                sessionLimits.pacing.burst_bytes =
+                    pacingJson.value("burst", sessionLimits.pacing.burst_bytes);
+            }
+            if(sessionsJson.contains("fec"))
+            {
+                sessionLimits.hasFec = sessionsJson["fec"].value("enable", true);
+            }
+            for(size_t i = 0; i < ROAPSessionStateNum; i++)
+            {
+                auto name = StrOfSessionState(ROAPSessionState(i));
+                if(sessionsJson.contains("timeout")
+                   && sessionsJson["timeout"].contains(name))
+                {
+                    sessionLimits.stateTimeout[i] = std::chrono::seconds(
+                        sessionsJson["timeout"][name].get<int>());
+                }
+            }
+        }
 
-        camera->setWindow(VideoCapture::WindowsSize::pixel_720p);
-        camera->openDevice();
-        camera->checkDevCap();
-        camera->checkAllContol();
-        camera->checkVideoFormat();
+        if(configJson.contains("governor"))
+        {
+            // one budget for the viewers of all cameras
+            auto governorJson = configJson["governor"];
+            ResourceBudget budget;
+            std::map<std::string, int> classes;
+            budget.cpuCores = governorJson.value("cpuCores", budget.cpuCores);
+            budget.egress_kbps = governorJson.value("egress", budget.egress_kbps);
+            budget.viewerCpu = governorJson.value("viewerCpu", budget.viewerCpu);
+            budget.viewerEgress_kbps =
+                governorJson.value("viewerEgress", budget.viewerEgress_kbps);
+            if(governorJson.contains("classes"))
+            {
+                for(auto& item: governorJson["classes"].items())
+                {
+                    classes[item.key()] = item.value().get<int>();
+                }
+            }
+            governor = std::make_shared<ResourceGovernor>(budget, classes);
+        }
 
-        auto fps = camera->getVideoStreamFps();
-        videoStream = std::make_shared<H264VideoStream>(fps);
         mqttConn = std::make_shared<MqttConnect>(
-            mqttURL, mqttClientId,mqttUsername, mqttPassword);
-        peers = std::make_unique<RTCPeerSessionManager>(std::move(rtcConfig), mqttConn, videoStream);
+            mqttURL, mqttClientId,mqttUsername, mqttPassword,
+            configJson["mqtt"].value("maxPendingMessages", 64u),
+            configJson["mqtt"].value("maxBufferedMessages", 256u));
+        mqttConn->setDefaultQos(configJson["mqtt"].value("qos", 0));
+        if(configJson["mqtt"].contains("topicQos"))
+        {
+            for(auto& item: configJson["mqtt"]["topicQos"].items())
+            {
+                mqttConn->setTopicQos(item.key(), item.value().get<int>());
+            }
+        }
+        router = std::make_unique<SignalingRouter>(mqttConn);
+
+        // "streams" lists all cameras, a single "video" is named camera
+        std::vector<nlohmann::json> streamConfigs;
+        if(configJson.contains("streams"))
+        {
+            for(auto& item: configJson["streams"])
+            {
+                streamConfigs.push_back(item);
+            }
+        }else
+        {
+            auto item = configJson["video"];
+            item["name"] = "camera";
+            streamConfigs.push_back(item);
+        }
+
+        for(auto& item: streamConfigs)
+        {
+            auto stream = std::make_unique<CameraStream>();
+            stream->name = item["name"].get<std::string>();
+            unsigned int fps;
+            if(item.value("input", "v4l2") == "annexb")
+            {
+                // e.g. libcamera-vid -t 0 --inline -o - | camera
+                auto ingestJson = item.value("ingest", nlohmann::json::object());
+                stream->ingest = std::make_unique<AnnexBSource>(
+                    item.value("source", "stdin"),
+                    ingestJson.value("buffer", 2u) * 1024 * 1024,
+                    ingestJson.value("maxFrame", 4u) * 1024 * 1024,
+                    ingestJson.value("flushTimeout", 0));
+                fps = item.value("fps", 30u);
+            }else
+            {
+                stream->camera = std::make_shared<VideoCapture>(
+                    item.value("source", "/dev/video0"));
+
+                stream->camera->setWindow(windowOf(item.value("resolution", "720p")));
+                stream->camera->openDevice();
+                stream->camera->checkDevCap();
+                stream->camera->checkAllContol();
+                stream->camera->checkVideoFormat();
+
+                fps = stream->camera->getVideoStreamFps();
+            }
+            stream->videoStream = std::make_shared<H264VideoStream>(fps);
+            // browsers hold frames for an SPS without bitstream_restriction
+            stream->videoStream->setLowDelaySps(item.value("lowDelaySps", false));
+            stream->peers = std::make_unique<RTCPeerSessionManager>(
+                stream->name, rtc::Configuration(rtcConfig), mqttConn,
+                stream->videoStream, sessionLimits, governor);
+            stream->peers->certificate = certificate;
+            router->addStream(stream->name, stream->peers.get());
+
+            if(item.contains("slices"))
+            {
+                // e.g. {"mode": "bytes", "limit": 1100}, a slice per RTP packet
+                auto slicesJson = item["slices"];
+                auto mode = slicesJson.value("mode", "single");
+                if(mode == "bytes")
+                {
+                    stream->sliceMode = H264SliceMode::MaxBytes;
+                    stream->sliceLimit = slicesJson.value("limit", 1100u);
+                }else if(mode == "macroblocks")
+                {
+                    stream->sliceMode = H264SliceMode::MaxMacroblocks;
+                    stream->sliceLimit = slicesJson.value("limit", 396u);
+                }
+            }
+
+            // 2 drops the non-reference frames for slow viewers, 3 also the middle layer
+            stream->temporalLayers = item.value("temporalLayers", 1u);
+            stream->videoStream->setTemporalLayers(stream->temporalLayers);
+
+            if(item.contains("intraRefresh"))
+            {
+                // the viewers join at a recovery point instead of an IDR burst
+                auto refreshJson = item["intraRefresh"];
+                stream->intraRefreshPeriod = refreshJson.value("period", fps);
+                stream->idrPeriod = refreshJson.value("idrPeriod", 0u);
+                stream->videoStream->setJoinAtRecoveryPoint(true,
+                    std::chrono::milliseconds(refreshJson.value("maxJoinWait", 3000)));
+            }
+
+            if(item.contains("simulcast") && stream->ingest)
+            {
+                ERROR_MESSAGE("camera %s: simulcast needs v4l2 input.", stream->name.c_str());
+            }else if(item.contains("simulcast"))
+            {
+                // e.g. [{"source": "/dev/video2", "resolution": "360p"}], each
+                // encoding has its own encoder with the settings of the camera
+                stream->peers->encodings.push_back({stream->videoStream,
+                    stream->camera->getWidth(), stream->camera->getHeight()});
+                for(auto& encodingJson: item["simulcast"])
+                {
+                    auto encoding = std::make_unique<SimulcastEncoding>();
+                    encoding->camera = std::make_shared<VideoCapture>(
+                        encodingJson.value("source", "/dev/video1"));
+                    encoding->camera->setWindow(windowOf(encodingJson.value("resolution", "360p")));
+                    encoding->camera->openDevice();
+                    encoding->camera->checkDevCap();
+                    encoding->camera->checkAllContol();
+                    encoding->camera->checkVideoFormat();
+
+                    encoding->videoStream = std::make_shared<H264VideoStream>(
+                        encoding->camera->getVideoStreamFps());
+                    encoding->videoStream->setLowDelaySps(item.value("lowDelaySps", false));
+                    encoding->videoStream->setTemporalLayers(stream->temporalLayers);
+                    if(item.contains("intraRefresh"))
+                    {
+                        encoding->videoStream->setJoinAtRecoveryPoint(true,
+                            std::chrono::milliseconds(item["intraRefresh"].value("maxJoinWait", 3000)));
+                    }
+                    stream->encodings.push_back(std::move(encoding));
+                }
+                std::stable_sort(stream->encodings.begin(), stream->encodings.end(),
+                    [](const std::unique_ptr<SimulcastEncoding>& a,
+                       const std::unique_ptr<SimulcastEncoding>& b)
+                    {
+                        return a->camera->getWidth() > b->camera->getWidth();
+                    }
+                );
+                for(auto& encoding: stream->encodings)
+                {
+                    stream->peers->encodings.push_back({encoding->videoStream,
+                        encoding->camera->getWidth(), encoding->camera->getHeight()});
+                }
+            }
+
+            if(item.contains("timeshift"))
+            {
+                // allocated once, the oldest samples are overwritten
+                auto timeShiftJson = item["timeshift"];
+                auto timeShift = std::make_shared<TimeShiftBuffer>(
+                    timeShiftJson.value("memory", 32u) * 1024 * 1024,
+                    timeShiftJson.value("maxUnits", 16384u));
+                stream->peers->timeShift = timeShift;
+                stream->videoStream->addSink("timeshift",
+                    [timeShift](const NALUnit& sample, uint64_t time_us)
+                    {
+                        timeShift->append(sample, time_us);
+                    }
+                );
+            }
+
+            if(item.contains("record"))
+            {
+                auto recordJson = item["record"];
+                RecorderConfig recorderConfig;
+                recorderConfig.name = stream->name;
+                recorderConfig.directory = recordJson.value("directory", recorderConfig.directory);
+                recorderConfig.isMotionTriggered = recordJson.value("motion", false);
+                recorderConfig.segmentDuration = std::chrono::seconds(
+                    recordJson.value("segment", 300));
+                recorderConfig.preEvent = std::chrono::seconds(recordJson.value("preEvent", 5));
+                recorderConfig.postEvent = std::chrono::seconds(recordJson.value("postEvent", 10));
+                recorderConfig.maxSegments = recordJson.value("maxSegments", 0u);
+                recorderConfig.maxFragmentDuration = std::chrono::seconds(
+                    recordJson.value("maxFragment", 10));
+                recorderConfig.maxFragmentBytes =
+                    size_t(recordJson.value("maxFragmentSize", 8u)) * 1024 * 1024;
+                recorderConfig.useDirectIO = recordJson.value("directIO", true);
+                recorderConfig.maxQueuedBytes =
+                    size_t(recordJson.value("maxQueued", 32u)) * 1024 * 1024;
+                stream->recorder = std::make_unique<Recorder>(recorderConfig);
+
+                auto recorder = stream->recorder.get();
+                stream->videoStream->addSink("record",
+                    [recorder](const NALUnit& sample, uint64_t time_us)
+                    {
+                        recorder->onSample(sample, time_us);
+                    }
+                );
+            }
+
+            if(item.contains("motion"))
+            {
+                auto motionJson = item["motion"];
+                MotionConfig motionConfig;
+                motionConfig.startRatio = motionJson.value("startRatio", motionConfig.startRatio);
+                motionConfig.stopRatio = motionJson.value("stopRatio", motionConfig.stopRatio);
+                motionConfig.startFrames = motionJson.value("startFrames", motionConfig.startFrames);
+                motionConfig.holdTime = std::chrono::milliseconds(
+                    motionJson.value("holdTime", 2000));
+                stream->motion = std::make_unique<MotionDetector>(motionConfig);
+
+                auto motion = stream->motion.get();
+                auto recorder = stream->recorder.get();
+                auto topic = "webrtc/event/" + stream->name;
+                motion->onEvent = [mqttConn, motion, recorder, topic](
+                    bool start, double score, uint64_t time_us)
+                {
+                    if(recorder)
+                    {
+                        recorder->setEvent(start);
+                    }
+                    auto json = nlohmann::json::parse(motion->getStatistics());
+                    json["event"] = start ? "motionStart" : "motionStop";
+                    json["score"] = score;
+                    json["time"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+                    mqttConn->publishMessage(topic, json.dump());
+                };
+                stream->videoStream->addSink("motion",
+                    [motion](const NALUnit& sample, uint64_t time_us)
+                    {
+                        motion->onSample(sample, time_us);
+                    }
+                );
+            }
+            if(item.contains("bus"))
+            {
+                // the samples for local consumers, e.g. an analytics process
+                auto busJson = item["bus"];
+                stream->bus = std::make_unique<FrameBus>(
+                    busJson.value("socket", "/tmp/camera-" + stream->name + ".sock"),
+                    busJson.value("memory", 16u) * 1024 * 1024,
+                    busJson.value("slots", 256u));
+                auto bus = stream->bus.get();
+                stream->videoStream->addSink("bus",
+                    [bus](const NALUnit& sample, uint64_t time_us)
+                    {
+                        uint32_t flags = 0;
+                        ForEachNalUnit(reinterpret_cast<const uint8_t *>(sample.data()),
+                            sample.size(), [&flags](const uint8_t *nal, size_t len)
+                            {
+                                auto type = NalTypeOf(nal);
+                                if(type == H264NalType::SPS || type == H264NalType::IDR)
+                                {
+                                    flags |= FrameBusKeyFrame;
+                                }
+                            }
+                        );
+                        bus->publish(sample.data(), sample.size(), time_us, flags);
+                    }
+                );
+            }
+            streams.push_back(std::move(stream));
+        }
+
+        if(configJson.contains("whep"))
+        {
+            // viewers can join over HTTP as well, beside ROAP over MQTT
+            auto whepJson = configJson["whep"];
+            whep = std::make_unique<WhepServer>(
+                whepJson.value("port", 8080),
+                whepJson.value("address", "0.0.0.0"),
+                whepJson.value("maxConnections", 8u));
+            for(auto& stream: streams)
+            {
+                whep->addStream(stream->name, stream->peers.get());
+            }
+        }
 
         rtc::InitLogger(rtc::LogLevel::Error, 
             [](rtc::LogLevel logLevel, std::string msg){
@@ -122,50 +592,140 @@ int main(int argc, char *argv[]) {
         rtc::Preload();
 
         mqttConn->onMessage =
-        [&peers](std::string topic, std::string message)
+        [&router](std::string topic, std::string message)
         {
-            peers->loopHandler(); 
-            if(topic.compare("webrtc/notify/camera") == 0)
+            try
             {
-                peers->createRTCPeerSession();
-            }else if(topic.compare("webrtc/roap/camera") == 0)
+                router->processMessage(topic, message);
+            }catch(const std::exception& e)
             {
-                peers->processMessage(message);
-            }       
+                ERROR_MESSAGE("drop the message on %s: %s", topic.c_str(), e.what());
+            }
         };
 
-        mqttConn->subscribeTopic("webrtc/notify/camera");
-        mqttConn->subscribeTopic("webrtc/roap/camera");
+        router->subscribe();
 
-
-        camera->onSample = [&videoStream](void *data, size_t len)
+        for(auto& stream: streams)
         {
-            videoStream->onDataHandle(reinterpret_cast<std::byte *>(data), len);
-        };
-        camera->setVideoFormat();
-        camera->setH264ProfileAndLevel(H264Profile::Constrained_Baseline,
-                                       H264Level::Level3_1);
-        camera->initMmap();
-        camera->start();
+            auto videoStream = stream->videoStream;
+            if(stream->ingest)
+            {
+                stream->ingest->onSample = [videoStream](void *data, size_t len)
+                {
+                    videoStream->onDataHandle(reinterpret_cast<std::byte *>(data), len);
+                };
+                stream->ingest->open();
+                stream->loop = std::thread(captureLoop, stream.get());
+                continue;
+            }
+            auto startEncoder = [&stream](const std::shared_ptr<VideoCapture>& capture,
+                                          const std::shared_ptr<H264VideoStream>& encoded)
+            {
+                auto camera = capture.get();
+                capture->onSample = [encoded, camera](void *data, size_t len)
+                {
+                    encoded->onDataHandle(reinterpret_cast<std::byte *>(data), len,
+                                          camera->getCaptureTime_us());
+                };
+                capture->setVideoFormat();
+                capture->setH264ProfileAndLevel(H264Profile::Constrained_Baseline,
+                                                H264Level::Level3_1);
+                if(stream->intraRefreshPeriod > 0)
+                {
+                    capture->setIntraRefresh(stream->intraRefreshPeriod, stream->idrPeriod);
+                }
+                if(stream->sliceMode != H264SliceMode::Single)
+                {
+                    capture->setMultiSlice(stream->sliceMode, stream->sliceLimit);
+                }
+                if(stream->temporalLayers > 2
+                   && !capture->setTemporalLayers(stream->temporalLayers))
+                {
+                    // the middle layer needs hierarchical-P, the non-reference frames do not
+                    encoded->setTemporalLayers(2);
+                }
+                if(!stream->encodings.empty())
+                {
+                    // a viewer which is switched to the encoding waits for its IDR
+                    std::weak_ptr<VideoCapture> weak = capture;
+                    encoded->onKeyframeRequest([weak]()
+                        {
+                            if(auto camera = weak.lock())
+                            {
+                                camera->forceKeyframe();
+                            }
+                        }
+                    );
+                }
+                capture->initMmap();
+                capture->start();
+            };
+            startEncoder(stream->camera, videoStream);
+            stream->loop = std::thread(captureLoop, stream.get());
+            for(auto& encoding: stream->encodings)
+            {
+                startEncoder(encoding->camera, encoding->videoStream);
+                encoding->loop = std::thread(encodingLoop, stream.get(), encoding.get());
+            }
+        }
 
-        while(!awaitExit)
+        for(auto& stream: streams)
         {
-            // if(videoStream->hasTrack())
+            stream->loop.join();
+            for(auto& encoding: stream->encodings)
             {
-                camera->handleLoop();
+                encoding->loop.join();
             }
         }
 
         //... finally ...
-        camera->stop();
-        camera->uninitMmap();
-        camera->closeDevice();
+        whep.reset();
+        for(auto& stream: streams)
+        {
+            router->removeStream(stream->name);
+            stream->videoStream->removeSink("motion");
+            stream->videoStream->removeSink("timeshift");
+            stream->videoStream->removeSink("record");
+            stream->videoStream->removeSink("bus");
+            if(stream->ingest)
+            {
+                APP_MESSAGE("ingest %s: %s", stream->name.c_str(),
+                    stream->ingest->getStatistics().c_str());
+                stream->ingest->close();
+                continue;
+            }
+            stream->camera->stop();
+            stream->camera->uninitMmap();
+            stream->camera->closeDevice();
+            for(auto& encoding: stream->encodings)
+            {
+                encoding->camera->stop();
+                encoding->camera->uninitMmap();
+                encoding->camera->closeDevice();
+            }
+        }
+        streams.clear();
 
         rtc::Cleanup();
 
     }catch(const std::exception& e)
     {
         std::cout<<e.what()<<std::endl;
+        awaitExit = true;
+        for(auto& stream: streams)
+        {
+            if(stream->loop.joinable())
+            {
+                stream->loop.join();
+            }
+            for(auto& encoding: stream->encodings)
+            {
+                if(encoding->loop.joinable())
+                {
+                    encoding->loop.join();
+                }
+            }
+        }
         return EXIT_FAILURE;
     }
 
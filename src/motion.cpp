@@ -0,0 +1,174 @@
+/**
+ * @file motion.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "motion.hpp"
+#include "h264_bitstream.hpp"
+#include "utility.h"
+
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
+MotionDetector::MotionDetector(const MotionConfig& c):
+config(c), hasFrame(false), frameTime_us(0), frameBytes(0), slices(0),
+intraSlices(0), frameCost_ns(0), baseline(0), frames(0), aboveFrames(0),
+belowSince_us(0), isInMotion(false), score(0), peakScore(0),
+costTotal_ns(0), costMax_ns(0), measuredFrames(0)
+{}
+
+void MotionDetector::onSample(const NALUnit& sample, uint64_t time_us)
+{
+    onData(reinterpret_cast<const uint8_t *>(sample.data()), sample.size(), time_us);
+}
+
+void MotionDetector::onData(const uint8_t *data, size_t len, uint64_t time_us)
+{
+    std::vector<Event> events;
+    std::unique_lock<std::mutex> guard(lock);
+    auto start = ThreadCpuTime_ns();
+
+    ForEachNalUnit(data, len,
+        [&](const uint8_t *nal, size_t size)
+        {
+            SliceHeaderStart header;
+            if(!ParseSliceHeaderStart(nal, size, header))
+            {
+                // the parameter sets and SEI end the picture before
+                if(!IsVclNal(nal) && hasFrame)
+                {
+                    endFrame(events);
+                }
+                return;
+            }
+            // the first slice of a new picture
+            if(header.firstMbInSlice == 0 && hasFrame)
+            {
+                endFrame(events);
+            }
+            if(!hasFrame)
+            {
+                hasFrame = true;
+                frameTime_us = time_us;
+                frameBytes = 0;
+                slices = 0;
+                intraSlices = 0;
+                frameCost_ns = 0;
+            }
+            frameBytes += size;
+            slices++;
+            if(header.sliceType == H264SliceType::I
+               || header.sliceType == H264SliceType::SI)
+            {
+                intraSlices++;
+            }
+        }
+    );
+
+    if(hasFrame)
+    {
+        frameCost_ns += ThreadCpuTime_ns() - start;
+    }
+    guard.unlock();
+
+    if(onEvent)
+    {
+        for(auto& event: events)
+        {
+            onEvent(event.motion, event.score, event.time_us);
+        }
+    }
+}
+
+void MotionDetector::endFrame(std::vector<Event>& events)
+{
+    hasFrame = false;
+
+    costTotal_ns += frameCost_ns;
+    costMax_ns = std::max(costMax_ns, frameCost_ns);
+    measuredFrames++;
+
+    // the size of I frames says nothing about the motion
+    if(slices == 0 || intraSlices == slices)
+    {
+        return;
+    }
+
+    frames++;
+    if(frames <= config.warmupFrames || baseline <= 0)
+    {
+        // the mean of the first frames
+        baseline += (double(frameBytes) - baseline) / frames;
+        return;
+    }
+
+    double intraShare = double(intraSlices) / slices;
+    score = double(frameBytes) / baseline * (1 + intraShare);
+    peakScore = std::max(peakScore, score);
+
+    // a long motion must not become the baseline
+    double weight = isInMotion ? config.baselineWeight / 10 : config.baselineWeight;
+    baseline += (double(frameBytes) - baseline) * weight;
+
+    if(!isInMotion)
+    {
+        aboveFrames = score >= config.startRatio ? aboveFrames + 1 : 0;
+        if(aboveFrames >= config.startFrames)
+        {
+            isInMotion = true;
+            belowSince_us = 0;
+            APP_MESSAGE("motion starts, activity %.2f.", score);
+            events.push_back({true, score, frameTime_us});
+        }
+    }else
+    {
+        if(score >= config.stopRatio)
+        {
+            belowSince_us = 0;
+        }else if(belowSince_us == 0)
+        {
+            belowSince_us = frameTime_us;
+        }else if(frameTime_us - belowSince_us >=
+                 uint64_t(config.holdTime.count()) * 1000)
+        {
+            isInMotion = false;
+            aboveFrames = 0;
+            APP_MESSAGE("motion stops, peak activity %.2f.", peakScore);
+            events.push_back({false, peakScore, frameTime_us});
+            peakScore = 0;
+        }
+    }
+}
+
+bool MotionDetector::isMotion()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return isInMotion;
+}
+
+double MotionDetector::getScore()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return score;
+}
+
+std::string MotionDetector::getStatistics()
+{
+    nlohmann::ordered_json json;
+    std::lock_guard<std::mutex> guard(lock);
+    json["motion"] = isInMotion;
+    json["activity"] = score;
+    json["baselineBytes"] = baseline;
+    json["frames"] = measuredFrames;
+    json["costPerFrame_us"] =
+        measuredFrames ? double(costTotal_ns) / measuredFrames / 1000 : 0.0;
+    json["maxCostPerFrame_us"] = double(costMax_ns) / 1000;
+    return json.dump();
+}
@@ -0,0 +1,103 @@
+/**
+ * @file motion.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __MOTION_H
+#define __MOTION_H
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "streamer.hpp"
+
+struct MotionConfig
+{
+    /* the activity of a frame over the baseline which starts the motion */
+    double startRatio = 2.0;
+    /* the motion stops when the activity stays below it for holdTime */
+    double stopRatio = 1.3;
+    unsigned int startFrames = 3;
+    std::chrono::milliseconds holdTime{2000};
+    /* weight of a new P frame in the baseline, it is 10 times smaller in motion */
+    double baselineWeight = 0.02;
+    /* P frames which only build the baseline */
+    unsigned int warmupFrames = 30;
+};
+
+/**
+ * @brief detect motion without decoding from the H.264 stream.
+ *
+ * the activity of a P frame is its size relative to a rolling baseline of
+ * the P frame sizes, a still scene needs only few bits for the residuals.
+ * I slices inside a P frame add to the activity, the encoder has not found
+ * any reference for those macroblocks. IDR and I frames are skipped.
+ */
+class MotionDetector
+{
+    private:
+        MotionConfig config;
+        std::mutex lock;
+
+        /* the picture which is being received */
+        bool hasFrame;
+        uint64_t frameTime_us;
+        size_t frameBytes;
+        unsigned int slices;
+        unsigned int intraSlices;
+        uint64_t frameCost_ns;
+
+        double baseline;
+        unsigned int frames;
+        unsigned int aboveFrames;
+        uint64_t belowSince_us;
+        bool isInMotion;
+        double score;
+        double peakScore;
+
+        uint64_t costTotal_ns;
+        uint64_t costMax_ns;
+        uint64_t measuredFrames;
+
+        struct Event
+        {
+            bool motion;
+            double score;
+            uint64_t time_us;
+        };
+        /* called with lock, the events are passed to onEvent after it */
+        void endFrame(std::vector<Event>& events);
+    public:
+        MotionDetector(const MotionConfig& c=MotionConfig());
+        ~MotionDetector()=default;
+
+        /* called when the motion starts or stops, in the capture thread. The
+           detector is not locked, the callback may ask for its statistics */
+        std::function<void(bool motion, double score, uint64_t time_us)> onEvent=nullptr;
+
+        /**
+         * @brief a sample of the stream, it can be fed as a sink of H264VideoStream
+         */
+        void onSample(const NALUnit& sample, uint64_t time_us);
+        /**
+         * @brief feed an Annex-B buffer without copying it into a NALUnit
+         */
+        void onData(const uint8_t *data, size_t len, uint64_t time_us);
+        bool isMotion();
+        double getScore();
+        /**
+         * @brief the activity, the baseline and the cost per frame as JSON
+         */
+        std::string getStatistics();
+};
+
+#endif /* __MOTION_H */
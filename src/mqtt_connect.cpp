@@ -12,16 +12,40 @@
 #include "mqtt_connect.hpp"
 
 #include <stdexcept>
+#include <chrono>
 
 #define CLIENT_ID   "camera"
 
+constexpr int connectTimeout_ms = 10000;
+constexpr int disconnectTimeout_ms = 10000;
+/* paho doubles the retry interval after every failed attempt */
+constexpr int minRetryInterval_s = 1;
+constexpr int maxRetryInterval_s = 32;
+
+/**
+ * @brief context of a publishing, it lives until paho reports the result
+ */
+struct PublishRequest
+{
+    MqttConnect *conn;
+    onDeliveredCallback onDelivered;
+    /* sent while connected, it counts to the pending messages */
+    bool isCounted;
+};
+
 void connectLostHandle(void *context, char *cause)
 {
     MQTT_LOG("Connect Lost: %s", cause);
+    static_cast<MqttConnect *>(context)->connectLost();
+}
+
+void connectedHandle(void *context, char *cause)
+{
+    static_cast<MqttConnect *>(context)->reconnected();
 }
 
 int messageArrivedHandle(void *context, char *topicName, int topicLen, 
-MQTTClient_message *msg)
+MQTTAsync_message *msg)
 {
     std::string topic;
     if(topicLen == 0)
@@ -39,60 +63,315 @@ MQTTClient_message *msg)
     MqttConnect *conn = static_cast<MqttConnect *>(context);
     conn->onMessage(topic, message);
 
-    MQTTClient_freeMessage(&msg);
-    MQTTClient_free(topicName);
+    MQTTAsync_freeMessage(&msg);
+    MQTTAsync_free(topicName);
     return 1;
 }
 
-// void deliveredHandle(void *context, MQTTClient_deliveryToken dt)
-// {
+void connectSuccessHandle(void *context, MQTTAsync_successData *response)
+{
+    static_cast<MqttConnect *>(context)->connectSuccess();
+}
+
+void connectFailureHandle(void *context, MQTTAsync_failureData *response)
+{
+    static_cast<MqttConnect *>(context)->connectFailure(
+        response != nullptr ? response->code : MQTTASYNC_FAILURE);
+}
+
+void publishSuccessHandle(void *context, MQTTAsync_successData *response)
+{
+    auto request = static_cast<PublishRequest *>(context);
+    request->conn->publishDone(true, request->isCounted);
+    if(request->onDelivered)
+    {
+        request->onDelivered(true);
+    }
+    delete request;
+}
 
-// }
+void publishFailureHandle(void *context, MQTTAsync_failureData *response)
+{
+    auto request = static_cast<PublishRequest *>(context);
+    MQTT_LOG("message is lost (%d).",
+        response != nullptr ? response->code : MQTTASYNC_FAILURE);
+    request->conn->publishDone(false, request->isCounted);
+    if(request->onDelivered)
+    {
+        request->onDelivered(false);
+    }
+    delete request;
+}
 
 MqttConnect::MqttConnect(const std::string& url, const std::string& clientId, 
-                         const std::string& username, const std::string& password)
+                         const std::string& username, const std::string& password,
+                         size_t maxPending, size_t maxBuffered):
+username(username), password(password), isConnected(false), isFailed(false), isLost(false),
+defaultQos(0), maxPendingMessages(maxPending), pendingMessages(0)
 {
     int rc;
-    MQTTClient_create(&client, url.c_str(), clientId.c_str(),
-        MQTTCLIENT_PERSISTENCE_NONE, NULL);
-    connOpt = MQTTClient_connectOptions_initializer;
-    connOpt.username = username.c_str();
-    connOpt.password = password.c_str();
+    MQTTAsync_connectOptions connOpt = MQTTAsync_connectOptions_initializer;
+    MQTTAsync_createOptions createOpt = MQTTAsync_createOptions_initializer;
+
+    createOpt.sendWhileDisconnected = 1;
+    createOpt.maxBufferedMessages = maxBuffered;
+    createOpt.deleteOldestMessages = 1;
+    rc = MQTTAsync_createWithOptions(&client, url.c_str(), clientId.c_str(),
+        MQTTCLIENT_PERSISTENCE_NONE, NULL, &createOpt);
+    if(rc != MQTTASYNC_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create client, return code "+ std::to_string(rc));
+    }
+
+    MQTTAsync_setCallbacks(client, this, connectLostHandle,
+                           messageArrivedHandle, nullptr);
+    MQTTAsync_setConnected(client, this, connectedHandle);
 
-    MQTTClient_setCallbacks(client, this, connectLostHandle,
-                            messageArrivedHandle, nullptr);
+    connOpt.username = this->username.c_str();
+    connOpt.password = this->password.c_str();
+    connOpt.onSuccess = connectSuccessHandle;
+    connOpt.onFailure = connectFailureHandle;
+    connOpt.context = this;
+    connOpt.automaticReconnect = 1;
+    connOpt.minRetryInterval = minRetryInterval_s;
+    connOpt.maxRetryInterval = maxRetryInterval_s;
 
-    if ((rc = MQTTClient_connect(client, &connOpt)) != MQTTCLIENT_SUCCESS)
+    if ((rc = MQTTAsync_connect(client, &connOpt)) != MQTTASYNC_SUCCESS)
     {
+        MQTTAsync_destroy(&client);
         throw std::runtime_error("Failed to connect, return code "+ std::to_string(rc));
     }
 
+    waitForConnection(connectTimeout_ms);
+
     MQTT_LOG("MQTT is connected to %s", url.c_str());
 }
 
 MqttConnect::~MqttConnect()
 {
+    MQTTAsync_disconnectOptions disconnOpt = MQTTAsync_disconnectOptions_initializer;
+    disconnOpt.timeout = disconnectTimeout_ms;
+
     MQTT_LOG("mqtt close.");
-    MQTTClient_disconnect(client, 10000);
-    MQTTClient_destroy(&client);
+    MQTTAsync_disconnect(client, &disconnOpt);
+    MQTTAsync_destroy(&client);
+}
+
+void MqttConnect::waitForConnection(int timeout_ms)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    bool done = stateChanged.wait_for(guard, std::chrono::milliseconds(timeout_ms),
+        [this]()
+        {
+            return isConnected || isFailed;
+        }
+    );
+
+    if(!done || isFailed)
+    {
+        guard.unlock();
+        MQTTAsync_destroy(&client);
+        throw std::runtime_error(done ? "Failed to connect." : "Connect timeout.");
+    }
+}
+
+void MqttConnect::connectSuccess()
+{
+    lock.lock();
+    isConnected = true;
+    lock.unlock();
+    stateChanged.notify_all();
+}
+
+void MqttConnect::connectFailure(int code)
+{
+    MQTT_LOG("Connect failed, return code %d", code);
+    lock.lock();
+    isFailed = true;
+    lock.unlock();
+    stateChanged.notify_all();
+}
+
+void MqttConnect::connectLost()
+{
+    lock.lock();
+    isConnected = false;
+    isLost = true;
+    lostSince = std::chrono::steady_clock::now();
+    lock.unlock();
+
+    if(onConnection)
+    {
+        onConnection(false);
+    }
 }
 
-int MqttConnect::publishMessage(std::string topic, std::string message) noexcept
+void MqttConnect::reconnected()
 {
-    MQTTClient_message mqttMsg(MQTTClient_message_initializer);
+    std::set<std::string> topics;
+
+    lock.lock();
+    bool wasLost = isLost;
+    isLost = false;
+    isConnected = true;
+    topics = subscribedTopics;
+    auto outage = std::chrono::steady_clock::now() - lostSince;
+    lock.unlock();
+    stateChanged.notify_all();
+
+    // the first connection is reported by connectSuccess()
+    if(!wasLost)
+    {
+        return;
+    }
+
+    // a clean session has forgotten all subscriptions
+    for(auto& topic: topics)
+    {
+        MQTTAsync_subscribe(client, topic.c_str(), getQos(topic), nullptr);
+    }
+    MQTT_LOG("reconnected after %lld ms, %d topics are subscribed again.",
+        (long long)std::chrono::duration_cast<std::chrono::milliseconds>(outage).count(),
+        int(topics.size()));
+
+    if(onConnection)
+    {
+        onConnection(true);
+    }
+}
+
+void MqttConnect::publishDone(bool delivered, bool isCounted)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(isCounted)
+    {
+        pendingMessages--;
+    }
+}
+
+bool IsTopicMatched(const std::string& filter, const std::string& topic)
+{
+    size_t f = 0;
+    size_t t = 0;
+
+    while(f < filter.size())
+    {
+        if(filter[f] == '#')
+        {
+            return true;
+        }
+        if(filter[f] == '+')
+        {
+            // one whole level
+            while(t < topic.size() && topic[t] != '/') t++;
+            f++;
+        }else
+        {
+            if(t == topic.size() && filter.compare(f, std::string::npos, "/#") == 0)
+            {
+                // "a/#" matches "a"
+                return true;
+            }
+            if(t >= topic.size() || filter[f] != topic[t])
+            {
+                return false;
+            }
+            f++;
+            t++;
+        }
+    }
+    return t == topic.size();
+}
+
+int MqttConnect::getQos(const std::string& topic)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = topicQos.find(topic);
+    if(it != topicQos.end())
+    {
+        return it->second;
+    }
+    for(auto& [filter, qos]: topicQos)
+    {
+        if(IsTopicMatched(filter, topic))
+        {
+            return qos;
+        }
+    }
+    return defaultQos;
+}
+
+void MqttConnect::setTopicQos(const std::string& topic, int qos)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    topicQos[topic] = qos;
+}
+
+void MqttConnect::setDefaultQos(int qos)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    defaultQos = qos;
+}
+
+int MqttConnect::publishMessage(std::string topic, std::string message,
+                                onDeliveredCallback onDelivered) noexcept
+{
+    MQTTAsync_message mqttMsg = MQTTAsync_message_initializer;
+    MQTTAsync_responseOptions respOpt = MQTTAsync_responseOptions_initializer;
+    PublishRequest *request;
+    int rc;
+
+    lock.lock();
+    // while the connection is lost, paho buffers up to maxBuffered messages
+    bool isCounted = isConnected;
+    if(isCounted && pendingMessages >= maxPendingMessages)
+    {
+        lock.unlock();
+        MQTT_LOG("queue is full, drop the message to %s.", topic.c_str());
+        if(onDelivered)
+        {
+            onDelivered(false);
+        }
+        return MQTTASYNC_MAX_BUFFERED_MESSAGES;
+    }
+    if(isCounted)
+    {
+        pendingMessages++;
+    }
+    lock.unlock();
+
+    // paho copies the payload, it is free to go after sending
     mqttMsg.payload = (void *)message.c_str();
     mqttMsg.payloadlen = message.length();
-    
+    mqttMsg.qos = getQos(topic);
+
+    request = new PublishRequest{this, std::move(onDelivered), isCounted};
+    respOpt.onSuccess = publishSuccessHandle;
+    respOpt.onFailure = publishFailureHandle;
+    respOpt.context = request;
+
     MQTT_LOG("message will be send. topic: %s: %s", topic.c_str(), message.c_str());
-    return MQTTClient_publishMessage(client, topic.c_str(), &mqttMsg, nullptr);
+    rc = MQTTAsync_sendMessage(client, topic.c_str(), &mqttMsg, &respOpt);
+    if(rc != MQTTASYNC_SUCCESS)
+    {
+        // no callback will come for a message which is not queued
+        publishFailureHandle(request, nullptr);
+    }
+    return rc;
 }
 
 int MqttConnect::subscribeTopic(std::string topic) noexcept
 {
-    return MQTTClient_subscribe(client, topic.c_str(), 0);
+    lock.lock();
+    subscribedTopics.insert(topic);
+    lock.unlock();
+    return MQTTAsync_subscribe(client, topic.c_str(), getQos(topic), nullptr);
 }
 
 int MqttConnect::unsubscribeTopic(std::string topic) noexcept
 {
-    return MQTTClient_unsubscribe(client, topic.c_str());
+    lock.lock();
+    subscribedTopics.erase(topic);
+    lock.unlock();
+    return MQTTAsync_unsubscribe(client, topic.c_str(), nullptr);
 }
@@ -15,8 +15,12 @@
 #include <string>
 #include <functional>
 #include <map>
+#include <set>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
-#include <MQTTClient.h>
+#include <MQTTAsync.h>
 
 #define MQTT_INFO
 
@@ -32,30 +36,75 @@
 #endif
 
 using onMessageCallback = std::function<void(std::string topic, std::string msg)>;
+/* true if the message has been delivered with the QoS of its topic */
+using onDeliveredCallback = std::function<void(bool delivered)>;
+using onConnectionCallback = std::function<void(bool connected)>;
+
+/**
+ * @brief check if a topic matches a filter with the wildcards '+' and '#',
+ * a trailing "/#" also matches the parent level (MQTT 3.1.1, 4.7.1.2)
+ */
+bool IsTopicMatched(const std::string& filter, const std::string& topic);
 
 class MqttConnect
 {
     private:
-        MQTTClient client;
-        MQTTClient_connectOptions connOpt;
+        MQTTAsync client;
+        std::string username;
+        std::string password;
         onMessageCallback handler;
+
+        std::mutex lock;
+        std::condition_variable stateChanged;
+        bool isConnected;
+        bool isFailed;
+        bool isLost;
+        std::map<std::string, int> topicQos;
+        /* will be subscribed again after reconnecting */
+        std::set<std::string> subscribedTopics;
+        std::chrono::steady_clock::time_point lostSince;
+        int defaultQos;
+        /* the messages in flight while connected, the ones buffered while
+           the connection is lost are limited by paho */
+        size_t maxPendingMessages;
+        size_t pendingMessages;
+
+        int getQos(const std::string& topic);
+        void waitForConnection(int timeout_ms);
     public:
         MqttConnect()=delete;
         MqttConnect(const std::string& url, const std::string& clientId, 
-                    const std::string& username, const std::string& password);
+                    const std::string& username, const std::string& password,
+                    size_t maxPending=64, size_t maxBuffered=256);
         ~MqttConnect();
         onMessageCallback onMessage;
-        int publishMessage(std::string topic, std::string message) noexcept;
+        onConnectionCallback onConnection=nullptr;
+        /**
+         * @brief queue a message, it will never block on the network. While
+         * the connection is lost, up to maxBuffered messages will be buffered
+         * and sent after reconnecting, the oldest ones are dropped. While
+         * connected, up to maxPending messages wait for their delivery.
+         *
+         * @param onDelivered will be called from the MQTT thread when the
+         * message is delivered or lost, also when the queue is full.
+         * @return int MQTTASYNC_SUCCESS if the message is queued
+         */
+        int publishMessage(std::string topic, std::string message,
+                           onDeliveredCallback onDelivered=nullptr) noexcept;
         int subscribeTopic(std::string topic) noexcept;
         int unsubscribeTopic(std::string topic) noexcept;
-};
+        /**
+         * @brief set the QoS of publishing and subscribing a topic
+         */
+        void setTopicQos(const std::string& topic, int qos);
+        void setDefaultQos(int qos);
 
-class NotifyMessage
-{
-    private:
-    public:
-        NotifyMessage()=default;
-        ~NotifyMessage()=default;
+        /* callbacks of the paho library */
+        void connectSuccess();
+        void connectFailure(int code);
+        void connectLost();
+        void reconnected();
+        void publishDone(bool delivered, bool isCounted);
 };
 
 #endif /* __SIGNALINGCHANNEL_H */
@@ -0,0 +1,231 @@
+/**
+ * @file pacer.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "pacer.hpp"
+#include "utility.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <nlohmann/json.hpp>
+
+/* the scheduler sleeps at most this long without a queued packet */
+constexpr uint64_t idleWait_us = 100 * 1000;
+
+static uint64_t steadyTime_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TokenBucket::TokenBucket(double rate_Bps, double capacity):
+rate_Bpus(rate_Bps / 1e6), capacity(capacity), tokens(capacity), last_us(0)
+{}
+
+void TokenBucket::setRate(double rate_Bps)
+{
+    rate_Bpus = rate_Bps / 1e6;
+}
+
+void TokenBucket::refill(uint64_t now_us)
+{
+    if(last_us != 0 && now_us > last_us)
+    {
+        tokens = std::min(capacity, tokens + (now_us - last_us) * rate_Bpus);
+    }
+    last_us = std::max(last_us, now_us);
+}
+
+bool TokenBucket::consume(size_t bytes)
+{
+    // a packet larger than the capacity needs a full bucket
+    double needed = std::min(double(bytes), capacity);
+    if(tokens < needed)
+    {
+        return false;
+    }
+    tokens -= bytes;
+    return true;
+}
+
+uint64_t TokenBucket::waitFor(size_t bytes)
+{
+    double needed = std::min(double(bytes), capacity);
+    if(tokens >= needed)
+    {
+        return 0;
+    }
+    return uint64_t((needed - tokens) / rate_Bpus) + 1;
+}
+
+RtpPacer::RtpPacer(const std::shared_ptr<PacingScheduler>& s, uint64_t interval_us):
+scheduler(s), config(s->getConfig()), frameInterval_us(interval_us), queuedBytes(0),
+bucket(config.rate_kbps * 1000.0 / 8, config.burst_bytes)
+{}
+
+void RtpPacer::setHandler(const std::shared_ptr<rtc::MediaChainableHandler>& h)
+{
+    handler = h;
+}
+
+rtc::MediaHandlerElement::ChainedOutgoingProduct
+RtpPacer::processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                       rtc::message_ptr control)
+{
+    if(!messages || messages->empty())
+    {
+        return {messages, control};
+    }
+    uint64_t now_us = steadyTime_us();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for(auto& packet: *messages)
+        {
+            queuedBytes += packet.size();
+            queue.push_back({std::move(packet), now_us});
+        }
+        // the queue leaves in the part of the frame interval, but not
+        // slower than the configured rate
+        double spread_s = config.fraction * frameInterval_us / 1e6;
+        double rate_Bps = config.rate_kbps * 1000.0 / 8;
+        if(spread_s > 0)
+        {
+            rate_Bps = std::max(rate_Bps, queuedBytes / spread_s);
+        }
+        bucket.refill(now_us);
+        bucket.setRate(rate_Bps);
+    }
+    if(auto s = scheduler.lock())
+    {
+        s->notify();
+    }
+    // every packet is sent by the scheduler, so they keep their order
+    return {std::make_shared<std::vector<rtc::binary>>(), control};
+}
+
+uint64_t RtpPacer::drain(uint64_t now_us)
+{
+    auto h = handler.lock();
+    auto s = scheduler.lock();
+    std::lock_guard<std::mutex> guard(lock);
+    bucket.refill(now_us);
+    while(!queue.empty() && bucket.consume(queue.front().data.size()))
+    {
+        auto& packet = queue.front();
+        if(h)
+        {
+            h->send(rtc::make_message(packet.data.begin(), packet.data.end()));
+        }
+        if(s)
+        {
+            s->recordDelay(now_us - packet.queued_us, queue.size());
+        }
+        queuedBytes -= packet.data.size();
+        queue.pop_front();
+    }
+    return queue.empty() ? 0 : bucket.waitFor(queue.front().data.size());
+}
+
+PacingScheduler::PacingScheduler(const PacingConfig& c):
+config(c), isStopped(false), isWoken(false),
+packets(0), delaySum_us(0), peakDelay_us(0), peakQueue(0)
+{
+    loop = std::thread(&PacingScheduler::schedulerLoop, this);
+}
+
+PacingScheduler::~PacingScheduler()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        isStopped = true;
+    }
+    wakeup.notify_all();
+    loop.join();
+}
+
+void PacingScheduler::add(const std::shared_ptr<RtpPacer>& pacer)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    pacers.push_back(pacer);
+}
+
+void PacingScheduler::notify()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        isWoken = true;
+    }
+    wakeup.notify_one();
+}
+
+void PacingScheduler::recordDelay(uint64_t delay_us, size_t queued)
+{
+    std::lock_guard<std::mutex> guard(statsLock);
+    packets++;
+    delaySum_us += delay_us;
+    peakDelay_us = std::max(peakDelay_us, delay_us);
+    peakQueue = std::max(peakQueue, queued);
+}
+
+void PacingScheduler::schedulerLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while(!isStopped)
+    {
+        isWoken = false;
+        std::vector<std::shared_ptr<RtpPacer>> active;
+        for(auto it = pacers.begin(); it != pacers.end();)
+        {
+            if(auto pacer = it->lock())
+            {
+                active.push_back(pacer);
+                ++it;
+            }else
+            {
+                it = pacers.erase(it);
+            }
+        }
+        guard.unlock();
+
+        uint64_t wait_us = idleWait_us;
+        uint64_t now_us = steadyTime_us();
+        for(auto& pacer: active)
+        {
+            uint64_t due_us = pacer->drain(now_us);
+            if(due_us > 0)
+            {
+                wait_us = std::min(wait_us, due_us);
+            }
+        }
+        active.clear();
+
+        guard.lock();
+        if(!isWoken && !isStopped)
+        {
+            wakeup.wait_for(guard, std::chrono::microseconds(wait_us));
+        }
+    }
+}
+
+std::string PacingScheduler::getStatistics()
+{
+    nlohmann::ordered_json json;
+    std::lock_guard<std::mutex> guard(statsLock);
+    json["packets"] = packets;
+    json["meanDelay_ms"] = packets > 0 ? delaySum_us / 1000.0 / packets : 0.0;
+    json["peakDelay_ms"] = peakDelay_us / 1000.0;
+    json["peakQueue"] = peakQueue;
+    packets = 0;
+    delaySum_us = 0;
+    peakDelay_us = 0;
+    peakQueue = 0;
+    return json.dump();
+}
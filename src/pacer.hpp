@@ -0,0 +1,143 @@
+/**
+ * @file pacer.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __PACER_H
+#define __PACER_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rtc/rtc.hpp>
+
+struct PacingConfig
+{
+    /* the packets of a frame are spread over this part of the frame interval */
+    double fraction = 0.5;
+    /* the lowest rate of a viewer in kbit/s, a large frame is sent faster */
+    uint32_t rate_kbps = 4000;
+    /* what may leave at once after a pause */
+    uint32_t burst_bytes = 8 * 1200;
+};
+
+/**
+ * @brief the tokens are bytes, they are added at the rate up to the
+ * capacity. The time is passed in, so the bucket can be simulated.
+ */
+class TokenBucket
+{
+    private:
+        double rate_Bpus;
+        double capacity;
+        double tokens;
+        uint64_t last_us;
+    public:
+        TokenBucket(double rate_Bps, double capacity);
+        ~TokenBucket()=default;
+
+        void setRate(double rate_Bps);
+        void refill(uint64_t now_us);
+        /**
+         * @return false if there are not enough tokens, nothing is taken
+         */
+        bool consume(size_t bytes);
+        /**
+         * @brief the time until there are tokens for bytes
+         */
+        uint64_t waitFor(size_t bytes);
+};
+
+class PacingScheduler;
+
+/**
+ * @brief the last element of the chain of a track, after the SR reporter
+ * and the NACK responder. It holds the RTP packets and the scheduler sends
+ * them through the handler of the track at the pace of a token bucket.
+ */
+class RtpPacer: public rtc::MediaHandlerElement
+{
+    private:
+        struct Packet
+        {
+            rtc::binary data;
+            uint64_t queued_us;
+        };
+
+        std::weak_ptr<PacingScheduler> scheduler;
+        std::weak_ptr<rtc::MediaChainableHandler> handler;
+        const PacingConfig config;
+        const uint64_t frameInterval_us;
+        std::mutex lock;
+        std::deque<Packet> queue;
+        size_t queuedBytes;
+        TokenBucket bucket;
+    public:
+        RtpPacer(const std::shared_ptr<PacingScheduler>& scheduler,
+                 uint64_t frameInterval_us);
+        ~RtpPacer()=default;
+
+        void setHandler(const std::shared_ptr<rtc::MediaChainableHandler>& h);
+        ChainedOutgoingProduct processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                                            rtc::message_ptr control) override;
+        /**
+         * @brief send the packets which have their tokens
+         *
+         * @return the time until the next packet is due, 0 if none is queued
+         */
+        uint64_t drain(uint64_t now_us);
+};
+
+/**
+ * @brief one thread which sends the queued packets of all pacers of a
+ * stream, and the statistics of the queue delay.
+ */
+class PacingScheduler: public std::enable_shared_from_this<PacingScheduler>
+{
+    private:
+        PacingConfig config;
+        std::vector<std::weak_ptr<RtpPacer>> pacers;
+        std::thread loop;
+        std::mutex lock;
+        std::condition_variable wakeup;
+        bool isStopped;
+        bool isWoken;
+
+        std::mutex statsLock;
+        uint64_t packets;
+        uint64_t delaySum_us;
+        uint64_t peakDelay_us;
+        size_t peakQueue;
+
+        void schedulerLoop();
+    public:
+        PacingScheduler(const PacingConfig& c);
+        ~PacingScheduler();
+        PacingScheduler(const PacingScheduler&)=delete;
+        PacingScheduler& operator=(const PacingScheduler&)=delete;
+
+        const PacingConfig& getConfig() {return config;}
+        void add(const std::shared_ptr<RtpPacer>& pacer);
+        /* a pacer has queued packets */
+        void notify();
+        void recordDelay(uint64_t delay_us, size_t queued);
+        /**
+         * @brief the queue delay of the paced packets since the last call
+         */
+        std::string getStatistics();
+};
+
+#endif /* __PACER_H */
@@ -0,0 +1,214 @@
+/**
+ * @file rate_control.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "rate_control.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+constexpr uint8_t rtcpSenderReport = 200;
+constexpr uint8_t rtcpReceiverReport = 201;
+constexpr uint8_t rtcpPayloadFeedback = 206;
+constexpr uint8_t applicationLayerFeedback = 15;
+/* the send rate is measured over this window */
+constexpr uint64_t rateWindow_us = 500 * 1000;
+
+static uint64_t steadyTime_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool ReportedLossOf(const rtc::Message& message, double& loss)
+{
+    auto data = reinterpret_cast<const uint8_t *>(message.data());
+    size_t pos = 0;
+    while(pos + 8 <= message.size())
+    {
+        uint8_t count = data[pos] & 0x1f;
+        uint8_t type = data[pos + 1];
+        size_t blocks = pos + (type == rtcpSenderReport ? 28 : 8);
+        if((type == rtcpReceiverReport || type == rtcpSenderReport) && count > 0
+           && blocks + 24 <= message.size())
+        {
+            loss = data[blocks + 4] / 256.0;
+            return true;
+        }
+        pos += 4 * (((data[pos + 2] << 8) | data[pos + 3]) + 1);
+    }
+    return false;
+}
+
+TemporalLayerTracker::TemporalLayerTracker(unsigned int l):
+layers(1), position(0), isPeriodMatched(true), isVerified(false)
+{
+    setLayers(l);
+}
+
+void TemporalLayerTracker::setLayers(unsigned int l)
+{
+    layers = std::clamp(l, 1u, maxTemporalLayers);
+}
+
+unsigned int TemporalLayerTracker::next(bool isIdr, bool isReference)
+{
+    if(isIdr)
+    {
+        position = 0;
+    }
+    unsigned int topLayer = layers - 1;
+    if(topLayer == 0)
+    {
+        return 0;
+    }
+    unsigned int period = 1u << topLayer;
+    unsigned int phase = unsigned(position % period);
+    position++;
+    // 0 for the base, the top layer at the odd positions, the middle between
+    unsigned int expected = phase == 0 ? 0 : topLayer - __builtin_ctz(phase);
+    if(phase == 0)
+    {
+        isVerified = isPeriodMatched;
+        isPeriodMatched = true;
+    }
+    isPeriodMatched = isPeriodMatched && ((expected == topLayer) == !isReference);
+
+    if(!isReference)
+    {
+        return topLayer;
+    }
+    return isVerified && expected < topLayer ? expected : 0;
+}
+
+BandwidthEstimator::BandwidthEstimator(uint64_t recovery_us):
+windowStart_us(0), windowBytes(0), sendRate_bps(0), lossEstimate_bps(0), remb_bps(0),
+lastLoss_us(0), lossRecovery_us(recovery_us)
+{}
+
+double BandwidthEstimator::getEstimate_bps()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(lossEstimate_bps > 0 && remb_bps > 0)
+    {
+        return std::min(lossEstimate_bps, remb_bps);
+    }
+    return std::max(lossEstimate_bps, remb_bps);
+}
+
+double BandwidthEstimator::getSendRate_bps()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return sendRate_bps;
+}
+
+void BandwidthEstimator::onLoss(double loss, uint64_t now_us)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(loss >= 0.02)
+    {
+        lastLoss_us = now_us;
+    }
+    if(loss > 0.10)
+    {
+        double base = lossEstimate_bps > 0 ? std::min(lossEstimate_bps, sendRate_bps)
+                                           : sendRate_bps;
+        lossEstimate_bps = base * (1 - 0.5 * loss);
+    }else if(loss < 0.02 && lossEstimate_bps > 0 && now_us - lastLoss_us >= lossRecovery_us)
+    {
+        // the send rate follows the estimate, it cannot show that the
+        // path has recovered. The REMB, or no limit, counts again.
+        lossEstimate_bps = 0;
+    }else if(loss < 0.02 && lossEstimate_bps > 0)
+    {
+        // rises slowly, but not far above what has been sent
+        lossEstimate_bps = std::min(lossEstimate_bps * 1.05,
+                                    std::max(lossEstimate_bps, 1.5 * sendRate_bps));
+    }
+}
+
+rtc::MediaHandlerElement::ChainedOutgoingProduct
+BandwidthEstimator::processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                                 rtc::message_ptr control)
+{
+    if(!messages)
+    {
+        return {messages, control};
+    }
+    uint64_t now_us = steadyTime_us();
+    std::lock_guard<std::mutex> guard(lock);
+    for(auto& packet: *messages)
+    {
+        windowBytes += packet.size();
+    }
+    if(windowStart_us == 0)
+    {
+        windowStart_us = now_us;
+    }else if(now_us - windowStart_us >= rateWindow_us)
+    {
+        double rate_bps = windowBytes * 8 * 1e6 / (now_us - windowStart_us);
+        sendRate_bps = sendRate_bps > 0 ? 0.5 * sendRate_bps + 0.5 * rate_bps : rate_bps;
+        windowStart_us = now_us;
+        windowBytes = 0;
+    }
+    return {messages, control};
+}
+
+rtc::MediaHandlerElement::ChainedIncomingControlProduct
+BandwidthEstimator::processIncomingControlMessage(rtc::message_ptr message)
+{
+    double loss;
+    if(ReportedLossOf(*message, loss))
+    {
+        onLoss(loss, steadyTime_us());
+    }
+
+    // REMB: "REMB", the number of SSRCs, 6 bits exponent and 18 bits mantissa
+    auto data = reinterpret_cast<const uint8_t *>(message->data());
+    size_t pos = 0;
+    while(pos + 20 <= message->size())
+    {
+        size_t length = 4 * (((data[pos + 2] << 8) | data[pos + 3]) + 1);
+        if(data[pos + 1] == rtcpPayloadFeedback
+           && (data[pos] & 0x1f) == applicationLayerFeedback
+           && std::memcmp(data + pos + 12, "REMB", 4) == 0)
+        {
+            uint32_t mantissa = ((data[pos + 17] & 0x03) << 16)
+                                | (data[pos + 18] << 8) | data[pos + 19];
+            std::lock_guard<std::mutex> guard(lock);
+            remb_bps = double(uint64_t(mantissa) << (data[pos + 17] >> 2));
+        }
+        pos += length;
+    }
+    return {message};
+}
+
+bool TemporalLayerSelector::drops(unsigned int layer, double estimate_bps,
+                                  const LayerRates& rates)
+{
+    if(layer == 0)
+    {
+        unsigned int highest = maxTemporalLayers - 1;
+        if(estimate_bps > 0)
+        {
+            // the base layer is always sent, the others while they fit
+            double rate_bps = rates[0];
+            highest = 0;
+            while(highest + 1 < maxTemporalLayers
+                  && rate_bps + rates[highest + 1] <= headroom * estimate_bps)
+            {
+                rate_bps += rates[++highest];
+            }
+        }
+        maxLayer = highest;
+    }
+    return layer > maxLayer;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file rate_control.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __RATE_CONTROL_H
+#define __RATE_CONTROL_H
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+#include <rtc/rtc.hpp>
+
+/* the base layer, a middle layer and the top layer of hierarchical-P */
+constexpr unsigned int maxTemporalLayers = 3;
+using LayerRates = std::array<double, maxTemporalLayers>;
+
+/**
+ * @brief the fraction lost of the first report block of a SR or RR in a
+ * compound RTCP packet (RFC 3550 6.4)
+ *
+ * @return false if the packet has no report block
+ */
+bool ReportedLossOf(const rtc::Message& message, double& loss);
+
+/**
+ * @brief the temporal layer of the frames of a stream.
+ *
+ * A frame without a reference slice (nal_ref_idc 0) is in the top layer,
+ * it can always be dropped. The middle layer of a hierarchical-P stream
+ * with 3 layers is taken from the position after the IDR: 0 2 1 2 0 2 1 2.
+ * It is used only while the nal_ref_idc of the frames matches this pattern,
+ * otherwise the reference frames are all in the base layer. The pattern
+ * cannot tell hierarchical-P from IPPP with every second frame not
+ * referenced, so 3 layers are only for an encoder in hierarchical-P mode.
+ */
+class TemporalLayerTracker
+{
+    private:
+        unsigned int layers;
+        uint64_t position;
+        bool isPeriodMatched;
+        bool isVerified;
+    public:
+        TemporalLayerTracker(unsigned int layers=1);
+        ~TemporalLayerTracker()=default;
+
+        void setLayers(unsigned int layers);
+        unsigned int getLayers() {return layers;}
+        /**
+         * @param isIdr the pattern starts again
+         * @param isReference a slice of the frame has nal_ref_idc > 0
+         * @return the layer of the frame, 0 is never dropped
+         */
+        unsigned int next(bool isIdr, bool isReference);
+};
+
+/**
+ * @brief the bandwidth of a viewer: the REMB of the receiver, and a loss
+ * based estimate which falls with more than 10 % loss in the receiver
+ * reports and rises again with less than 2 %. The loss estimate is dropped
+ * after a period with less than 2 % loss, the viewer then gets what the
+ * REMB allows again. It passes every packet and measures the send rate.
+ */
+class BandwidthEstimator: public rtc::MediaHandlerElement
+{
+    private:
+        std::mutex lock;
+        uint64_t windowStart_us;
+        uint64_t windowBytes;
+        double sendRate_bps;
+        /* 0 until the first loss, there is no limit */
+        double lossEstimate_bps;
+        double remb_bps;
+        /* the last report with 2 % loss or more */
+        uint64_t lastLoss_us;
+        uint64_t lossRecovery_us;
+
+        void onLoss(double loss, uint64_t now_us);
+    public:
+        static constexpr uint64_t defaultLossRecovery_us = 10 * 1000 * 1000;
+
+        /**
+         * @param recovery_us the loss estimate is dropped after this time
+         * without loss
+         */
+        BandwidthEstimator(uint64_t recovery_us=defaultLossRecovery_us);
+        ~BandwidthEstimator()=default;
+
+        /**
+         * @return the estimate in bit/s, 0 if there is none
+         */
+        double getEstimate_bps();
+        double getSendRate_bps();
+
+        ChainedOutgoingProduct processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                                            rtc::message_ptr control) override;
+        ChainedIncomingControlProduct processIncomingControlMessage(rtc::message_ptr message) override;
+};
+
+/**
+ * @brief the highest layer which a viewer receives. It changes only at a
+ * base layer frame, the following frames refer only to frames which the
+ * viewer has received.
+ */
+class TemporalLayerSelector
+{
+    private:
+        /* the layers take up to this part of the estimate */
+        static constexpr double headroom = 0.85;
+        std::atomic<unsigned int> maxLayer{maxTemporalLayers - 1};
+    public:
+        TemporalLayerSelector()=default;
+        ~TemporalLayerSelector()=default;
+
+        /**
+         * @param estimate_bps the bandwidth of the viewer, 0 if unknown
+         * @param rates the bit rate of each layer of the stream
+         * @return the frame is not sent to the viewer
+         */
+        bool drops(unsigned int layer, double estimate_bps, const LayerRates& rates);
+        unsigned int getMaxLayer() {return maxLayer;}
+};
+
+#endif /* __RATE_CONTROL_H */
@@ -0,0 +1,439 @@
+/**
+ * @file recorder.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "recorder.hpp"
+#include "h264_bitstream.hpp"
+#include "utility.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#include <nlohmann/json.hpp>
+
+/* a pause in the recording longer than it starts a new file */
+constexpr uint64_t maxGap_us = 1000000;
+
+DirectFile::DirectFile(): fd(-1), isDirect(false), block(nullptr), fill(0), size(0)
+{
+    if(posix_memalign(reinterpret_cast<void **>(&block), alignment, blockSize) != 0)
+    {
+        throw std::bad_alloc();
+    }
+}
+
+DirectFile::~DirectFile()
+{
+    close();
+    free(block);
+}
+
+void DirectFile::open(const std::string& path, bool direct)
+{
+    close();
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    isDirect = direct;
+    fd = direct ? ::open(path.c_str(), flags | O_DIRECT, 0644) : -1;
+    if(fd < 0)
+    {
+        // e.g. tmpfs has no O_DIRECT
+        isDirect = false;
+        fd = ::open(path.c_str(), flags, 0644);
+    }
+    if(fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+    }
+    fill = 0;
+    size = 0;
+}
+
+void DirectFile::writeBlock(size_t len)
+{
+    size_t done = 0;
+    while(done < len)
+    {
+        ssize_t ret = ::write(fd, block + done, len - done);
+        if(ret < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "cannot write the recording");
+        }
+        done += ret;
+    }
+}
+
+void DirectFile::write(const void *data, size_t len)
+{
+    auto p = static_cast<const uint8_t *>(data);
+    while(len > 0)
+    {
+        size_t n = std::min(len, blockSize - fill);
+        memcpy(block + fill, p, n);
+        fill += n;
+        size += n;
+        p += n;
+        len -= n;
+        if(fill == blockSize)
+        {
+            writeBlock(blockSize);
+            fill = 0;
+        }
+    }
+}
+
+void DirectFile::close()
+{
+    if(fd < 0)
+    {
+        return;
+    }
+    try
+    {
+        if(fill > 0)
+        {
+            size_t len = fill;
+            if(isDirect)
+            {
+                // O_DIRECT writes whole aligned blocks, cut the padding off
+                len = (fill + alignment - 1) / alignment * alignment;
+                memset(block + fill, 0, len - fill);
+            }
+            writeBlock(len);
+            if(isDirect && ftruncate(fd, size) < 0)
+            {
+                ERROR_MESSAGE("cannot truncate the recording: %s", strerror(errno));
+            }
+        }
+        fdatasync(fd);
+    }catch(const std::exception& e)
+    {
+        ERROR_MESSAGE("%s", e.what());
+    }
+    ::close(fd);
+    fd = -1;
+    fill = 0;
+}
+
+Recorder::Recorder(const RecorderConfig& c):
+config(c), hasFrame(false), hasRecoveryPoint(false), frameTime_us(0), isEventActive(false),
+eventEnd_us(0), lastTime_us(0), queuedBytes(0), isStopped(false),
+segmentStart_us(0), segmentEnd_us(0), fragmentsWritten(0), bytesWritten(0),
+fragmentsDropped(0), maxWrite_us(0)
+{
+    if(mkdir(config.directory.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        throw std::system_error(errno, std::generic_category(),
+                                "cannot create " + config.directory);
+    }
+    writer = std::thread(&Recorder::writerLoop, this);
+}
+
+Recorder::~Recorder()
+{
+    // the last group of pictures is written as well
+    if(hasFrame)
+    {
+        endFrame(lastTime_us);
+    }
+    endFragment(lastTime_us);
+
+    lock.lock();
+    isStopped = true;
+    lock.unlock();
+    queueWakeup.notify_all();
+    writer.join();
+}
+
+void Recorder::onSample(const NALUnit& sample, uint64_t time_us)
+{
+    lastTime_us = time_us;
+    ForEachNalUnit(reinterpret_cast<const uint8_t *>(sample.data()), sample.size(),
+        [this, time_us](const uint8_t *nal, size_t len)
+        {
+            addNalUnit(nal, len, time_us);
+        }
+    );
+}
+
+void Recorder::addNalUnit(const uint8_t *nal, size_t len, uint64_t time_us)
+{
+    auto type = NalTypeOf(nal);
+    if(type == H264NalType::SPS)
+    {
+        spsData.assign(nal, nal + len);
+        return;
+    }else if(type == H264NalType::PPS)
+    {
+        ppsData.assign(nal, nal + len);
+        return;
+    }else if(type == H264NalType::SEI)
+    {
+        hasRecoveryPoint = hasRecoveryPoint || HasRecoveryPoint(nal, len);
+        return;
+    }
+
+    SliceHeaderStart header;
+    if(!ParseSliceHeaderStart(nal, len, header))
+    {
+        // the parameter sets are in the init segment, SEI and AUD are dropped
+        return;
+    }
+
+    if(header.firstMbInSlice == 0)
+    {
+        bool isJoinPoint = type == H264NalType::IDR || hasRecoveryPoint;
+        hasRecoveryPoint = false;
+        if(hasFrame)
+        {
+            endFrame(time_us);
+        }
+        uint64_t maxFragment_us = uint64_t(config.maxFragmentDuration.count()) * 1000000;
+        if(isJoinPoint)
+        {
+            endFragment(time_us);
+        }else if(current && (time_us - current->time_us >= maxFragment_us
+                             || current->data.size() >= config.maxFragmentBytes))
+        {
+            // the IDRs may be rare, the next fragment continues this one
+            auto continued = std::make_unique<Mp4Fragment>();
+            continued->parameterSets = current->parameterSets;
+            continued->time_us = time_us;
+            endFragment(time_us);
+            current = std::move(continued);
+        }
+        if(!current)
+        {
+            // a fragment starts at a join point with its parameter sets
+            if(!isJoinPoint || spsData.empty() || ppsData.empty())
+            {
+                return;
+            }
+            if(!parameterSets || parameterSets->sps != spsData
+               || parameterSets->pps != ppsData)
+            {
+                parameterSets = std::make_shared<const Mp4ParameterSets>(
+                    Mp4ParameterSets{spsData, ppsData});
+            }
+            current = std::make_unique<Mp4Fragment>();
+            current->parameterSets = parameterSets;
+            current->isJoinPoint = true;
+            current->time_us = time_us;
+        }
+        current->samples.push_back({0, 0, type == H264NalType::IDR});
+        hasFrame = true;
+        frameTime_us = time_us;
+    }else if(!hasFrame)
+    {
+        return;
+    }
+
+    // the start code becomes a 4 byte length
+    uint8_t length[] = {uint8_t(len >> 24), uint8_t(len >> 16),
+                        uint8_t(len >> 8), uint8_t(len)};
+    current->data.insert(current->data.end(), length, length + sizeof(length));
+    current->data.insert(current->data.end(), nal, nal + len);
+    current->samples.back().size += sizeof(length) + len;
+}
+
+void Recorder::endFrame(uint64_t time_us)
+{
+    hasFrame = false;
+    current->samples.back().duration =
+        uint32_t((time_us - frameTime_us) * Mp4Muxer::timescale / 1000000);
+}
+
+void Recorder::endFragment(uint64_t time_us)
+{
+    if(!current || current->samples.empty())
+    {
+        return;
+    }
+    auto fragment = std::move(current);
+    fragment->duration_us = time_us - fragment->time_us;
+
+    bool isRecording = !config.isMotionTriggered || isEventActive
+                       || fragment->time_us < eventEnd_us;
+    if(isRecording)
+    {
+        while(!preEventFragments.empty())
+        {
+            enqueue(std::move(preEventFragments.front()));
+            preEventFragments.pop_front();
+        }
+        enqueue(std::move(fragment));
+        return;
+    }
+
+    // keep at least preEvent before the next event
+    uint64_t preEvent_us = uint64_t(config.preEvent.count()) * 1000000;
+    uint64_t buffered = fragment->duration_us;
+    for(auto& item: preEventFragments)
+    {
+        buffered += item->duration_us;
+    }
+    preEventFragments.push_back(std::move(fragment));
+    while(preEventFragments.size() > 1
+          && buffered - preEventFragments.front()->duration_us >= preEvent_us)
+    {
+        buffered -= preEventFragments.front()->duration_us;
+        preEventFragments.pop_front();
+    }
+}
+
+void Recorder::setEvent(bool isActive)
+{
+    if(!isActive && isEventActive)
+    {
+        eventEnd_us = lastTime_us + uint64_t(config.postEvent.count()) * 1000000;
+    }
+    isEventActive = isActive;
+}
+
+void Recorder::enqueue(std::unique_ptr<Mp4Fragment> fragment)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    if(queuedBytes + fragment->data.size() > config.maxQueuedBytes)
+    {
+        guard.unlock();
+        fragmentsDropped++;
+        ERROR_MESSAGE("the storage is too slow, drop a fragment of %zu bytes.",
+            fragment->data.size());
+        return;
+    }
+    queuedBytes += fragment->data.size();
+    queue.push_back(std::move(fragment));
+    guard.unlock();
+    queueWakeup.notify_one();
+}
+
+void Recorder::writerLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while(true)
+    {
+        queueWakeup.wait(guard, [this](){ return isStopped || !queue.empty(); });
+        if(queue.empty())
+        {
+            break;
+        }
+        auto fragment = std::move(queue.front());
+        queue.pop_front();
+        guard.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            writeFragment(*fragment);
+        }catch(const std::exception& e)
+        {
+            ERROR_MESSAGE("%s", e.what());
+            file.close();
+        }
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        if(elapsed > maxWrite_us)
+        {
+            maxWrite_us = elapsed;
+        }
+
+        guard.lock();
+        queuedBytes -= fragment->data.size();
+    }
+    guard.unlock();
+    file.close();
+}
+
+void Recorder::openSegment(const Mp4Fragment& fragment)
+{
+    char stamp[32];
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+    std::string base = config.directory + "/" + config.name + "-" + stamp;
+    std::string path = base + ".mp4";
+    // more than one segment in a second
+    for(int i = 1; access(path.c_str(), F_OK) == 0; i++)
+    {
+        path = base + "-" + std::to_string(i) + ".mp4";
+    }
+
+    std::vector<uint8_t> init;
+    if(!Mp4Muxer::makeInitSegment(*fragment.parameterSets, init))
+    {
+        throw std::runtime_error("cannot parse the SPS of the recording.");
+    }
+    file.open(path, config.useDirectIO);
+    file.write(init.data(), init.size());
+    bytesWritten += init.size();
+    muxer.reset();
+    fileParameterSets = fragment.parameterSets;
+    segmentStart_us = fragment.time_us;
+    APP_MESSAGE("record into %s.", path.c_str());
+
+    segments.push_back(path);
+    while(config.maxSegments > 0 && segments.size() > config.maxSegments)
+    {
+        unlink(segments.front().c_str());
+        segments.pop_front();
+    }
+}
+
+void Recorder::writeFragment(const Mp4Fragment& fragment)
+{
+    uint64_t segment_us = uint64_t(config.segmentDuration.count()) * 1000000;
+    bool isContinued = file.isOpen() && fragment.parameterSets == fileParameterSets
+                       && fragment.time_us <= segmentEnd_us + maxGap_us;
+    if(!isContinued || (fragment.isJoinPoint && fragment.time_us >= segmentStart_us + segment_us))
+    {
+        if(!fragment.isJoinPoint)
+        {
+            // its frames refer to a fragment which is not in the file, a
+            // new segment waits for a join point
+            return;
+        }
+        openSegment(fragment);
+    }
+
+    std::vector<uint8_t> header;
+    uint64_t baseTime = (fragment.time_us - segmentStart_us)
+                        * Mp4Muxer::timescale / 1000000;
+    muxer.makeFragmentHeader(fragment, baseTime, header);
+    file.write(header.data(), header.size());
+    file.write(fragment.data.data(), fragment.data.size());
+    segmentEnd_us = fragment.time_us + fragment.duration_us;
+    bytesWritten += header.size() + fragment.data.size();
+    fragmentsWritten++;
+}
+
+std::string Recorder::getStatistics()
+{
+    nlohmann::ordered_json json;
+    json["fragments"] = fragmentsWritten.load();
+    json["bytes"] = bytesWritten.load();
+    json["dropped"] = fragmentsDropped.load();
+    json["maxWrite_us"] = maxWrite_us.load();
+    lock.lock();
+    json["queuedBytes"] = queuedBytes;
+    lock.unlock();
+    return json.dump();
+}
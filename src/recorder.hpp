@@ -0,0 +1,154 @@
+/**
+ * @file recorder.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __RECORDER_H
+#define __RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fmp4.hpp"
+#include "streamer.hpp"
+
+struct RecorderConfig
+{
+    std::string directory = "recordings";
+    std::string name = "camera";
+    /* record only around motion events, otherwise all the time */
+    bool isMotionTriggered = false;
+    std::chrono::seconds segmentDuration{300};
+    std::chrono::seconds preEvent{5};
+    std::chrono::seconds postEvent{10};
+    /* a fragment is also closed after this time or size if there is no
+       IDR or recovery point, e.g. with intra refresh */
+    std::chrono::seconds maxFragmentDuration{10};
+    size_t maxFragmentBytes = 8 * 1024 * 1024;
+    /* fragments over it are dropped instead of blocking the capture */
+    size_t maxQueuedBytes = 32 * 1024 * 1024;
+    /* the oldest files are deleted, 0 keeps all */
+    unsigned int maxSegments = 0;
+    bool useDirectIO = true;
+};
+
+/**
+ * @brief a file written with O_DIRECT from aligned blocks, the page cache
+ * is bypassed, so a slow SD card cannot fill the memory with dirty pages.
+ * It falls back to buffered writes if the file system has no O_DIRECT.
+ */
+class DirectFile
+{
+    private:
+        int fd;
+        bool isDirect;
+        uint8_t *block;
+        size_t fill;
+        uint64_t size;
+
+        void writeBlock(size_t len);
+    public:
+        static constexpr size_t alignment = 4096;
+        static constexpr size_t blockSize = 1024 * 1024;
+
+        DirectFile();
+        ~DirectFile();
+        DirectFile(const DirectFile&)=delete;
+        DirectFile& operator=(const DirectFile&)=delete;
+
+        void open(const std::string& path, bool direct);
+        void write(const void *data, size_t len);
+        /* the last block is padded and the file is truncated to its size */
+        void close();
+        bool isOpen() {return fd >= 0;}
+};
+
+/**
+ * @brief record the stream into fragmented MP4 files, one fragment per
+ * group of pictures. A fragment starts at an IDR or a recovery point, or
+ * it continues the previous one after maxFragmentDuration or
+ * maxFragmentBytes.
+ *
+ * the fragments are built in the capture thread and written by an own
+ * thread, so the capture never waits for the storage.
+ */
+class Recorder
+{
+    private:
+        RecorderConfig config;
+
+        /* the state of the capture thread */
+        std::vector<uint8_t> spsData;
+        std::vector<uint8_t> ppsData;
+        std::shared_ptr<const Mp4ParameterSets> parameterSets;
+        std::unique_ptr<Mp4Fragment> current;
+        bool hasFrame;
+        /* a recovery point SEI has come before the next frame */
+        bool hasRecoveryPoint;
+        uint64_t frameTime_us;
+        std::deque<std::unique_ptr<Mp4Fragment>> preEventFragments;
+        std::atomic<bool> isEventActive;
+        std::atomic<uint64_t> eventEnd_us;
+        std::atomic<uint64_t> lastTime_us;
+
+        /* the fragments which wait for the writer */
+        std::deque<std::unique_ptr<Mp4Fragment>> queue;
+        size_t queuedBytes;
+        bool isStopped;
+        std::mutex lock;
+        std::condition_variable queueWakeup;
+        std::thread writer;
+
+        /* the state of the writer thread */
+        DirectFile file;
+        Mp4Muxer muxer;
+        std::shared_ptr<const Mp4ParameterSets> fileParameterSets;
+        uint64_t segmentStart_us;
+        uint64_t segmentEnd_us;
+        std::deque<std::string> segments;
+
+        std::atomic<uint64_t> fragmentsWritten;
+        std::atomic<uint64_t> bytesWritten;
+        std::atomic<uint64_t> fragmentsDropped;
+        std::atomic<uint64_t> maxWrite_us;
+
+        void addNalUnit(const uint8_t *nal, size_t len, uint64_t time_us);
+        void endFrame(uint64_t time_us);
+        void endFragment(uint64_t time_us);
+        void enqueue(std::unique_ptr<Mp4Fragment> fragment);
+        void writerLoop();
+        void writeFragment(const Mp4Fragment& fragment);
+        void openSegment(const Mp4Fragment& fragment);
+    public:
+        Recorder(const RecorderConfig& c);
+        ~Recorder();
+
+        /**
+         * @brief a sample of the stream, it can be fed as a sink of H264VideoStream
+         */
+        void onSample(const NALUnit& sample, uint64_t time_us);
+        /**
+         * @brief start or stop an event, the recording begins preEvent
+         * before it and ends postEvent after it.
+         */
+        void setEvent(bool isActive);
+        /**
+         * @brief written, dropped and the slowest write as JSON
+         */
+        std::string getStatistics();
+};
+
+#endif /* __RECORDER_H */
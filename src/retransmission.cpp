@@ -0,0 +1,193 @@
+/**
+ * @file retransmission.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "retransmission.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <nlohmann/json.hpp>
+
+constexpr size_t rtpHeaderSize = 12;
+constexpr uint8_t rtcpTransportFeedback = 205;
+constexpr uint8_t genericNack = 1;
+
+static uint64_t steadyTime_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RetransmissionStore::RetransmissionStore(uint64_t history):
+history_us(history), bytes(0), shared(0), unshared(0), retransmitted(0), missed(0)
+{}
+
+RetransmissionStore::Payload RetransmissionStore::share(uint64_t frameId, uint32_t fragment,
+                                                        const std::byte *data, size_t size,
+                                                        uint64_t now_us)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    while(!payloads.empty() && payloads.begin()->second.stored_us + history_us < now_us)
+    {
+        bytes -= payloads.begin()->second.payload->size();
+        payloads.erase(payloads.begin());
+    }
+    auto key = std::make_pair(frameId, fragment);
+    auto it = frameId != 0 ? payloads.find(key) : payloads.end();
+    if(it != payloads.end())
+    {
+        auto& payload = *it->second.payload;
+        if(payload.size() == size && std::memcmp(payload.data(), data, size) == 0)
+        {
+            shared++;
+            return it->second.payload;
+        }
+    }
+    // the first track of the frame, or a payload of this track only
+    auto copy = std::make_shared<const rtc::binary>(data, data + size);
+    unshared++;
+    if(frameId != 0 && it == payloads.end())
+    {
+        payloads.emplace(key, Entry{copy, now_us});
+        bytes += size;
+    }
+    return copy;
+}
+
+void RetransmissionStore::countRequest(bool isFound)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    (isFound ? retransmitted : missed)++;
+}
+
+std::string RetransmissionStore::getStatistics()
+{
+    nlohmann::ordered_json json;
+    std::lock_guard<std::mutex> guard(lock);
+    json["storedFragments"] = payloads.size();
+    json["storedBytes"] = bytes;
+    json["sharedPackets"] = shared;
+    json["copiedPackets"] = unshared;
+    json["retransmitted"] = retransmitted;
+    json["missed"] = missed;
+    shared = 0;
+    unshared = 0;
+    retransmitted = 0;
+    missed = 0;
+    return json.dump();
+}
+
+SharedNackResponder::SharedNackResponder(const std::shared_ptr<RetransmissionStore>& s):
+store(s)
+{}
+
+rtc::MediaHandlerElement::ChainedOutgoingProduct
+SharedNackResponder::processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                                  rtc::message_ptr control)
+{
+    if(!messages)
+    {
+        return {messages, control};
+    }
+    uint64_t now_us = steadyTime_us();
+    uint64_t id = frameId;
+    std::lock_guard<std::mutex> guard(lock);
+    for(size_t i = 0; i < messages->size(); i++)
+    {
+        auto& packet = (*messages)[i];
+        if(packet.size() < rtpHeaderSize)
+        {
+            continue;
+        }
+        // the header of this track: the fixed header, CSRCs and extensions
+        size_t headerSize = rtpHeaderSize + 4 * (uint8_t(packet[0]) & 0x0f);
+        if((uint8_t(packet[0]) & 0x10) != 0 && packet.size() >= headerSize + 4)
+        {
+            headerSize += 4 + 4 * ((uint8_t(packet[headerSize + 2]) << 8)
+                                   | uint8_t(packet[headerSize + 3]));
+        }
+        headerSize = std::min(headerSize, packet.size());
+        uint16_t sequence = uint16_t((uint8_t(packet[2]) << 8) | uint8_t(packet[3]));
+        history[sequence] = Packet{
+            rtc::binary(packet.begin(), packet.begin() + headerSize),
+            store->share(id, uint32_t(i), packet.data() + headerSize,
+                         packet.size() - headerSize, now_us),
+            now_us};
+        order.push_back(sequence);
+    }
+    while(!order.empty())
+    {
+        auto it = history.find(order.front());
+        if(it != history.end() && order.size() <= maxPackets
+           && it->second.stored_us + store->getHistory_us() >= now_us)
+        {
+            break;
+        }
+        if(it != history.end())
+        {
+            history.erase(it);
+        }
+        order.pop_front();
+    }
+    return {messages, control};
+}
+
+rtc::MediaHandlerElement::ChainedIncomingControlProduct
+SharedNackResponder::processIncomingControlMessage(rtc::message_ptr message)
+{
+    auto packets = std::make_shared<std::vector<rtc::binary>>();
+    auto request = [this, &packets](uint16_t sequence)
+    {
+        auto it = history.find(sequence);
+        store->countRequest(it != history.end());
+        if(it != history.end())
+        {
+            rtc::binary packet(it->second.header);
+            packet.insert(packet.end(), it->second.payload->begin(), it->second.payload->end());
+            packets->push_back(std::move(packet));
+        }
+    };
+
+    // PID and BLP of the FCI entries, the bit i of BLP is PID + i + 1
+    auto data = reinterpret_cast<const uint8_t *>(message->data());
+    size_t pos = 0;
+    std::lock_guard<std::mutex> guard(lock);
+    while(pos + 4 <= message->size())
+    {
+        uint8_t format = data[pos] & 0x1f;
+        uint8_t type = data[pos + 1];
+        size_t end = std::min(message->size(),
+                              pos + 4 * (((data[pos + 2] << 8) | data[pos + 3]) + 1));
+        if(type == rtcpTransportFeedback && format == genericNack)
+        {
+            for(size_t fci = pos + 12; fci + 4 <= end; fci += 4)
+            {
+                uint16_t pid = uint16_t((data[fci] << 8) | data[fci + 1]);
+                uint16_t blp = uint16_t((data[fci + 2] << 8) | data[fci + 3]);
+                request(pid);
+                for(int bit = 0; bit < 16; bit++)
+                {
+                    if(blp & (1 << bit))
+                    {
+                        request(uint16_t(pid + bit + 1));
+                    }
+                }
+            }
+        }
+        pos = end > pos ? end : message->size();
+    }
+    if(packets->empty())
+    {
+        return {message};
+    }
+    return {message, ChainedOutgoingProduct(packets)};
+}
@@ -0,0 +1,116 @@
+/**
+ * @file retransmission.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __RETRANSMISSION_H
+#define __RETRANSMISSION_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <rtc/rtc.hpp>
+
+/**
+ * @brief the payloads of the recently sent RTP packets of a stream, by
+ * frame and fragment. The tracks send the same payloads, so they hold
+ * one copy of them and only their own RTP headers.
+ */
+class RetransmissionStore
+{
+    public:
+        using Payload = std::shared_ptr<const rtc::binary>;
+    private:
+        struct Entry
+        {
+            Payload payload;
+            uint64_t stored_us;
+        };
+
+        const uint64_t history_us;
+        std::mutex lock;
+        /* frame and fragment, the old frames are in front */
+        std::map<std::pair<uint64_t, uint32_t>, Entry> payloads;
+        size_t bytes;
+        uint64_t shared;
+        uint64_t unshared;
+        uint64_t retransmitted;
+        uint64_t missed;
+    public:
+        /* how long a packet can be requested again */
+        static constexpr uint64_t defaultHistory_us = 1000 * 1000;
+
+        RetransmissionStore(uint64_t history_us=defaultHistory_us);
+        ~RetransmissionStore()=default;
+
+        uint64_t getHistory_us() {return history_us;}
+        /**
+         * @brief the stored payload of the fragment if it has these bytes,
+         * otherwise a copy which is stored if the place is free
+         *
+         * @param frameId the frame of the live stream, 0 keeps the copy out
+         * of the store
+         */
+        Payload share(uint64_t frameId, uint32_t fragment,
+                      const std::byte *data, size_t size, uint64_t now_us);
+        void countRequest(bool isFound);
+        /**
+         * @brief the stored bytes and the shared and retransmitted packets
+         * since the last call
+         */
+        std::string getStatistics();
+};
+
+/**
+ * @brief answers the generic NACKs (RFC 4585 6.2.1) of a track, in place of
+ * rtc::RtcpNackResponder. It keeps the RTP header of each sent packet and
+ * the payload of the store, a requested packet is put together again.
+ */
+class SharedNackResponder: public rtc::MediaHandlerElement
+{
+    private:
+        struct Packet
+        {
+            rtc::binary header;
+            RetransmissionStore::Payload payload;
+            uint64_t stored_us;
+        };
+
+        std::shared_ptr<RetransmissionStore> store;
+        std::atomic<uint64_t> frameId{0};
+        std::mutex lock;
+        std::map<uint16_t, Packet> history;
+        /* the sequence numbers in the order they were sent */
+        std::deque<uint16_t> order;
+    public:
+        /* bounds the history of a track, like the size of RtcpNackResponder */
+        static constexpr size_t maxPackets = 4096;
+
+        SharedNackResponder(const std::shared_ptr<RetransmissionStore>& store);
+        ~SharedNackResponder()=default;
+
+        /**
+         * @brief the frame of the live stream which is sent next, 0 if it
+         * is not shared
+         */
+        void setFrame(uint64_t id) {frameId = id;}
+
+        ChainedOutgoingProduct processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                                            rtc::message_ptr control) override;
+        ChainedIncomingControlProduct processIncomingControlMessage(rtc::message_ptr message) override;
+};
+
+#endif /* __RETRANSMISSION_H */
@@ -40,60 +40,227 @@ const std::string messageErrorTypeString[] =
 constexpr size_t ROAPMessageErrorTypeNum = 
 sizeof(messageErrorTypeString)/sizeof(std::string);
 
-void ROAPMessage::parser(std::string data)
+const std::string sessionStateString[] =
 {
-    if(nlohmann::json::accept(data))
-    {
-        std::string value;
-        auto rootJosn = nlohmann::json::parse(data);
-        if(rootJosn.contains("messageType"))
+    "Start",
+    "WaitAnswer",
+    "WaitCompleted",
+    "Completed",
+    "WaitForShutdown",
+    "Closed"
+};
+static_assert(sizeof(sessionStateString)/sizeof(std::string) == ROAPSessionStateNum);
+
+std::string StrOfSessionState(ROAPSessionState state)
+{
+    return sessionStateString[uint8_t(state)];
+}
+
+/**
+ * @brief SAX handler which fills a ROAPMessage while the payload is parsed,
+ * so no DOM is built and every string is moved into the message instead of
+ * being copied. Only the keys of the top level object are used.
+ */
+class ROAPMessageSax
+{
+    private:
+        enum class Field : uint8_t
+        {
+            None,
+            MessageType,
+            ErrorType,
+            OffererSessionId,
+            AnswererSessionId,
+            Seq,
+            Sdp,
+            TieBreaker
+        };
+        ROAPMessage &message;
+        Field field = Field::None;
+        int depth = 0;
+
+        bool setNumber(uint64_t value)
+        {
+            if(depth == 1 && field == Field::Seq)
+            {
+                message.seq = uint32_t(value);
+            }else if(depth == 1 && field == Field::TieBreaker)
+            {
+                message.tieBreaker = uint32_t(value);
+            }
+            return true;
+        }
+    public:
+        std::string error;
+        ROAPMessageSax(ROAPMessage &m): message(m) {}
+
+        bool null() {return true;}
+        bool boolean(bool) {return true;}
+        bool number_integer(int64_t value)
+        {
+            return value < 0 ? true : setNumber(uint64_t(value));
+        }
+        bool number_unsigned(uint64_t value) {return setNumber(value);}
+        bool number_float(double, const std::string&) {return true;}
+        bool binary(std::vector<uint8_t>&) {return true;}
+        bool start_object(size_t)
+        {
+            depth++;
+            field = Field::None;
+            return true;
+        }
+        bool end_object()
+        {
+            depth--;
+            field = Field::None;
+            return true;
+        }
+        bool start_array(size_t)
+        {
+            depth++;
+            return true;
+        }
+        bool end_array()
+        {
+            depth--;
+            return true;
+        }
+        bool key(std::string& name)
         {
-            value = rootJosn["messageType"].get<std::string>();
-            for(size_t i=0; i < ROAPMessageTypeNum; i++)
+            field = Field::None;
+            if(depth != 1 || name.empty())
+            {
+                return true;
+            }
+            // dispatch on the first letter, then confirm the whole name
+            switch(name[0])
             {
-                if(value.compare(messageTypeString[i]) == 0)
+                case 'm': if(name == "messageType") field = Field::MessageType; break;
+                case 'e': if(name == "errorType") field = Field::ErrorType; break;
+                case 'o': if(name == "offererSessionId") field = Field::OffererSessionId; break;
+                case 'a': if(name == "answererSessionId") field = Field::AnswererSessionId; break;
+                case 's':
                 {
-                    messageType = ROAPMessageType(i);
+                    if(name == "seq") field = Field::Seq;
+                    else if(name == "sdp") field = Field::Sdp;
                     break;
                 }
+                case 't': if(name == "tieBreaker") field = Field::TieBreaker; break;
             }
+            return true;
         }
-        if(rootJosn.contains("errorType"))
+        bool string(std::string& value)
         {
-            value = rootJosn["errorType"].get<std::string>();
-            for(size_t i=0; i < ROAPMessageErrorTypeNum; i++)
+            if(depth != 1)
             {
-                if(value.compare(messageErrorTypeString[i]) == 0)
+                return true;
+            }
+            switch(field)
+            {
+                case Field::MessageType:
+                {
+                    for(size_t i=0; i < ROAPMessageTypeNum; i++)
+                    {
+                        if(value == messageTypeString[i])
+                        {
+                            message.messageType = ROAPMessageType(i);
+                            break;
+                        }
+                    }
+                    break;
+                }
+                case Field::ErrorType:
+                {
+                    for(size_t i=0; i < ROAPMessageErrorTypeNum; i++)
+                    {
+                        if(value == messageErrorTypeString[i])
+                        {
+                            message.errorType = ROAPMessageErrorType(i);
+                            break;
+                        }
+                    }
+                    break;
+                }
+                case Field::OffererSessionId:
                 {
-                    errorType = ROAPMessageErrorType(i);
+                    message.offererSessionId = std::move(value);
                     break;
                 }
+                case Field::AnswererSessionId:
+                {
+                    message.answererSessionId = std::move(value);
+                    break;
+                }
+                case Field::Sdp:
+                {
+                    message.sdp = std::move(value);
+                    break;
+                }
+                default: break;
             }
+            return true;
         }
-        if(rootJosn.contains("offererSessionId"))
+        bool parse_error(size_t, const std::string&, const nlohmann::json::exception& e)
         {
-            offererSessionId = rootJosn["offererSessionId"].get<std::string>();
+            error = e.what();
+            return false;
         }
-        if(rootJosn.contains("answererSessionId"))
+};
+
+ROAPEncoding ROAPMessage::detectEncoding(const std::string& data)
+{
+    if(data.empty())
+    {
+        return ROAPEncoding::Json;
+    }
+
+    uint8_t first = uint8_t(data[0]);
+    if(first >= 0xa0 && first <= 0xbf)
+    {
+        // CBOR map
+        return ROAPEncoding::Cbor;
+    }else if((first >= 0x80 && first <= 0x8f) || first == 0xde || first == 0xdf)
+    {
+        // MessagePack map
+        return ROAPEncoding::MessagePack;
+    }
+    return ROAPEncoding::Json;
+}
+
+void ROAPMessage::parser(const std::string& data)
+{
+    ROAPMessageSax sax(*this);
+    bool ok;
+
+    encoding = detectEncoding(data);
+    switch(encoding)
+    {
+        case ROAPEncoding::Cbor:
         {
-            answererSessionId = rootJosn["answererSessionId"].get<std::string>();
+            ok = nlohmann::json::sax_parse(data, &sax,
+                nlohmann::json::input_format_t::cbor);
+            break;
         }
-        if(rootJosn.contains("seq"))
+        case ROAPEncoding::MessagePack:
         {
-            seq = rootJosn["seq"].get<unsigned>();
+            ok = nlohmann::json::sax_parse(data, &sax,
+                nlohmann::json::input_format_t::msgpack);
+            break;
         }
-        if(rootJosn.contains("sdp"))
+        default:
         {
-            sdp = rootJosn["sdp"].get<std::string>();
+            ok = nlohmann::json::sax_parse(data, &sax);
+            break;
         }
+    }
 
-    }else
+    if(!ok)
     {
-        throw std::runtime_error("Invaild Json formate.");
+        throw std::runtime_error("Invaild ROAP message: " + sax.error);
     }
 }
 
-std::string ROAPMessage::toString()
+std::string ROAPMessage::toString(ROAPEncoding format)
 {
     nlohmann::ordered_json json;
 
@@ -140,12 +307,103 @@ std::string ROAPMessage::toString()
     {
         json["sdp"] = sdp;
     }
-    return std::forward<std::string>(json.dump(4));
+    if(tieBreaker > 0)
+    {
+        json["tieBreaker"] = tieBreaker;
+    }
+
+    switch(format)
+    {
+        case ROAPEncoding::Cbor:
+        {
+            auto bytes = nlohmann::ordered_json::to_cbor(json);
+            return std::string(bytes.begin(), bytes.end());
+        }
+        case ROAPEncoding::MessagePack:
+        {
+            auto bytes = nlohmann::ordered_json::to_msgpack(json);
+            return std::string(bytes.begin(), bytes.end());
+        }
+        default:
+        {
+            return json.dump();
+        }
+    }
+}
+
+ROAPEncoding StrToEncoding(const std::string& name)
+{
+    if(name == "cbor")
+    {
+        return ROAPEncoding::Cbor;
+    }else if(name == "msgpack")
+    {
+        return ROAPEncoding::MessagePack;
+    }
+    return ROAPEncoding::Json;
+}
+
+void NotifyMessage::parser(const std::string& data)
+{
+    // an empty notify is a client from before the negotiation, use the defaults
+    if(data.empty())
+    {
+        return;
+    }
+
+    auto rootJson = nlohmann::json::parse(data, nullptr, false);
+    if(rootJson.is_discarded() || !rootJson.is_object())
+    {
+        throw std::runtime_error("Invaild notify message.");
+    }
+    if(rootJson.contains("encoding"))
+    {
+        encoding = StrToEncoding(rootJson["encoding"].get<std::string>());
+    }
+    if(rootJson.contains("viewerId"))
+    {
+        viewerId = rootJson["viewerId"].get<std::string>();
+        // it will be a topic level
+        if(viewerId.find_first_of("/+#") != std::string::npos)
+        {
+            throw std::runtime_error("Invaild viewer id: " + viewerId);
+        }
+    }
+    if(rootJson.contains("class"))
+    {
+        priorityClass = rootJson["class"].get<std::string>();
+    }
+    if(rootJson.contains("timeshift"))
+    {
+        timeshift_s = rootJson["timeshift"].get<uint32_t>();
+        rate = rootJson.value("rate", 1.0);
+        if(rate < 1.0 || rate > 8.0)
+        {
+            throw std::runtime_error("Invaild time shift rate.");
+        }
+    }
+    if(rootJson.contains("playoutDelay"))
+    {
+        auto delayJson = rootJson["playoutDelay"];
+        minPlayoutDelay_ms = delayJson.value("min", 0);
+        maxPlayoutDelay_ms = delayJson.value("max", minPlayoutDelay_ms);
+        if(minPlayoutDelay_ms < 0 || maxPlayoutDelay_ms < minPlayoutDelay_ms)
+        {
+            throw std::runtime_error("Invaild playout delay.");
+        }
+    }
+    if(rootJson.contains("viewport"))
+    {
+        auto viewportJson = rootJson["viewport"];
+        viewportWidth = viewportJson.value("width", 0u);
+        viewportHeight = viewportJson.value("height", 0u);
+    }
 }
 
 ROAPSession::ROAPSession(std::string id):
 myId(id), currentSeq(1),
-state(ROAPSessionState::Start)
+state(ROAPSessionState::Start),
+stateSince(std::chrono::steady_clock::now())
 {}
 
 ROAPSession::ROAPSession(ROAPSession&& session):
@@ -153,38 +411,194 @@ myId(std::move(session.myId)),
 yourId(std::move(session.yourId)),
 currentSeq(session.currentSeq), state(session.state),
 remoteSdp(std::move(session.remoteSdp)),
-localSdp(std::move(session.localSdp))
+localSdp(std::move(session.localSdp)),
+stateSince(session.stateSince),
+stateDurations(session.stateDurations)
 {}
 
+void ROAPSession::setState(ROAPSessionState s)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> guard(stateLock);
+    stateDurations[uint8_t(state)] += now - stateSince;
+    stateSince = now;
+    state = s;
+}
+
+bool ROAPSession::setStateUnlessClosed(ROAPSessionState s)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> guard(stateLock);
+    if(state == ROAPSessionState::Closed)
+    {
+        return false;
+    }
+    stateDurations[uint8_t(state)] += now - stateSince;
+    stateSince = now;
+    state = s;
+    return true;
+}
+
+ROAPSessionState ROAPSession::getState()
+{
+    std::lock_guard<std::mutex> guard(stateLock);
+    return state;
+}
+
+std::chrono::steady_clock::duration ROAPSession::getStateAge()
+{
+    std::lock_guard<std::mutex> guard(stateLock);
+    return std::chrono::steady_clock::now() - stateSince;
+}
+
+ROAPStateDurations ROAPSession::getStateDurations()
+{
+    std::lock_guard<std::mutex> guard(stateLock);
+    auto durations = stateDurations;
+    durations[uint8_t(state)] += std::chrono::steady_clock::now() - stateSince;
+    return durations;
+}
+
 OfferSession::OfferSession(
-    std::string id, std::shared_ptr<MqttConnect> conn):
-ROAPSession(id), mqttConn(conn)
-{}
+    std::string id, std::shared_ptr<MqttConnect> conn, ROAPEncoding e,
+    std::string topic):
+ROAPSession(id), mqttConn(conn), encoding(e), replyTopic(topic),
+isOfferLost(std::make_shared<std::atomic<bool>>(false)), offerRetries(0),
+tieBreaker(0), hasCompleted(false), isRenegotiationPending(false),
+isSignaledOutOfBand(false)
+{
+    std::random_device rd;
+    rng.seed(rd());
+}
 
 OfferSession::OfferSession(OfferSession&& session):
-ROAPSession(std::move(session)), mqttConn(std::move(session.mqttConn))
+ROAPSession(std::move(session)), mqttConn(std::move(session.mqttConn)),
+encoding(session.encoding), replyTopic(std::move(session.replyTopic)),
+isOfferLost(std::move(session.isOfferLost)),
+offerRetries(session.offerRetries), rng(std::move(session.rng)),
+tieBreaker(session.tieBreaker), hasCompleted(session.hasCompleted),
+isRenegotiationPending(session.isRenegotiationPending),
+isSignaledOutOfBand(session.isSignaledOutOfBand)
 {}
 
 void OfferSession::sendOffer(std::string sdp)
 {
-    ROAPMessage packet;
-    if(state == ROAPSessionState::Closed)
+    if(getState() == ROAPSessionState::Closed)
     {
         ERROR_MESSAGE("the offerer(%s) is closed", myId.c_str());
     }
+    localSdp = sdp;
+    offerRetries = 0;
+    isRenegotiationPending = false;
+    // a new tie breaker for every offer, two equal ones are a double conflict
+    tieBreaker = std::uniform_int_distribution<uint32_t>(1, UINT32_MAX)(rng);
+    setState(ROAPSessionState::WaitAnswer);
+    publishOffer();
+}
+
+void OfferSession::sendAnswer(std::string sdp)
+{
+    ROAPMessage packet;
+    localSdp = sdp;
+    packet.messageType = ROAPMessageType::Answer;
+    packet.offererSessionId = myId;
+    packet.answererSessionId = yourId;
+    packet.seq = currentSeq;
+    packet.sdp = sdp;
+    setState(ROAPSessionState::WaitCompleted);
+    mqttConn->publishMessage(replyTopic, packet.toString(encoding));
+}
+
+void OfferSession::completeOutOfBand(const std::string& local, const std::string& remote)
+{
+    localSdp = local;
+    remoteSdp = remote;
+    hasCompleted = true;
+    isSignaledOutOfBand = true;
+    setState(ROAPSessionState::Completed);
+}
+
+void OfferSession::publishReply(const ROAPMessage &in, ROAPMessageType type,
+                                ROAPMessageErrorType errorType)
+{
+    ROAPMessage out;
+    out.messageType = type;
+    out.errorType = errorType;
+    out.offererSessionId = in.offererSessionId;
+    out.answererSessionId = in.answererSessionId;
+    out.seq = in.seq;
+    mqttConn->publishMessage(replyTopic, out.toString(encoding));
+}
+
+void OfferSession::abandonOffer(bool retry)
+{
+    if(onRollback)
+    {
+        onRollback();
+    }
+    isRenegotiationPending = retry;
+    setState(ROAPSessionState::Completed);
+}
+
+void OfferSession::acceptOffer(ROAPMessage &in)
+{
+    currentSeq = in.seq;
+    remoteSdp = in.sdp;
+    // the answer will be sent by sendAnswer() when it has been created
+    onRemoteOffer(in.sdp);
+}
+
+void OfferSession::publishOffer()
+{
+    ROAPMessage packet;
     packet.messageType = ROAPMessageType::Offer;
     packet.offererSessionId = myId;
+    packet.answererSessionId = yourId;
     packet.seq=currentSeq;
-    packet.sdp = sdp;
-    state = ROAPSessionState::WaitAnswer;
-    mqttConn->publishMessage("webrtc/roap/app", packet.toString());
+    packet.sdp = localSdp;
+    packet.tieBreaker = tieBreaker;
+    isOfferLost->store(false);
+    mqttConn->publishMessage(replyTopic, packet.toString(encoding),
+        [lost = isOfferLost](bool delivered)
+        {
+            if(!delivered)
+            {
+                lost->store(true);
+            }
+        }
+    );
+}
+
+bool OfferSession::retryLostOffer()
+{
+    if(getState() != ROAPSessionState::WaitAnswer || !isOfferLost->load())
+    {
+        return true;
+    }
+    if(offerRetries >= maxOfferRetries)
+    {
+        return false;
+    }
+    offerRetries++;
+    ERROR_MESSAGE("the offer of %s is lost, send it again (%u).",
+        myId.c_str(), offerRetries);
+    publishOffer();
+    return true;
 }
 
 void OfferSession::processMessage(ROAPMessage &in)
 {
     ROAPMessage out;
+    if(isSignaledOutOfBand)
+    {
+        publishReply(in, ROAPMessageType::Error, ROAPMessageErrorType::NoMatch);
+        return;
+    }
+    // a new offer of the answerer may skip sequence numbers
+    bool isNewOffer = in.messageType == ROAPMessageType::Offer
+                      && in.seq > currentSeq;
 
-    if(in.seq != currentSeq)
+    if(in.seq != currentSeq && !isNewOffer)
     {
         out.messageType = ROAPMessageType::Error;
         out.errorType = ROAPMessageErrorType::Failed;
@@ -192,8 +606,8 @@ void OfferSession::processMessage(ROAPMessage &in)
         out.answererSessionId = in.answererSessionId;
         out.seq = in.seq;
         
-        mqttConn->publishMessage("webrtc/roap/app", out.toString());
-        state = ROAPSessionState::Closed;
+        mqttConn->publishMessage(replyTopic, out.toString(encoding));
+        setState(ROAPSessionState::Closed);
         onClose();
     }
     else if(!(yourId.empty() ||
@@ -205,23 +619,23 @@ void OfferSession::processMessage(ROAPMessage &in)
         out.answererSessionId = in.answererSessionId;
         out.seq = currentSeq;
 
-        mqttConn->publishMessage("webrtc/roap/app", out.toString());  
-        state = ROAPSessionState::Closed;
+        mqttConn->publishMessage(replyTopic, out.toString(encoding));  
+        setState(ROAPSessionState::Closed);
         onClose();         
     }else
     {
-        switch (state)
+        switch (getState())
         {
             case ROAPSessionState::Start:
             {
                 if(in.messageType == ROAPMessageType::Shutdown)
                 {
-                    state=ROAPSessionState::Closed;
+                    setState(ROAPSessionState::Closed);
                     out.messageType = ROAPMessageType::Ok;
                     out.offererSessionId = in.offererSessionId;
                     out.answererSessionId = in.answererSessionId;
                     out.seq = in.seq;
-                    mqttConn->publishMessage("webrtc/roap/app", out.toString());
+                    mqttConn->publishMessage(replyTopic, out.toString(encoding));
                     onClose();
                 }
                 break;
@@ -237,26 +651,58 @@ void OfferSession::processMessage(ROAPMessage &in)
         
                     remoteSdp = in.sdp;
                     onRemoteSDP(in.sdp);
-                    state = ROAPSessionState::Completed;
+                    hasCompleted = true;
+                    setState(ROAPSessionState::Completed);
                     out.messageType = ROAPMessageType::Ok;
                     out.offererSessionId = in.offererSessionId;
-                    out.answererSessionId = out.answererSessionId;
+                    out.answererSessionId = in.answererSessionId;
                     out.seq = currentSeq;
                     currentSeq++;
-                    mqttConn->publishMessage("webrtc/roap/app", out.toString());
+                    mqttConn->publishMessage(replyTopic, out.toString(encoding));
+                }else if(in.messageType == ROAPMessageType::Offer)
+                {
+                    // glare: both sides have sent an offer, the larger
+                    // tie breaker wins
+                    if(in.tieBreaker == tieBreaker)
+                    {
+                        publishReply(in, ROAPMessageType::Error,
+                                     ROAPMessageErrorType::DoubleConflict);
+                        abandonOffer(true);
+                    }else if(in.tieBreaker < tieBreaker)
+                    {
+                        publishReply(in, ROAPMessageType::Error,
+                                     ROAPMessageErrorType::Conflict);
+                    }else
+                    {
+                        abandonOffer(false);
+                        acceptOffer(in);
+                    }
                 }else if(in.messageType == ROAPMessageType::Error)
                 {
                     ERROR_MESSAGE("ROAP Error: %x", uint8_t(in.errorType));
-                    state = ROAPSessionState::Closed;     
-                    
+                    if(in.errorType == ROAPMessageErrorType::Conflict)
+                    {
+                        // the answerer has won, its offer is on the way
+                        abandonOffer(false);
+                    }else if(in.errorType == ROAPMessageErrorType::DoubleConflict)
+                    {
+                        abandonOffer(true);
+                    }else if(hasCompleted)
+                    {
+                        // a refused re-offer keeps the current media
+                        abandonOffer(false);
+                    }else
+                    {
+                        setState(ROAPSessionState::Closed);
+                    }
                 }else if(in.messageType == ROAPMessageType::Shutdown)
                 {
-                    state=ROAPSessionState::Closed;
+                    setState(ROAPSessionState::Closed);
                     out.messageType = ROAPMessageType::Ok;
                     out.offererSessionId = in.offererSessionId;
                     out.answererSessionId = in.answererSessionId;
                     out.seq = in.seq;
-                    mqttConn->publishMessage("webrtc/roap/app", out.toString());
+                    mqttConn->publishMessage(replyTopic, out.toString(encoding));
                 }
                 
                 break;
@@ -266,15 +712,21 @@ void OfferSession::processMessage(ROAPMessage &in)
                 if(in.messageType == ROAPMessageType::Ok)
                 {
                     currentSeq++;
-                    state=ROAPSessionState::Completed;
+                    setState(ROAPSessionState::Completed);
+                }else if(in.messageType == ROAPMessageType::Error)
+                {
+                    // the offerer does not accept the answer
+                    ERROR_MESSAGE("ROAP Error: %x", uint8_t(in.errorType));
+                    currentSeq++;
+                    setState(ROAPSessionState::Completed);
                 }else if(in.messageType == ROAPMessageType::Shutdown)
                 {
-                    state=ROAPSessionState::Closed;
+                    setState(ROAPSessionState::Closed);
                     out.messageType = ROAPMessageType::Ok;
                     out.offererSessionId = in.offererSessionId;
                     out.answererSessionId = in.answererSessionId;
                     out.seq = in.seq;
-                    mqttConn->publishMessage("webrtc/roap/app", out.toString());
+                    mqttConn->publishMessage(replyTopic, out.toString(encoding));
                     onClose();
                 }
                 
@@ -282,22 +734,31 @@ void OfferSession::processMessage(ROAPMessage &in)
             }
             case ROAPSessionState::Completed:
             {
+                if(in.messageType == ROAPMessageType::Offer)
+                {
+                    acceptOffer(in);
+                }else if(in.messageType == ROAPMessageType::Shutdown)
+                {
+                    setState(ROAPSessionState::Closed);
+                    publishReply(in, ROAPMessageType::Ok);
+                    onClose();
+                }
                 break;
             }
             case ROAPSessionState::WaitForShutdown:
             {
                 if(in.messageType == ROAPMessageType::Ok) 
                 {
-                    state=ROAPSessionState::Closed;
+                    setState(ROAPSessionState::Closed);
                     onClose();
                 }else if(in.messageType == ROAPMessageType::Shutdown)
                 {
-                    state=ROAPSessionState::Closed;
+                    setState(ROAPSessionState::Closed);
                     out.messageType = ROAPMessageType::Ok;
                     out.offererSessionId = in.offererSessionId;
                     out.answererSessionId = in.answererSessionId;
                     out.seq = in.seq;
-                    mqttConn->publishMessage("webrtc/roap/app", out.toString());
+                    mqttConn->publishMessage(replyTopic, out.toString(encoding));
                     
                     onClose();                
                 }else
@@ -306,7 +767,7 @@ void OfferSession::processMessage(ROAPMessage &in)
                     out.offererSessionId = in.offererSessionId;
                     out.answererSessionId = in.answererSessionId;
                     out.seq = in.seq;
-                    mqttConn->publishMessage("webrtc/roap/app", out.toString());
+                    mqttConn->publishMessage(replyTopic, out.toString(encoding));
                 }
                 
                 break;
@@ -318,7 +779,7 @@ void OfferSession::processMessage(ROAPMessage &in)
                 out.offererSessionId = in.offererSessionId;
                 out.answererSessionId = out.answererSessionId;
                 out.seq = currentSeq;  
-                mqttConn->publishMessage("webrtc/roap/app", out.toString());
+                mqttConn->publishMessage(replyTopic, out.toString(encoding));
                 
                 break;
             }   
@@ -330,10 +791,22 @@ void OfferSession::processMessage(ROAPMessage &in)
 
 void OfferSession::close()
 {
-    if(state == ROAPSessionState::Closed)
+    // the reaper and the callbacks of the PeerConnection may close the
+    // session at the same time, only one of them goes on
+    if(isSignaledOutOfBand)
+    {
+        // nobody waits for a shutdown, the viewer has hung up or is gone
+        if(setStateUnlessClosed(ROAPSessionState::Closed) && onClose)
+        {
+            onClose();
+        }
         return;
+    }
 
-    state = ROAPSessionState::WaitForShutdown;
+    if(!setStateUnlessClosed(ROAPSessionState::WaitForShutdown))
+    {
+        return;
+    }
     
     ROAPMessage packet;
     packet.messageType = ROAPMessageType::Shutdown;
@@ -341,5 +814,5 @@ void OfferSession::close()
     packet.answererSessionId = yourId;
     packet.seq = currentSeq;
     
-    mqttConn->publishMessage("webrtc/roap/app", packet.toString());
+    mqttConn->publishMessage(replyTopic, packet.toString(encoding));
 }
\ No newline at end of file
@@ -14,9 +14,14 @@
 
 #include <stdint.h>
 #include <map>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <functional>
+#include <random>
 
 #include "mqtt_connect.hpp"
 #include "random_id.hpp"
@@ -44,6 +49,15 @@ enum class ROAPMessageErrorType : uint8_t
     Failed
 };
 
+enum class ROAPEncoding : uint8_t
+{
+    Json,
+    Cbor,
+    MessagePack
+};
+
+ROAPEncoding StrToEncoding(const std::string& name);
+
 enum class ROAPSessionState : uint8_t
 {
     Start,
@@ -53,6 +67,15 @@ enum class ROAPSessionState : uint8_t
     WaitForShutdown,
     Closed
 };
+constexpr size_t ROAPSessionStateNum = 6;
+
+using ROAPStateDurations =
+    std::array<std::chrono::steady_clock::duration, ROAPSessionStateNum>;
+
+std::string StrOfSessionState(ROAPSessionState state);
+
+/* the replies to the viewers are on <ROAPBroadcastTopic>/<stream>[/<viewerId>] */
+const std::string ROAPBroadcastTopic = "webrtc/roap/app";
 
 class ROAPMessage
 {
@@ -63,9 +86,45 @@ class ROAPMessage
         std::string answererSessionId;
         uint32_t seq=0;
         std::string sdp;
+        /* random number of an offer to resolve glare */
+        uint32_t tieBreaker=0;
+        /* encoding of the parsed message */
+        ROAPEncoding encoding=ROAPEncoding::Json;
         ROAPMessage()=default;
-        void parser(std::string data);
-        std::string toString();
+        /**
+         * @brief decode a JSON, CBOR or MessagePack message in a single pass
+         */
+        void parser(const std::string& data);
+        /**
+         * @brief encode the message, JSON is minified
+         */
+        std::string toString(ROAPEncoding format=ROAPEncoding::Json);
+        static ROAPEncoding detectEncoding(const std::string& data);
+};
+
+/**
+ * @brief the message of a client on the notify topic to request a session
+ */
+class NotifyMessage
+{
+    public:
+        ROAPEncoding encoding=ROAPEncoding::Json;
+        /* the viewer has its own reply topic if it is not empty */
+        std::string viewerId;
+        /* priority class of the viewer, e.g. operator */
+        std::string priorityClass;
+        /* start this many seconds in the past and catch up at the rate */
+        uint32_t timeshift_s=0;
+        double rate=1.0;
+        /* playout-delay hint in ms, e.g. 0/0 for a console, -1 for none */
+        int32_t minPlayoutDelay_ms=-1;
+        int32_t maxPlayoutDelay_ms=-1;
+        /* the size of the player, it gets no larger encoding. 0 is unknown */
+        uint32_t viewportWidth=0;
+        uint32_t viewportHeight=0;
+        NotifyMessage()=default;
+        ~NotifyMessage()=default;
+        void parser(const std::string& data);
 };
 
 class ROAPSession
@@ -77,11 +136,29 @@ class ROAPSession
         ROAPSessionState state;
         std::string remoteSdp;
         std::string localSdp;
+        std::chrono::steady_clock::time_point stateSince;
+        ROAPStateDurations stateDurations{};
+        std::mutex stateLock;
 
+        void setState(ROAPSessionState s);
+        /**
+         * @brief change the state in one step with the check, false if the
+         * session is closed already
+         */
+        bool setStateUnlessClosed(ROAPSessionState s);
     public:
         ROAPSession(std::string id);
         ROAPSession(ROAPSession&& session);
         ~ROAPSession()=default;
+        ROAPSessionState getState();
+        /**
+         * @brief how long the session has been in its current state
+         */
+        std::chrono::steady_clock::duration getStateAge();
+        /**
+         * @brief time spent in every state, including the current one
+         */
+        ROAPStateDurations getStateDurations();
 };
 
 
@@ -89,15 +166,68 @@ class OfferSession: public ROAPSession
 {
     private:
         std::shared_ptr<MqttConnect> mqttConn;
+        ROAPEncoding encoding;
+        std::string replyTopic;
+        /* set by the MQTT thread, it may outlive the session */
+        std::shared_ptr<std::atomic<bool>> isOfferLost;
+        unsigned int offerRetries;
+        std::mt19937 rng;
+        uint32_t tieBreaker;
+        bool hasCompleted;
+        bool isRenegotiationPending;
+        /* the offer and answer have not been exchanged by ROAP */
+        bool isSignaledOutOfBand;
+
+        void publishOffer();
+        void publishReply(const ROAPMessage &in, ROAPMessageType type,
+                          ROAPMessageErrorType errorType=ROAPMessageErrorType::Invaild);
+        /**
+         * @brief give up the outstanding offer and keep the current media
+         *
+         * @param retry offer again later, after a double conflict
+         */
+        void abandonOffer(bool retry);
+        void acceptOffer(ROAPMessage &in);
     public:
-        OfferSession(std::string id, std::shared_ptr<MqttConnect> conn);
+        static constexpr unsigned int maxOfferRetries = 3;
+        OfferSession(std::string id, std::shared_ptr<MqttConnect> conn,
+                     ROAPEncoding e=ROAPEncoding::Json,
+                     std::string topic=ROAPBroadcastTopic);
         OfferSession(OfferSession&& session);
         ~OfferSession()=default;
         std::function<void(std::string sdp)> onRemoteSDP=nullptr;
+        /* the answerer sends a new offer, the answer is sent by sendAnswer() */
+        std::function<void(std::string sdp)> onRemoteOffer=nullptr;
+        /* the outstanding local offer has been abandoned */
+        std::function<void()> onRollback=nullptr;
         std::function<void()> onClose=nullptr;
-        bool isclosed()  noexcept {return state == ROAPSessionState::Closed;}
+        bool isclosed()  noexcept {return getState() == ROAPSessionState::Closed;}
         std::string getId()  noexcept {return myId;}
+        /**
+         * @brief send the first offer or a new one in a completed session,
+         * the seq is increased for every offer/answer exchange.
+         */
         void sendOffer(std::string sdp);
+        void sendAnswer(std::string sdp);
+        /**
+         * @brief the offer and answer have been exchanged by another
+         * signaling, e.g. WHEP over HTTP. The session is completed and
+         * sends no ROAP messages, close() closes it at once.
+         */
+        void completeOutOfBand(const std::string& local, const std::string& remote);
+        bool isOutOfBand() noexcept {return isSignaledOutOfBand;}
+        bool isEstablished() noexcept {return hasCompleted;}
+        /**
+         * @brief an offer has been given up after a double conflict and
+         * should be sent again
+         */
+        bool needRenegotiation() noexcept {return isRenegotiationPending;}
+        /**
+         * @brief send the offer again if it has not been delivered
+         *
+         * @return false if the offer has been lost too many times
+         */
+        bool retryLostOffer();
         void processMessage(ROAPMessage &in);
         std::string& getRemoteSdp(){return remoteSdp;}
         void close();
@@ -0,0 +1,136 @@
+/**
+ * @file rtp_extension.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "rtp_extension.hpp"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+const std::string RtpHeaderExtender::playoutDelayUri =
+    "http://www.webrtc.org/experiments/rtp-hdrext/playout-delay";
+const std::string RtpHeaderExtender::absCaptureTimeUri =
+    "http://www.webrtc.org/experiments/rtp-hdrext/abs-capture-time";
+
+/* seconds from 1900 (NTP) to 1970 (unix) */
+constexpr uint64_t ntpUnixOffset_s = 2208988800ULL;
+constexpr uint8_t rtpExtensionBit = 0x10;
+
+void RtpHeaderExtender::setIds(int playoutDelay, int absCaptureTime)
+{
+    // the one byte header has the ids 1 to 14
+    playoutDelayId = playoutDelay > 0 && playoutDelay < 15 ? playoutDelay : 0;
+    absCaptureTimeId = absCaptureTime > 0 && absCaptureTime < 15 ? absCaptureTime : 0;
+}
+
+void RtpHeaderExtender::setPlayoutDelay(uint32_t min_ms, uint32_t max_ms)
+{
+    min_ms = std::min<uint32_t>(min_ms, maxPlayoutDelay_ms);
+    max_ms = std::min<uint32_t>(std::max(min_ms, max_ms), maxPlayoutDelay_ms);
+    minDelay = uint16_t(min_ms / 10);
+    maxDelay = uint16_t((max_ms + 9) / 10);
+}
+
+void RtpHeaderExtender::setCaptureTime(uint64_t captureTime_us)
+{
+    if(captureTime_us == 0)
+    {
+        captureTimeNtp = 0;
+        return;
+    }
+    // the steady clock of the capture on the wall clock of now
+    using namespace std::chrono;
+    int64_t age_us = duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()).count() - int64_t(captureTime_us);
+    uint64_t wall_us = duration_cast<microseconds>(
+        system_clock::now().time_since_epoch()).count() - std::max<int64_t>(age_us, 0);
+    uint64_t seconds = wall_us / 1000000 + ntpUnixOffset_s;
+    uint64_t fraction = ((wall_us % 1000000) << 32) / 1000000;
+    captureTimeNtp = (seconds << 32) | fraction;
+}
+
+rtc::MediaHandlerElement::ChainedOutgoingProduct
+RtpHeaderExtender::processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                                rtc::message_ptr control)
+{
+    // the packets of one frame come together, the receiver takes the
+    // extensions of its first packet
+    if(!messages || messages->empty())
+    {
+        return {messages, control};
+    }
+    int delayId = playoutDelayId, captureId = absCaptureTimeId;
+    uint64_t ntp = captureTimeNtp;
+    std::vector<std::byte> elements;
+    if(delayId > 0)
+    {
+        uint16_t min = minDelay, max = maxDelay;
+        elements.push_back(std::byte((delayId << 4) | (3 - 1)));
+        elements.push_back(std::byte(min >> 4));
+        elements.push_back(std::byte(((min & 0x0f) << 4) | (max >> 8)));
+        elements.push_back(std::byte(max & 0xff));
+    }
+    if(captureId > 0 && ntp != 0)
+    {
+        elements.push_back(std::byte((captureId << 4) | (8 - 1)));
+        for(int shift = 56; shift >= 0; shift -= 8)
+        {
+            elements.push_back(std::byte(ntp >> shift));
+        }
+    }
+    auto& packet = messages->front();
+    if(elements.empty() || packet.size() < 12
+       || (uint8_t(packet[0]) & rtpExtensionBit) != 0)
+    {
+        return {messages, control};
+    }
+
+    elements.resize((elements.size() + 3) / 4 * 4, std::byte(0));
+    uint16_t words = uint16_t(elements.size() / 4);
+    std::byte header[] = {std::byte(0xbe), std::byte(0xde),
+                          std::byte(words >> 8), std::byte(words & 0xff)};
+    size_t offset = 12 + 4 * (uint8_t(packet[0]) & 0x0f);
+    if(offset > packet.size())
+    {
+        return {messages, control};
+    }
+    elements.insert(elements.begin(), std::begin(header), std::end(header));
+    packet.insert(packet.begin() + offset, elements.begin(), elements.end());
+    packet[0] |= std::byte(rtpExtensionBit);
+    return {messages, control};
+}
+
+int RtpHeaderExtender::findExtMapId(const std::string& sdp, const std::string& uri)
+{
+    // a=extmap:<id>[/<direction>] <uri> [<attributes>]
+    std::istringstream lines(sdp);
+    std::string line;
+    while(std::getline(lines, line))
+    {
+        if(line.compare(0, 9, "a=extmap:") != 0)
+        {
+            continue;
+        }
+        size_t space = line.find(' ');
+        if(space == std::string::npos)
+        {
+            continue;
+        }
+        size_t end = line.find_first_of(" \r", space + 1);
+        if(line.substr(space + 1, end - space - 1) == uri)
+        {
+            return atoi(line.c_str() + 9);
+        }
+    }
+    return 0;
+}
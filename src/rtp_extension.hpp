@@ -0,0 +1,73 @@
+/**
+ * @file rtp_extension.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __RTP_EXTENSION_H
+#define __RTP_EXTENSION_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include <rtc/rtc.hpp>
+
+/**
+ * @brief add one byte RTP header extensions (RFC 8285) to the first packet
+ * of every frame, it is chained after the packetizer:
+ *
+ *  playout-delay     the min and max delay of the receiver's jitter buffer
+ *  abs-capture-time  the NTP time when the frame has been captured
+ *
+ * An extension with the id 0 is not negotiated and not sent.
+ */
+class RtpHeaderExtender: public rtc::MediaHandlerElement
+{
+    private:
+        std::atomic<int> playoutDelayId{0};
+        std::atomic<int> absCaptureTimeId{0};
+        /* 12 bits each, in 10 ms */
+        std::atomic<uint16_t> minDelay{0};
+        std::atomic<uint16_t> maxDelay{0};
+        /* NTP time of the frame which is packetized, 0 if it is unknown */
+        std::atomic<uint64_t> captureTimeNtp{0};
+    public:
+        static const std::string playoutDelayUri;
+        static const std::string absCaptureTimeUri;
+        /* in the offers of the camera */
+        static constexpr int defaultPlayoutDelayId = 5;
+        static constexpr int defaultAbsCaptureTimeId = 6;
+        static constexpr int maxPlayoutDelay_ms = 4095 * 10;
+
+        RtpHeaderExtender()=default;
+        ~RtpHeaderExtender()=default;
+
+        void setIds(int playoutDelay, int absCaptureTime);
+        int getPlayoutDelayId() {return playoutDelayId;}
+        int getAbsCaptureTimeId() {return absCaptureTimeId;}
+        /**
+         * @brief the hint for the receiver, 0/0 renders every frame at once
+         */
+        void setPlayoutDelay(uint32_t min_ms, uint32_t max_ms);
+        /**
+         * @brief for the next frame, in us of std::chrono::steady_clock
+         */
+        void setCaptureTime(uint64_t captureTime_us);
+
+        ChainedOutgoingProduct processOutgoingBinaryMessage(ChainedMessagesProduct messages,
+                                                            rtc::message_ptr control) override;
+
+        /**
+         * @brief the id of an "a=extmap" line of the SDP, 0 if it has none
+         */
+        static int findExtMapId(const std::string& sdp, const std::string& uri);
+};
+
+#endif /* __RTP_EXTENSION_H */
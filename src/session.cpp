@@ -11,14 +11,72 @@
 #include "session.hpp"
 #include "utility.h"
 
+#include <future>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+/* a viewer stays in its encoding while it takes up to this part of the
+   estimate, like the temporal layers. A larger one must fit in less */
+constexpr double switchDownHeadroom = 0.85;
+constexpr double switchUpHeadroom = 0.7;
+
+/**
+ * @brief the smallest encoding which covers the viewport, the largest if
+ * the viewport is unknown or larger than all
+ */
+static size_t EncodingOfViewport(const std::vector<StreamEncoding>& encodings,
+                                 uint32_t width, uint32_t height)
+{
+    size_t index = 0;
+    if(width == 0 && height == 0)
+    {
+        return index;
+    }
+    for(size_t i = 1; i < encodings.size(); i++)
+    {
+        if(encodings[i].width < width || encodings[i].height < height)
+        {
+            break;
+        }
+        index = i;
+    }
+    return index;
+}
+
 RTCPeerSession::RTCPeerSession(std::string id, const rtc::Configuration &config,
                                const std::shared_ptr<MqttConnect>& conn,
-                               RTCPeerSessionManager &mg):
-isWilldestroyed(false), sessionId(id), pc(config),
-offerer(id, conn), manager(mg)
+                               RTCPeerSessionManager &mg,
+                               const NotifyMessage& notify):
+isWilldestroyed(false), pendingRenegotiation(false), sessionId(id), pc(config),
+timeshift_us(uint64_t(notify.timeshift_s) * 1000000), rate(notify.rate),
+viewerId(notify.viewerId), isRoapSignaled(true),
+viewportWidth(notify.viewportWidth), viewportHeight(notify.viewportHeight),
+encoding(notify.timeshift_s > 0 ? 0 : EncodingOfViewport(mg.encodings, notify.viewportWidth,
+                                                         notify.viewportHeight)),
+isSwitchable(false), isClosed(false),
+offerer(id, conn, notify.encoding,
+        mg.getReplyTopic(notify.viewerId)),
+manager(mg)
 {
     double duration_s = double(manager.stream->getDuration_us()) / 1000*1000;
     videoTrack = std::make_shared<H264VideoTrack>(duration_s);
+    if(notify.minPlayoutDelay_ms >= 0)
+    {
+        videoTrack->setPlayoutDelay(notify.minPlayoutDelay_ms, notify.maxPlayoutDelay_ms);
+    }
+    if(manager.pacing)
+    {
+        auto pacer = std::make_shared<RtpPacer>(manager.pacing,
+                                                manager.stream->getDuration_us());
+        manager.pacing->add(pacer);
+        videoTrack->setPacer(pacer);
+    }
+    if(manager.fec)
+    {
+        videoTrack->setFec(manager.fec);
+    }
+    videoTrack->setRetransmissionStore(manager.retransmissions);
     videoTrack->onStart(
         [this]()
         {
@@ -31,6 +89,8 @@ RTCPeerSession::~RTCPeerSession()
 {
     APP_MESSAGE("session (id: %s) will be destoryed!", getId().c_str());
     isWilldestroyed = true;
+    // the player must not hand the track over any more
+    player.reset();
     pc.close();
 }
 
@@ -41,20 +101,77 @@ std::string RTCPeerSession::getLocalSdp()
 
 void RTCPeerSession::setRemoteSdp(std::string sdp)
 {
+    videoTrack->acceptExtensions(sdp);
+    videoTrack->acceptFec(sdp);
     pc.setRemoteDescription(rtc::Description(sdp, "answer"));
 }
 
+std::shared_ptr<TrackUsage> RTCPeerSession::getUsage()
+{
+    return videoTrack->getUsage();
+}
+
+unsigned int RTCPeerSession::getMaxTemporalLayer()
+{
+    return videoTrack->getMaxTemporalLayer();
+}
+
+size_t RTCPeerSession::getEncoding()
+{
+    return encoding;
+}
+
+void RTCPeerSession::selectEncoding()
+{
+    auto& encodings = manager.encodings;
+    if(!isSwitchable || encodings.size() < 2)
+    {
+        return;
+    }
+    size_t current = encoding;
+    size_t index = EncodingOfViewport(encodings, viewportWidth, viewportHeight);
+    double estimate_bps = videoTrack->getEstimate_bps();
+    if(estimate_bps > 0)
+    {
+        while(index + 1 < encodings.size())
+        {
+            double headroom = index < current ? switchUpHeadroom : switchDownHeadroom;
+            if(encodings[index].stream->getBitrate_bps() <= headroom * estimate_bps)
+            {
+                break;
+            }
+            index++;
+        }
+    }
+    if(index != current)
+    {
+        APP_MESSAGE("session (id: %s) switches to %ux%u at %.0f kbit/s.",
+            sessionId.c_str(), encodings[index].width, encodings[index].height,
+            estimate_bps / 1000);
+        encoding = index;
+        encodings[index].stream->switchTrack(sessionId, videoTrack);
+    }
+}
+
 std::string RTCPeerSession::getId()
 {
     return sessionId;
 }
 
+bool RTCPeerSession::isOwnedBy(const std::string& viewer)
+{
+    return isRoapSignaled && viewerId == viewer;
+}
+
 void RTCPeerSession::open()
 {
     pc.onGatheringStateChange(
         [this](rtc::PeerConnection::GatheringState state)
         {
-            if(state == rtc::PeerConnection::GatheringState::Complete)
+            // the candidates are gathered only once, re-offers are sent
+            // by renegotiate()
+            if(state == rtc::PeerConnection::GatheringState::Complete
+               && this->offerer.getState() == ROAPSessionState::Start)
             {
                 auto localSdp = this->getLocalSdp();
                 this->offerer.sendOffer(localSdp);
@@ -62,6 +179,35 @@ void RTCPeerSession::open()
         }
     );
 
+    watchConnection();
+
+    offerer.onRemoteSDP = [this](std::string sdp)
+    {
+        this->setRemoteSdp(sdp);
+    };
+    
+    offerer.onRemoteOffer = [this](std::string sdp)
+    {
+        pc.setRemoteDescription(rtc::Description(sdp, "offer"));
+        this->offerer.sendAnswer(this->getLocalSdp());
+    };
+
+    offerer.onRollback = [this]()
+    {
+        pc.setLocalDescription(rtc::Description::Type::Rollback);
+    };
+
+    offerer.onClose = [this](){
+        pc.close();
+    };
+
+    videoTrack->addVideo(pc);
+
+    pc.setLocalDescription(rtc::Description::Type::Offer);
+}
+
+void RTCPeerSession::watchConnection()
+{
     pc.onStateChange(
         [this](rtc::PeerConnection::State state)
         {
@@ -79,19 +225,121 @@ void RTCPeerSession::open()
             }
         }
     );
+}
 
-    offerer.onRemoteSDP = [this](std::string sdp)
+std::string RTCPeerSession::answer(const std::string& offerSdp,
+                                   std::chrono::milliseconds timeout)
+{
+    isRoapSignaled = false;
+    rtc::Description offer(offerSdp, rtc::Description::Type::Offer);
+
+    // the first video of the offer with H.264 in packetization mode 1,
+    // constrained baseline like the camera if it is offered
+    std::string mid;
+    int payloadType = -1;
+    bool isBaseline = false;
+    for(int i = 0; i < offer.mediaCount() && !isBaseline; i++)
     {
-        this->setRemoteSdp(sdp);
-    };
-    
+        auto entry = offer.media(i);
+        if(!std::holds_alternative<rtc::Description::Media *>(entry))
+        {
+            continue;
+        }
+        auto media = std::get<rtc::Description::Media *>(entry);
+        if(media->type() != "video" || (!mid.empty() && media->mid() != mid))
+        {
+            continue;
+        }
+        for(int type: media->payloadTypes())
+        {
+            auto map = media->rtpMap(type);
+            if(map == nullptr || map->format != "H264")
+            {
+                continue;
+            }
+            std::string fmtp;
+            for(auto& item: map->fmtps)
+            {
+                fmtp += item + ";";
+            }
+            if(fmtp.find("packetization-mode=1") == std::string::npos)
+            {
+                continue;
+            }
+            if(payloadType < 0 || fmtp.find("profile-level-id=42e0") != std::string::npos)
+            {
+                mid = media->mid();
+                payloadType = type;
+                isBaseline = fmtp.find("profile-level-id=42e0") != std::string::npos;
+            }
+            if(isBaseline)
+            {
+                break;
+            }
+        }
+    }
+    if(payloadType < 0)
+    {
+        throw std::invalid_argument("the offer has no H.264 video.");
+    }
+
+    // the callback may come after a timeout
+    auto gathered = std::make_shared<std::promise<void>>();
+    auto isGathered = gathered->get_future();
+    pc.onGatheringStateChange(
+        [gathered](rtc::PeerConnection::GatheringState state)
+        {
+            if(state == rtc::PeerConnection::GatheringState::Complete)
+            {
+                gathered->set_value();
+            }
+        }
+    );
+    watchConnection();
     offerer.onClose = [this](){
         pc.close();
     };
 
-    videoTrack->addVideo(pc);
+    videoTrack->acceptExtensions(offerSdp);
+    videoTrack->acceptFec(offerSdp);
+    videoTrack->addVideo(pc, mid, payloadType);
+    // the answer is created by the auto negotiation
+    pc.setRemoteDescription(offer);
+    if(isGathered.wait_for(timeout) != std::future_status::ready)
+    {
+        throw std::runtime_error("the ICE candidates are not gathered in time.");
+    }
+    auto localSdp = getLocalSdp();
+    offerer.completeOutOfBand(localSdp, offerSdp);
+    return localSdp;
+}
 
+void RTCPeerSession::renegotiate()
+{
+    if(offerer.isOutOfBand())
+    {
+        // the viewer cannot be reached, it has to join again
+        return;
+    }
+    if(!offerer.isEstablished() && offerer.getState() == ROAPSessionState::Start)
+    {
+        // the first offer has not been sent, it will be the current one
+        return;
+    }
+    if(offerer.getState() != ROAPSessionState::Completed)
+    {
+        // an exchange is running, the manager will try it again
+        pendingRenegotiation = true;
+        return;
+    }
+    pendingRenegotiation = false;
     pc.setLocalDescription(rtc::Description::Type::Offer);
+    offerer.sendOffer(getLocalSdp());
+}
+
+bool RTCPeerSession::needRenegotiation()
+{
+    return pendingRenegotiation || offerer.needRenegotiation();
 }
 
 void RTCPeerSession::close()
@@ -99,6 +347,7 @@ void RTCPeerSession::close()
     if(!isWilldestroyed)
     {
         auto id = this->getId();
+        isClosed = true;
         this->manager.deleteRTCPeerSession(id);
         APP_MESSAGE("connect (id: %s) will be destoryed...", id.c_str());
     }
@@ -106,19 +355,121 @@ void RTCPeerSession::close()
 
 void RTCPeerSession::addToStream()
 {
-    videoTrack->sendKeyframe(manager.stream->getInitialNALUS());
-    manager.stream->addTrack(sessionId, videoTrack);
+    if(timeshift_us > 0 && manager.timeShift)
+    {
+        player = std::make_unique<TimeShiftPlayer>(manager.timeShift, videoTrack,
+                                                   timeshift_us, rate);
+        player->start(
+            [this](bool hasPlayed)
+            {
+                if(!hasPlayed)
+                {
+                    manager.stream->joinTrack(sessionId, videoTrack);
+                }else
+                {
+                    manager.stream->addTrack(sessionId, videoTrack);
+                }
+                isSwitchable = true;
+            }
+        );
+        return;
+    }
+    auto& encodings = manager.encodings;
+    auto stream = encodings.empty() ? manager.stream : encodings[encoding].stream;
+    stream->joinTrack(sessionId, videoTrack);
+    isSwitchable = true;
 }
 
 RTCPeerSessionManager::RTCPeerSessionManager(
+    const std::string& name,
     rtc::Configuration&& config,
     const std::shared_ptr<MqttConnect>& conn,
-    const std::shared_ptr<H264VideoStream>& s):
-config(config), mqttConn(conn), stream(s)
-{}
+    const std::shared_ptr<H264VideoStream>& s,
+    const RTCPeerSessionLimits& l,
+    const std::shared_ptr<ResourceGovernor>& g):
+streamName(name), config(config), mqttConn(conn), limits(l), isReaperStopped(false),
+reapedClosed(0), reapedTimeout(0), refused(0), preempted(0),
+pendingAnswers(0), answered(0), governor(g), stream(s)
+{
+    if(limits.isPaced)
+    {
+        pacing = std::make_shared<PacingScheduler>(limits.pacing);
+    }
+    if(limits.hasFec)
+    {
+        fec = std::make_shared<FecCache>();
+    }
+    retransmissions = std::make_shared<RetransmissionStore>(
+        std::chrono::duration_cast<std::chrono::microseconds>(limits.nackHistory).count());
+    reaper = std::thread(&RTCPeerSessionManager::reaperLoop, this);
+}
+
+RTCPeerSessionManager::~RTCPeerSessionManager()
+{
+    reaperLock.lock();
+    isReaperStopped = true;
+    reaperLock.unlock();
+    reaperWakeup.notify_all();
+    reaper.join();
+
+    if(governor)
+    {
+        for(auto& item: peerSessions)
+        {
+            governor->remove(getGovernorKey(item.first));
+        }
+    }
+}
+
+void RTCPeerSessionManager::reaperLoop()
+{
+    auto nextReport = std::chrono::steady_clock::now() + limits.reportInterval;
+    std::unique_lock<std::mutex> guard(reaperLock);
+
+    while(!isReaperStopped)
+    {
+        reaperWakeup.wait_for(guard, limits.reapInterval);
+        if(isReaperStopped)
+        {
+            break;
+        }
+        guard.unlock();
+
+        if(certificate)
+        {
+            try
+            {
+                // the sessions keep their certificate, the new ones get this one
+                certificate->refresh();
+            }catch(const std::exception& e)
+            {
+                ERROR_MESSAGE("cannot rotate the DTLS certificate: %s", e.what());
+            }
+        }
+        loopHandler();
+        if(std::chrono::steady_clock::now() >= nextReport)
+        {
+            mqttConn->publishMessage("webrtc/stats/" + streamName, getStatistics());
+            nextReport += limits.reportInterval;
+        }
+
+        guard.lock();
+    }
+}
 
-void RTCPeerSessionManager::createRTCPeerSession()
+std::unique_ptr<RTCPeerSession> RTCPeerSessionManager::admitRTCPeerSession(
+    const NotifyMessage& notify, std::vector<std::function<void()>>& preemptions)
 {
+    std::unique_ptr<RTCPeerSession> session;
+
+    if(peerSessions.size() + pendingAnswers >= limits.maxSessions)
+    {
+        refused++;
+        ERROR_MESSAGE("too many sessions (%d), refuse a new one.",
+            int(peerSessions.size() + pendingAnswers));
+        return nullptr;
+    }
+
     auto id = uidg.allocateAUniqueId();
     APP_MESSAGE("allocated a id: %s.", id.c_str());
     while(peerSessions.find(id) != peerSessions.end())
@@ -127,17 +478,187 @@ void RTCPeerSessionManager::createRTCPeerSession()
         id = uidg.allocateAUniqueId();
     } 
 
-    auto session = 
-        std::make_unique<RTCPeerSession>(id, config, mqttConn, *this);
+    NotifyMessage options = notify;
+    if(options.minPlayoutDelay_ms < 0)
+    {
+        options.minPlayoutDelay_ms = limits.minPlayoutDelay_ms;
+        options.maxPlayoutDelay_ms = limits.maxPlayoutDelay_ms;
+    }
+    {
+        std::unique_lock<std::mutex> files;
+        if(certificate)
+        {
+            files = certificate->lockFiles();
+        }
+        session = std::make_unique<RTCPeerSession>(id, config, mqttConn, *this, options);
+    }
+    if(governor && !governor->admit(getGovernorKey(id),
+                        governor->getPriority(notify.priorityClass),
+                        session->getUsage(),
+                        [this, id](){ this->preemptRTCPeerSession(id); },
+                        preemptions))
+    {
+        refused++;
+        return nullptr;
+    }
+    return session;
+}
+
+bool RTCPeerSessionManager::createRTCPeerSession(const NotifyMessage& notify)
+{
+    std::vector<std::function<void()>> preemptions;
+
+    sessionsLock.lock();
+    auto session = admitRTCPeerSession(notify, preemptions);
+    if(!session)
+    {
+        sessionsLock.unlock();
+        sendRefusal(notify);
+        return false;
+    }
+    auto id = session->getId();
     session->open();
     peerSessions.insert({id, std::move(session)});
+    sessionsLock.unlock();
+
+    // the preempted sessions may belong to this manager
+    for(auto& preempt: preemptions)
+    {
+        preempt();
+    }
+    return true;
 }
 
-void RTCPeerSessionManager::processMessage(std::string message)
+bool RTCPeerSessionManager::answerRTCPeerSession(const NotifyMessage& notify,
+                                                 const std::string& offer,
+                                                 std::string& id, std::string& answer)
+{
+    std::vector<std::function<void()>> preemptions;
+
+    sessionsLock.lock();
+    auto session = admitRTCPeerSession(notify, preemptions);
+    if(session)
+    {
+        pendingAnswers++;
+    }
+    sessionsLock.unlock();
+
+    for(auto& preempt: preemptions)
+    {
+        preempt();
+    }
+    if(!session)
+    {
+        return false;
+    }
+
+    id = session->getId();
+    try
+    {
+        // the gathering takes a while, the other sessions are not blocked
+        answer = session->answer(offer, limits.gatherTimeout);
+    }catch(const std::exception& e)
+    {
+        sessionsLock.lock();
+        pendingAnswers--;
+        sessionsLock.unlock();
+        if(governor)
+        {
+            governor->remove(getGovernorKey(id));
+        }
+        throw;
+    }
+
+    sessionsLock.lock();
+    pendingAnswers--;
+    answered++;
+    // a session closed during the answer has been reported to the reaper
+    // before it is in the sessions, report it again
+    bool hasClosed = session->hasClosed();
+    peerSessions.insert({id, std::move(session)});
+    sessionsLock.unlock();
+    if(hasClosed)
+    {
+        deleteRTCPeerSession(id);
+    }
+    return true;
+}
+
+bool RTCPeerSessionManager::closeRTCPeerSession(const std::string& id)
+{
+    std::lock_guard<std::mutex> guard(sessionsLock);
+    auto it = peerSessions.find(id);
+    if(it == peerSessions.end() || !it->second->offerer.isOutOfBand())
+    {
+        return false;
+    }
+    removeFromStreams(id);
+    it->second->offerer.close();
+    return true;
+}
+
+void RTCPeerSessionManager::sendRefusal(const NotifyMessage& notify)
+{
+    ROAPMessage out;
+    out.messageType = ROAPMessageType::Error;
+    out.errorType = ROAPMessageErrorType::Refused;
+    mqttConn->publishMessage(getReplyTopic(notify.viewerId),
+                             out.toString(notify.encoding));
+}
+
+void RTCPeerSessionManager::preemptRTCPeerSession(const std::string& id)
+{
+    std::lock_guard<std::mutex> guard(sessionsLock);
+    auto it = peerSessions.find(id);
+    if(it != peerSessions.end())
+    {
+        // stop the media at once, the reaper erases it after the shutdown
+        removeFromStreams(id);
+        it->second->offerer.close();
+        preempted++;
+    }
+}
+
+void RTCPeerSessionManager::removeFromStreams(const std::string& id)
+{
+    stream->deleteById(id);
+    for(auto& item: encodings)
+    {
+        if(item.stream != stream)
+        {
+            item.stream->deleteById(id);
+        }
+    }
+}
+
+std::string RTCPeerSessionManager::getGovernorKey(const std::string& id)
+{
+    return streamName + "/" + id;
+}
+
+std::string RTCPeerSessionManager::getReplyTopic(const std::string& viewerId)
+{
+    if(viewerId.empty())
+    {
+        return ROAPBroadcastTopic + "/" + streamName;
+    }
+    return ROAPBroadcastTopic + "/" + streamName + "/" + viewerId;
+}
+
+void RTCPeerSessionManager::processMessage(std::string message,
+                                           const std::string& viewerId)
 {
     ROAPMessage in;
     in.parser(message);
+    std::lock_guard<std::mutex> guard(sessionsLock);
     auto it  = peerSessions.find(in.offererSessionId);
+    if(it != peerSessions.end() && !it->second->isOwnedBy(viewerId))
+    {
+        // another viewer must not answer or shut down the session
+        ERROR_MESSAGE("viewer '%s' is not the owner of session %s.",
+            viewerId.c_str(), in.offererSessionId.c_str());
+        it = peerSessions.end();
+    }
 
     if(it == peerSessions.end())
     {
@@ -150,7 +671,7 @@ void RTCPeerSessionManager::processMessage(std::string message)
             out.answererSessionId = in.answererSessionId;
             out.seq = in.seq;
 
-            mqttConn->publishMessage("webrtc/roap/app", out.toString());
+            mqttConn->publishMessage(getReplyTopic(viewerId), out.toString(in.encoding));
         }
 
     }else
@@ -162,18 +683,172 @@ void RTCPeerSessionManager::processMessage(std::string message)
 
 void RTCPeerSessionManager::deleteRTCPeerSession(const std::string& id)
 {
-    stream->deleteById(id);
+    removeFromStreams(id);
     lock.lock();
     closedSessions.push_back(id);
     lock.unlock();
 }
 
+void RTCPeerSessionManager::renegotiateAll()
+{
+    std::lock_guard<std::mutex> guard(sessionsLock);
+    for(auto& item: peerSessions)
+    {
+        item.second->renegotiate();
+    }
+}
+
 void RTCPeerSessionManager::loopHandler()
 {
+    std::vector<std::string> closedIds;
+    std::vector<std::unique_ptr<RTCPeerSession>> reaped;
+
     lock.lock();
-    for(auto id: closedSessions)
+    closedIds.swap(closedSessions);
+    lock.unlock();
+
+    sessionsLock.lock();
+    for(auto& id: closedIds)
     {
-        peerSessions.erase(id);
+        auto it = peerSessions.find(id);
+        if(it != peerSessions.end())
+        {
+            reapedClosed++;
+            reaped.push_back(std::move(it->second));
+            peerSessions.erase(it);
+        }
     }
-    lock.unlock();
+
+    for(auto it = peerSessions.begin(); it != peerSessions.end();)
+    {
+        auto& offerer = it->second->offerer;
+        auto state = offerer.getState();
+        auto timeout = limits.stateTimeout[uint8_t(state)];
+
+        if(state == ROAPSessionState::Closed)
+        {
+            reapedClosed++;
+        }else if(timeout.count() > 0 && offerer.getStateAge() > timeout)
+        {
+            APP_MESSAGE("session (id: %s) is timeout in state %s.",
+                it->first.c_str(), StrOfSessionState(state).c_str());
+            offerer.close();
+            reapedTimeout++;
+        }else if(!offerer.retryLostOffer())
+        {
+            APP_MESSAGE("the offer of session (id: %s) cannot be delivered.",
+                it->first.c_str());
+            offerer.close();
+            reapedTimeout++;
+        }else
+        {
+            if(state == ROAPSessionState::Completed
+               && it->second->needRenegotiation())
+            {
+                it->second->renegotiate();
+            }
+            if(state == ROAPSessionState::Completed)
+            {
+                it->second->selectEncoding();
+            }
+            ++it;
+            continue;
+        }
+        removeFromStreams(it->first);
+        reaped.push_back(std::move(it->second));
+        it = peerSessions.erase(it);
+    }
+
+    for(auto& session: reaped)
+    {
+        if(governor)
+        {
+            governor->remove(getGovernorKey(session->getId()));
+        }
+        auto durations = session->offerer.getStateDurations();
+        for(size_t i = 0; i < ROAPSessionStateNum; i++)
+        {
+            reapedStateDurations[i] += durations[i];
+        }
+    }
+    sessionsLock.unlock();
+
+    // destroy the peer connections without holding the lock
+    reaped.clear();
+}
+
+std::string RTCPeerSessionManager::getStatistics()
+{
+    nlohmann::ordered_json json;
+    ROAPStateDurations durations;
+    std::array<size_t, ROAPSessionStateNum> states{};
+
+    std::array<size_t, maxTemporalLayers> layers{};
+    std::vector<size_t> viewers(encodings.size());
+    sessionsLock.lock();
+    durations = reapedStateDurations;
+    for(auto& [id, session]: peerSessions)
+    {
+        layers[session->getMaxTemporalLayer()]++;
+        if(!viewers.empty())
+        {
+            viewers[session->getEncoding()]++;
+        }
+        auto sessionDurations = session->offerer.getStateDurations();
+        for(size_t i = 0; i < ROAPSessionStateNum; i++)
+        {
+            durations[i] += sessionDurations[i];
+        }
+        states[uint8_t(session->offerer.getState())]++;
+    }
+    json["sessions"] = peerSessions.size();
+    json["refused"] = refused;
+    json["preempted"] = preempted;
+    json["answered"] = answered;
+    json["reaped"]["closed"] = reapedClosed;
+    json["reaped"]["timeout"] = reapedTimeout;
+    sessionsLock.unlock();
+
+    for(size_t i = 0; i < ROAPSessionStateNum; i++)
+    {
+        auto name = StrOfSessionState(ROAPSessionState(i));
+        json["states"][name] = states[i];
+        json["stateSeconds"][name] =
+            std::chrono::duration<double>(durations[i]).count();
+    }
+    if(governor)
+    {
+        json["governor"] = nlohmann::ordered_json::parse(governor->getStatistics());
+    }
+    json["stream"] = nlohmann::ordered_json::parse(stream->getStatistics());
+    if(stream->getTemporalLayers() > 1)
+    {
+        // the viewers by the highest temporal layer which they receive
+        json["viewerLayers"] = layers;
+    }
+    for(size_t i = 0; i < encodings.size(); i++)
+    {
+        // the first one is the stream above
+        auto& item = encodings[i];
+        nlohmann::ordered_json encodingJson;
+        encodingJson["width"] = item.width;
+        encodingJson["height"] = item.height;
+        encodingJson["bitrate_kbps"] = item.stream->getBitrate_bps() / 1000;
+        encodingJson["viewers"] = viewers[i];
+        if(item.stream != stream)
+        {
+            encodingJson["stream"] = nlohmann::ordered_json::parse(item.stream->getStatistics());
+        }
+        json["encodings"].push_back(encodingJson);
+    }
+    if(pacing)
+    {
+        json["pacing"] = nlohmann::ordered_json::parse(pacing->getStatistics());
+    }
+    if(fec)
+    {
+        json["fec"] = nlohmann::ordered_json::parse(fec->getStatistics());
+    }
+    json["retransmissions"] = nlohmann::ordered_json::parse(retransmissions->getStatistics());
+    return json.dump();
 }
\ No newline at end of file
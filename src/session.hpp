@@ -16,32 +16,130 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
 
+#include "certificate.hpp"
+#include "governor.hpp"
 #include "roaprotocol.hpp"
 #include "streamer.hpp"
+#include "timeshift.hpp"
 #include "random_id.hpp"
 
 
 class RTCPeerSessionManager;
 
+/**
+ * @brief an encoding of a simulcast camera, each has its own encoder
+ */
+struct StreamEncoding
+{
+    std::shared_ptr<H264VideoStream> stream;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct RTCPeerSessionLimits
+{
+    size_t maxSessions = 16;
+    std::chrono::seconds reapInterval{5};
+    std::chrono::seconds reportInterval{60};
+    /* how long the answer of a WHEP viewer waits for the ICE candidates */
+    std::chrono::milliseconds gatherTimeout{5000};
+    /* playout-delay hint for viewers without their own, -1 for none */
+    int32_t minPlayoutDelay_ms = -1;
+    int32_t maxPlayoutDelay_ms = -1;
+    /* spread the packets of a frame, the viewers of a stream share a thread */
+    bool isPaced = false;
+    PacingConfig pacing;
+    /* offer ULPFEC, its protection follows the loss of each viewer */
+    bool hasFec = false;
+    /* how long the payloads are kept for the NACKs of the viewers */
+    std::chrono::milliseconds nackHistory{1000};
+    /* a session will be reaped if it stays longer in a state, 0 means forever */
+    std::array<std::chrono::seconds, ROAPSessionStateNum> stateTimeout
+    {
+        std::chrono::seconds(30),   /* Start */
+        std::chrono::seconds(30),   /* WaitAnswer */
+        std::chrono::seconds(30),   /* WaitCompleted */
+        std::chrono::seconds(0),    /* Completed */
+        std::chrono::seconds(10),   /* WaitForShutdown */
+        std::chrono::seconds(0)     /* Closed */
+    };
+};
+
 class RTCPeerSession
 {
     private:
         bool isWilldestroyed;
+        bool pendingRenegotiation;
         std::string sessionId;
         rtc::PeerConnection pc;
         std::shared_ptr<H264VideoTrack> videoTrack;
+        uint64_t timeshift_us;
+        double rate;
+        std::unique_ptr<TimeShiftPlayer> player;
+        /* the last level of the viewer's ROAP topic, empty for the broadcast topic */
+        std::string viewerId;
+        /* a WHEP session gets no ROAP messages */
+        std::atomic<bool> isRoapSignaled;
+        /* the size of the player, 0 if it is unknown */
+        uint32_t viewportWidth;
+        uint32_t viewportHeight;
+        /* the index in the encodings of the manager */
+        std::atomic<size_t> encoding;
+        /* in the live stream, the time shift viewers are not switched */
+        std::atomic<bool> isSwitchable;
+        /* close() has been called, it is set before the manager is told */
+        std::atomic<bool> isClosed;
+
+        void watchConnection();
     public:
         RTCPeerSession(std::string id, const rtc::Configuration &config,
                        const std::shared_ptr<MqttConnect>& conn,
-                       RTCPeerSessionManager &mg);
+                       RTCPeerSessionManager &mg,
+                       const NotifyMessage& notify);
         ~RTCPeerSession();
         OfferSession offerer;
         RTCPeerSessionManager &manager;
         std::string getLocalSdp();
         std::string getId();
+        /**
+         * @brief the ROAP messages on the topic of this viewer may address
+         * the session
+         */
+        bool isOwnedBy(const std::string& viewer);
+        std::shared_ptr<TrackUsage> getUsage();
+        /* the highest temporal layer which the viewer receives */
+        unsigned int getMaxTemporalLayer();
+        size_t getEncoding();
+        /**
+         * @brief switch to the largest encoding which fits the bandwidth
+         * estimate, but not larger than the viewport needs. It is called
+         * periodically by the manager.
+         */
+        void selectEncoding();
         void setRemoteSdp(std::string sdp);
         void open();
+        /**
+         * @brief answer the offer of a viewer which has been received by
+         * another signaling than ROAP. It blocks until the ICE candidates
+         * are gathered, they are part of the answer.
+         */
+        std::string answer(const std::string& offer, std::chrono::milliseconds timeout);
+        /**
+         * @brief send a new offer in the established session, e.g. after
+         * the stream has been changed. The PeerConnection is kept.
+         */
+        void renegotiate();
+        bool needRenegotiation();
+        /**
+         * @brief the session has been closed, e.g. by the PeerConnection
+         * while it has not been in the sessions of the manager
+         */
+        bool hasClosed() {return isClosed;}
         void close();
         void addToStream();
 };
@@ -50,23 +148,120 @@ class RTCPeerSessionManager
 {
     private:
         RandomIdGenerator uidg;
+        std::string streamName;
         rtc::Configuration config;
         std::shared_ptr<MqttConnect> mqttConn;
         std::vector<std::string> closedSessions;
         std::map<std::string, std::unique_ptr<RTCPeerSession>> peerSessions;
+        RTCPeerSessionLimits limits;
         
         std::mutex lock;
+        std::mutex sessionsLock;
+
+        std::thread reaper;
+        std::mutex reaperLock;
+        std::condition_variable reaperWakeup;
+        bool isReaperStopped;
+
+        size_t reapedClosed;
+        size_t reapedTimeout;
+        size_t refused;
+        size_t preempted;
+        /* WHEP sessions which wait for their answer, they are not in the map */
+        size_t pendingAnswers;
+        size_t answered;
+        ROAPStateDurations reapedStateDurations{};
+        std::shared_ptr<ResourceGovernor> governor;
+
+        void reaperLoop();
+        /**
+         * @brief check the limits and ask the governor for a new session,
+         * called with sessionsLock. nullptr if the session is refused.
+         */
+        std::unique_ptr<RTCPeerSession> admitRTCPeerSession(
+            const NotifyMessage& notify, std::vector<std::function<void()>>& preemptions);
+        /**
+         * @brief tell a viewer on its reply topic that it gets no session
+         */
+        void sendRefusal(const NotifyMessage& notify);
+        /**
+         * @brief shut a session down to make room for a viewer with a
+         * higher priority, called by the governor's decision.
+         */
+        void preemptRTCPeerSession(const std::string& id);
+        std::string getGovernorKey(const std::string& id);
+        /**
+         * @brief stop the track of a session in the stream and in every
+         * encoding, it may be switching between them
+         */
+        void removeFromStreams(const std::string& id);
     public:
-        RTCPeerSessionManager(rtc::Configuration&& config,
+        RTCPeerSessionManager(const std::string& name,
+                              rtc::Configuration&& config,
                               const std::shared_ptr<MqttConnect>& conn,
-                              const std::shared_ptr<H264VideoStream>& s);
-        ~RTCPeerSessionManager()=default;
+                              const std::shared_ptr<H264VideoStream>& s,
+                              const RTCPeerSessionLimits& l=RTCPeerSessionLimits(),
+                              const std::shared_ptr<ResourceGovernor>& g=nullptr);
+        ~RTCPeerSessionManager();
 
         std::shared_ptr<H264VideoStream> stream;
-        void createRTCPeerSession();
-        void processMessage(std::string message);
+        /* sends the packets of the paced tracks, nullptr without pacing */
+        std::shared_ptr<PacingScheduler> pacing;
+        /* the FEC of the frames for all viewers, nullptr without FEC */
+        std::shared_ptr<FecCache> fec;
+        /* the payloads of the recent packets, shared by the viewers for NACKs */
+        std::shared_ptr<RetransmissionStore> retransmissions;
+        /* the DTLS certificate of the configuration, it is rotated by the
+           reaper. nullptr if every peer connection has its own */
+        std::shared_ptr<DtlsCertificate> certificate;
+        /* the recent samples of the stream, the viewers can rewind in them */
+        std::shared_ptr<TimeShiftBuffer> timeShift;
+        /* the encodings of a simulcast camera, the largest first, it is
+           stream. Empty if the camera has one encoding */
+        std::vector<StreamEncoding> encodings;
+        bool createRTCPeerSession(const NotifyMessage& notify);
+        /**
+         * @brief create a session for the offer of a WHEP viewer, the camera
+         * answers instead of offering.
+         *
+         * @return false if the session is refused, it throws if the offer
+         * cannot be answered
+         */
+        bool answerRTCPeerSession(const NotifyMessage& notify, const std::string& offer,
+                                  std::string& id, std::string& answer);
+        /**
+         * @brief close a session on request of the viewer, e.g. a WHEP DELETE.
+         * Only a session which has been answered out of band is closed, the
+         * ids of the ROAP sessions are published on the broker.
+         *
+         * @return false if there is no such session
+         */
+        bool closeRTCPeerSession(const std::string& id);
+        /**
+         * @brief process a ROAP message, the viewerId is the last level of
+         * its topic or empty if it comes from the broadcast topic.
+         */
+        void processMessage(std::string message, const std::string& viewerId="");
+        /**
+         * @brief webrtc/roap/app/<stream>, and /<viewerId> for a viewer
+         * with its own topic
+         */
+        std::string getReplyTopic(const std::string& viewerId);
         void deleteRTCPeerSession(const std::string& id);
+        /**
+         * @brief offer the changed stream to all viewers again
+         */
+        void renegotiateAll();
+        /**
+         * @brief erase closed sessions and the sessions which stay too long
+         * in a state. It is called periodically by the reaper thread.
+         */
         void loopHandler();
+        /**
+         * @brief statistics of sessions as JSON, for example how many sessions
+         * have been reaped and how long they stayed in every state.
+         */
+        std::string getStatistics();
 };
 
 #endif /* __SESSION_H */
\ No newline at end of file
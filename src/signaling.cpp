@@ -0,0 +1,147 @@
+/**
+ * @file signaling.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "signaling.hpp"
+#include "utility.h"
+
+#include <stdexcept>
+
+const std::string SignalingRouter::notifyTopicPrefix = "webrtc/notify/";
+const std::string SignalingRouter::requestTopicPrefix = "webrtc/roap/";
+const std::string SignalingRouter::renegotiateTopicPrefix = "webrtc/renegotiate/";
+
+SignalingRouter::SignalingRouter(const std::shared_ptr<MqttConnect>& conn):
+mqttConn(conn), isSubscribed(false)
+{}
+
+void SignalingRouter::subscribeStream(const std::string& name)
+{
+    mqttConn->subscribeTopic(notifyTopicPrefix + name);
+    mqttConn->subscribeTopic(requestTopicPrefix + name);
+    mqttConn->subscribeTopic(requestTopicPrefix + name + "/+");
+    mqttConn->subscribeTopic(renegotiateTopicPrefix + name);
+}
+
+void SignalingRouter::unsubscribeStream(const std::string& name)
+{
+    mqttConn->unsubscribeTopic(notifyTopicPrefix + name);
+    mqttConn->unsubscribeTopic(requestTopicPrefix + name);
+    mqttConn->unsubscribeTopic(requestTopicPrefix + name + "/+");
+    mqttConn->unsubscribeTopic(renegotiateTopicPrefix + name);
+}
+
+void SignalingRouter::addStream(const std::string& name,
+                                RTCPeerSessionManager *peers)
+{
+    // the level is taken by the replies to the viewers
+    if(name.empty() || requestTopicPrefix + name == ROAPBroadcastTopic
+       || name.find_first_of("/+#") != std::string::npos)
+    {
+        throw std::invalid_argument("Invaild stream name: " + name);
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    bool isNew = streams.find(name) == streams.end();
+    streams[name] = peers;
+    if(isSubscribed && isNew)
+    {
+        subscribeStream(name);
+    }
+}
+
+void SignalingRouter::removeStream(const std::string& name)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(streams.erase(name) > 0 && isSubscribed)
+    {
+        unsubscribeStream(name);
+    }
+}
+
+void SignalingRouter::subscribe()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(isSubscribed)
+    {
+        return;
+    }
+    isSubscribed = true;
+    for(auto& item: streams)
+    {
+        subscribeStream(item.first);
+    }
+}
+
+RTCPeerSessionManager *SignalingRouter::findStream(const std::string& name)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = streams.find(name);
+    return it == streams.end() ? nullptr : it->second;
+}
+
+void SignalingRouter::processMessage(const std::string& topic,
+                                     const std::string& message)
+{
+    bool isNotify;
+    size_t start;
+
+    if(topic.compare(0, renegotiateTopicPrefix.size(), renegotiateTopicPrefix) == 0)
+    {
+        auto peers = findStream(topic.substr(renegotiateTopicPrefix.size()));
+        if(peers != nullptr)
+        {
+            peers->renegotiateAll();
+        }
+        return;
+    }
+    if(topic.compare(0, notifyTopicPrefix.size(), notifyTopicPrefix) == 0)
+    {
+        isNotify = true;
+        start = notifyTopicPrefix.size();
+    }else if(topic.compare(0, requestTopicPrefix.size(), requestTopicPrefix) == 0)
+    {
+        isNotify = false;
+        start = requestTopicPrefix.size();
+    }else
+    {
+        return;
+    }
+
+    // <name> or <name>/<viewerId>
+    size_t separator = topic.find('/', start);
+    std::string name = topic.substr(start, separator - start);
+    std::string viewerId;
+    if(separator != std::string::npos)
+    {
+        if(isNotify)
+        {
+            return;
+        }
+        viewerId = topic.substr(separator + 1);
+    }
+
+    // the router is not locked while a session is created
+    auto peers = findStream(name);
+    if(peers == nullptr)
+    {
+        // a message which was queued before the stream has been removed
+        return;
+    }
+
+    if(isNotify)
+    {
+        NotifyMessage notify;
+        notify.parser(message);
+        peers->createRTCPeerSession(notify);
+    }else
+    {
+        peers->processMessage(message, viewerId);
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file signaling.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __SIGNALING_H
+#define __SIGNALING_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "mqtt_connect.hpp"
+#include "session.hpp"
+
+/**
+ * @brief route the signaling of many streams over one MQTT connection.
+ *
+ * topics of the stream <name>:
+ *  webrtc/notify/<name>            a viewer requests a session
+ *  webrtc/roap/<name>              ROAP messages of viewers without own topic
+ *  webrtc/roap/<name>/<viewerId>   ROAP messages of a viewer
+ *  webrtc/renegotiate/<name>       offer the stream again to all viewers,
+ *                                  e.g. after the encoder has been changed
+ *
+ * the replies of the camera go to webrtc/roap/app/<name>[/<viewerId>]. The
+ * topics are subscribed per stream, the replies do not come back to it.
+ */
+class SignalingRouter
+{
+    private:
+        std::shared_ptr<MqttConnect> mqttConn;
+        std::unordered_map<std::string, RTCPeerSessionManager *> streams;
+        std::mutex lock;
+        bool isSubscribed;
+
+        void subscribeStream(const std::string& name);
+        void unsubscribeStream(const std::string& name);
+        /* the manager of the stream, nullptr if it is not routed */
+        RTCPeerSessionManager *findStream(const std::string& name);
+    public:
+        SignalingRouter()=delete;
+        SignalingRouter(const std::shared_ptr<MqttConnect>& conn);
+        ~SignalingRouter()=default;
+
+        static const std::string notifyTopicPrefix;
+        static const std::string requestTopicPrefix;
+        static const std::string renegotiateTopicPrefix;
+
+        void addStream(const std::string& name, RTCPeerSessionManager *peers);
+        void removeStream(const std::string& name);
+        /**
+         * @brief subscribe the topics of all streams, a stream which is
+         * added later is subscribed at once
+         */
+        void subscribe();
+        void processMessage(const std::string& topic, const std::string& message);
+};
+
+#endif /* __SIGNALING_H */
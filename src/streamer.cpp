@@ -11,11 +11,19 @@
 #include <string.h>
 
 #include "streamer.hpp"
+#include "h264_bitstream.hpp"
 #include "utility.h"
 
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
 
 const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
 
+/* the payload of an RTP packet of the packetizer, for the packets of a frame */
+constexpr size_t rtp_payload_size = 1220;
+
 constexpr uint8_t h264_baseline_profile = 66;
 constexpr uint8_t h264_main_profile = 77;
 constexpr uint8_t h264_High_profile = 100;
@@ -37,25 +45,148 @@ constexpr uint8_t constraint_clear3_flag = 0xe0;
 constexpr uint8_t constraint_clear4_flag = 0xf7;
 constexpr uint8_t constraint_clear5_flag = 0xfb;
 
+/* the frame ids of all streams, the FEC cache and the stored payloads
+   must not mix up the frames of two encodings */
+static std::atomic<uint64_t> nextFrameId{1};
+
 H264VideoTrack::H264VideoTrack(double frameDuration):
-frameDuration_s(frameDuration)
+usage(std::make_shared<TrackUsage>()),
+extender(std::make_shared<RtpHeaderExtender>()), frameDuration_s(frameDuration)
+{
+    extender->setIds(0, RtpHeaderExtender::defaultAbsCaptureTimeId);
+}
+
+void H264VideoTrack::setPlayoutDelay(uint32_t min_ms, uint32_t max_ms)
+{
+    hasPlayoutDelay = true;
+    extender->setPlayoutDelay(min_ms, max_ms);
+    extender->setIds(RtpHeaderExtender::defaultPlayoutDelayId,
+                     extender->getAbsCaptureTimeId());
+}
+
+void H264VideoTrack::setPacer(const std::shared_ptr<RtpPacer>& p)
+{
+    pacer = p;
+}
+
+void H264VideoTrack::setFec(const std::shared_ptr<FecCache>& cache)
+{
+    fec = std::make_shared<UlpfecEncoder>(cache);
+    fec->setPayloadTypes(UlpfecEncoder::defaultRedPayloadType,
+                         UlpfecEncoder::defaultFecPayloadType);
+}
+
+void H264VideoTrack::setRetransmissionStore(const std::shared_ptr<RetransmissionStore>& store)
+{
+    retransmissions = store;
+}
+
+void H264VideoTrack::acceptFec(const std::string& remoteSdp)
+{
+    if(fec)
+    {
+        fec->setPayloadTypes(UlpfecEncoder::findPayloadType(remoteSdp, "red/90000"),
+                             UlpfecEncoder::findPayloadType(remoteSdp, "ulpfec/90000"));
+    }
+}
+
+bool H264VideoTrack::dropsFrame(unsigned int layer, const LayerRates& rates)
+{
+    return layerSelector.drops(layer, estimator ? estimator->getEstimate_bps() : 0, rates);
+}
+
+unsigned int H264VideoTrack::getMaxTemporalLayer()
 {
+    return layerSelector.getMaxLayer();
+}
+
+double H264VideoTrack::getEstimate_bps()
+{
+    return estimator ? estimator->getEstimate_bps() : 0;
+}
+
+void H264VideoTrack::setNextSource(const H264VideoStream *stream)
+{
+    std::lock_guard<std::mutex> guard(sourceLock);
+    nextSource = stream;
+}
+
+bool H264VideoTrack::takeOver(const H264VideoStream *stream, uint64_t interval_us)
+{
+    std::lock_guard<std::mutex> guard(sourceLock);
+    if(nextSource != stream)
+    {
+        return false;
+    }
+    if(source != stream)
+    {
+        source = stream;
+        isSourceChanged = hasSent;
+        lastInterval_us = lastInterval_us > 0 ? lastInterval_us : interval_us;
+    }
+    return true;
+}
+
+bool H264VideoTrack::isFedBy(const H264VideoStream *stream)
+{
+    std::lock_guard<std::mutex> guard(sourceLock);
+    return source == nullptr || source == stream;
+}
+
+bool H264VideoTrack::sendFrom(const H264VideoStream *stream, NALUnit data, uint64_t time,
+                              uint64_t captureTime_us, uint64_t frameId)
+{
+    // a stream which takes the track over waits until this sample is sent
+    std::lock_guard<std::mutex> guard(sourceLock);
+    if(source != nullptr && source != stream)
+    {
+        return false;
+    }
+    send(std::move(data), time, captureTime_us, frameId);
+    return true;
+}
+
+void H264VideoTrack::acceptExtensions(const std::string& remoteSdp)
+{
+    int playoutDelayId = 0;
+    if(hasPlayoutDelay)
+    {
+        playoutDelayId = RtpHeaderExtender::findExtMapId(remoteSdp,
+                                                         RtpHeaderExtender::playoutDelayUri);
+    }
+    extender->setIds(playoutDelayId,
+        RtpHeaderExtender::findExtMapId(remoteSdp, RtpHeaderExtender::absCaptureTimeUri));
 }
 
 // H264VideoTrack::~H264VideoTrack()
 // {
 // }
 
-void H264VideoTrack::addVideo(rtc::PeerConnection& pc)
+void H264VideoTrack::addVideo(rtc::PeerConnection& pc, const std::string& mid,
+                              int payloadType)
 {
     const rtc::SSRC ssrc{1};
     
-    const int payloadType{static_cast<int>(100)};
     const std::string cname("camera");
 
-    rtc::Description::Video media(cname, rtc::Description::Direction::SendOnly);
+    rtc::Description::Video media(mid, rtc::Description::Direction::SendOnly);
     media.addH264Codec(payloadType);
+    if(fec && fec->getRedPayloadType() > 0)
+    {
+        media.addVideoCodec(fec->getRedPayloadType(), "red");
+        media.addVideoCodec(fec->getFecPayloadType(), "ulpfec");
+    }
     media.addSSRC(ssrc, cname);
+    if(extender->getPlayoutDelayId() > 0)
+    {
+        media.addExtMap(rtc::Description::Entry::ExtMap(extender->getPlayoutDelayId(),
+                                                        RtpHeaderExtender::playoutDelayUri));
+    }
+    if(extender->getAbsCaptureTimeId() > 0)
+    {
+        media.addExtMap(rtc::Description::Entry::ExtMap(extender->getAbsCaptureTimeId(),
+                                                        RtpHeaderExtender::absCaptureTimeUri));
+    }
     track = pc.addTrack(media);
     
     // create RTP configuration
@@ -68,12 +199,32 @@ void H264VideoTrack::addVideo(rtc::PeerConnection& pc)
         rtc::H264RtpPacketizer::Separator::StartSequence, rtpConfig);
     // create H264 handler
     auto h264Handler = std::make_shared<rtc::H264PacketizationHandler>(packetizer);
+    // the extensions are in the packets which are reported and stored for NACKs
+    h264Handler->addToChain(extender);
+    if(fec)
+    {
+        // FEC covers the packets as they are sent, so it follows the extensions
+        h264Handler->addToChain(fec);
+    }
     // add RTCP SR handler
     srReporter = std::make_shared<rtc::RtcpSrReporter>(rtpConfig);
     h264Handler->addToChain(srReporter);
-    // add RTCP NACK handler
-    auto nackResponder = std::make_shared<rtc::RtcpNackResponder>();
+    // add RTCP NACK handler, the tracks of a stream share the payloads
+    if(!retransmissions)
+    {
+        retransmissions = std::make_shared<RetransmissionStore>();
+    }
+    nackResponder = std::make_shared<SharedNackResponder>(retransmissions);
     h264Handler->addToChain(nackResponder);
+    // measures what is sent, the temporal layers of the viewer follow it
+    estimator = std::make_shared<BandwidthEstimator>();
+    h264Handler->addToChain(estimator);
+    if(pacer)
+    {
+        // the packets are counted and stored before they are held
+        h264Handler->addToChain(pacer);
+        pacer->setHandler(h264Handler);
+    }
     // set handler
     track->setMediaHandler(h264Handler);
 
@@ -84,6 +235,25 @@ void H264VideoTrack::addVideo(rtc::PeerConnection& pc)
     );
 }
 
+void H264VideoTrack::setTimeOffset(int64_t offset_us)
+{
+    timeOffset_us = offset_us;
+}
+
+std::shared_ptr<TrackUsage> H264VideoTrack::getUsage()
+{
+    return usage;
+}
+
+void H264VideoTrack::sendMeasured(const rtc::binary& data)
+{
+    // packetizing and encrypting runs in this thread
+    auto start = ThreadCpuTime_ns();
+    track->send(data);
+    usage->cpu_ns += ThreadCpuTime_ns() - start;
+    usage->bytes += data.size();
+}
+
 void H264VideoTrack::start()
 {
     startHandler();
@@ -95,11 +265,30 @@ void H264VideoTrack::onStart(std::function<void()> callback)
 
 }
 
-void H264VideoTrack::send(NALUnit data, uint64_t time)
+void H264VideoTrack::send(NALUnit data, uint64_t time, uint64_t captureTime_us,
+                          uint64_t frameId)
 {
+    extender->setCaptureTime(captureTime_us);
+    if(fec)
+    {
+        fec->setFrame(frameId);
+    }
+    nackResponder->setFrame(frameId);
     
     auto rtpConfig = srReporter->rtpConfig;
      // sample time is in us, we need to convert it to seconds
+    if(isSourceChanged.exchange(false))
+    {
+        // the encodings have their own sample times
+        timeOffset_us = int64_t(lastTime_us + lastInterval_us) - int64_t(time);
+    }
+    time += timeOffset_us;
+    if(!hasSent || time > lastTime_us)
+    {
+        lastInterval_us = hasSent ? time - lastTime_us : lastInterval_us;
+        lastTime_us = time;
+        hasSent = true;
+    }
     auto elapsedSeconds = double(time) / (1000 * 1000);
     // get elapsed time in clock rate
     uint32_t elapsedTimestamp = rtpConfig->secondsToTimestamp(elapsedSeconds);
@@ -116,7 +305,7 @@ void H264VideoTrack::send(NALUnit data, uint64_t time)
 
     try {
         // send sample
-        track->send(data);
+        sendMeasured(data);
     } catch (const std::exception &e) {
         ERROR_MESSAGE("Unable to send, because %s", e.what());
     }
@@ -129,13 +318,30 @@ void H264VideoTrack::sendKeyframe(rtc::binary initalNALUs)
         const double frameDuration_s = double() / (1000 * 1000);
         const uint32_t frameTimestampDuration = srReporter->rtpConfig->secondsToTimestamp(frameDuration_s);
         srReporter->rtpConfig->timestamp = srReporter->rtpConfig->startTimestamp - frameTimestampDuration * 2;
-        track->send(initalNALUs);
+        extender->setCaptureTime(0);
+        if(fec)
+        {
+            fec->setFrame(0);
+        }
+        nackResponder->setFrame(0);
+        sendMeasured(initalNALUs);
         srReporter->rtpConfig->timestamp += frameTimestampDuration;
         // Send initial NAL units again to start stream in firefox browser
-        track->send(initalNALUs);
+        sendMeasured(initalNALUs);
     }
 }
 
+bool H264VideoTrack::sendKeyframeFrom(const H264VideoStream *stream, rtc::binary initalNALUs)
+{
+    std::lock_guard<std::mutex> guard(sourceLock);
+    if(source != nullptr && source != stream)
+    {
+        return false;
+    }
+    sendKeyframe(std::move(initalNALUs));
+    return true;
+}
+
 H264VideoStream::H264VideoStream(unsigned int fps):
 framesPerSecond(fps), startTime(0), sampleTime_us(0)
 {
@@ -175,6 +381,123 @@ void H264VideoStream::addTrack(std::string id,
     lock.unlock();
 }
 
+void H264VideoStream::joinTrack(const std::string& id,
+                                const std::shared_ptr<H264VideoTrack>& track)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(!isJoinAtRecoveryPoint)
+    {
+        track->sendKeyframe(getInitialNALUS());
+        tracks.insert({id, track});
+        return;
+    }
+    pendingTracks[id] = {track, sampleTime_us};
+}
+
+void H264VideoStream::setJoinAtRecoveryPoint(bool enable, std::chrono::milliseconds maxWait)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    isJoinAtRecoveryPoint = enable;
+    maxJoinWait_us = uint64_t(maxWait.count()) * 1000;
+}
+
+void H264VideoStream::startPendingTracks(bool isJoinPoint)
+{
+    for(auto it = pendingTracks.begin(); it != pendingTracks.end();)
+    {
+        auto track = it->second.track.lock();
+        if(!track)
+        {
+            it = pendingTracks.erase(it);
+            continue;
+        }
+        // the track may have been switched to another encoding while it
+        // waits, that encoding sends its own parameter sets
+        bool isFed;
+        if(isJoinPoint)
+        {
+            // the parameter sets may be far behind if there is no IDR
+            NALUnit parameterSets = sps;
+            parameterSets.insert(parameterSets.end(), pps.begin(), pps.end());
+            isFed = parameterSets.empty() ? track->isFedBy(this)
+                                          : track->sendFrom(this, parameterSets, sampleTime_us);
+        }else if(sampleTime_us - it->second.since_us > maxJoinWait_us)
+        {
+            ERROR_MESSAGE("no join point for track %s, start with the last IDR.",
+                it->first.c_str());
+            isFed = track->sendKeyframeFrom(this, getInitialNALUS());
+        }else
+        {
+            ++it;
+            continue;
+        }
+        if(isFed)
+        {
+            tracks.insert({it->first, track});
+        }
+        it = pendingTracks.erase(it);
+    }
+}
+
+void H264VideoStream::setLowDelaySps(bool enable)
+{
+    isLowDelaySps = enable;
+}
+
+void H264VideoStream::setTemporalLayers(unsigned int layers)
+{
+    layerTracker.setLayers(layers);
+}
+
+unsigned int H264VideoStream::getTemporalLayers()
+{
+    return layerTracker.getLayers();
+}
+
+void H264VideoStream::rewriteSps(NALUnit& sample)
+{
+    auto begin = reinterpret_cast<const uint8_t *>(sample.data());
+    const uint8_t *spsStart = nullptr;
+    size_t spsLen = 0;
+    ForEachLeadingNalUnit(begin, sample.size(),
+        [&spsStart, &spsLen](const uint8_t *nal, size_t nalLen)
+        {
+            if(spsStart == nullptr && NalTypeOf(nal) == H264NalType::SPS)
+            {
+                spsStart = nal;
+                spsLen = nalLen;
+            }
+        }
+    );
+    if(spsStart == nullptr)
+    {
+        return;
+    }
+
+    // an encoder repeats the same SPS, it is rewritten once
+    auto unit = reinterpret_cast<const std::byte *>(spsStart);
+    NALUnit original(unit, unit + spsLen);
+    auto it = spsRewrites.find(original);
+    if(it == spsRewrites.end())
+    {
+        std::vector<uint8_t> rewritten;
+        if(!RewriteSpsForLowDelay(spsStart, spsLen, framesPerSecond, rewritten))
+        {
+            ERROR_MESSAGE("cannot rewrite the SPS, it is sent unchanged.");
+            rewritten.assign(spsStart, spsStart + spsLen);
+        }
+        if(spsRewrites.size() >= maxSpsRewrites)
+        {
+            spsRewrites.clear();
+        }
+        auto bytes = reinterpret_cast<const std::byte *>(rewritten.data());
+        it = spsRewrites.emplace(original, NALUnit(bytes, bytes + rewritten.size())).first;
+    }
+    auto offset = spsStart - begin;
+    sample.erase(sample.begin() + offset, sample.begin() + offset + spsLen);
+    sample.insert(sample.begin() + offset, it->second.begin(), it->second.end());
+}
+
 void H264VideoStream::deleteById(std::string id)
 {
     lock.lock();
@@ -184,9 +507,88 @@ void H264VideoStream::deleteById(std::string id)
     {
         tracks.erase(it);
     }
+    pendingTracks.erase(id);
+    switchingTracks.erase(id);
     lock.unlock();
 }
 
+void H264VideoStream::switchTrack(const std::string& id,
+                                  const std::shared_ptr<H264VideoTrack>& track)
+{
+    track->setNextSource(this);
+    lock.lock();
+    switchingTracks[id] = track;
+    auto request = keyframeRequest;
+    lock.unlock();
+    if(request)
+    {
+        request();
+    }
+}
+
+void H264VideoStream::onKeyframeRequest(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    keyframeRequest = std::move(callback);
+}
+
+double H264VideoStream::getBitrate_bps()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    double rate_bps = 0;
+    for(auto rate: layerRates)
+    {
+        rate_bps += rate;
+    }
+    return rate_bps;
+}
+
+uint64_t H264VideoStream::takeOverSwitchingTracks(bool hasParameterSets)
+{
+    uint64_t switched = 0;
+    NALUnit parameterSets;
+    if(!hasParameterSets)
+    {
+        // the decoder of the viewer has the parameter sets of the other encoding
+        for(auto& unit: {previousUnitType7, previousUnitType8})
+        {
+            if(unit.has_value())
+            {
+                parameterSets.insert(parameterSets.end(), unit->begin(), unit->end());
+            }
+        }
+    }
+    for(auto& [id, weak]: switchingTracks)
+    {
+        auto track = weak.lock();
+        // the track may have been switched again in the meantime
+        if(!track || !track->takeOver(this, sampleDuration_us))
+        {
+            continue;
+        }
+        if(!parameterSets.empty())
+        {
+            track->send(parameterSets, sampleTime_us);
+        }
+        tracks[id] = track;
+        switched++;
+    }
+    switchingTracks.clear();
+    return switched;
+}
+
+void H264VideoStream::addSink(const std::string& name, StreamSink sink)
+{
+    std::lock_guard<std::mutex> guard(sinksLock);
+    sinks[name] = std::move(sink);
+}
+
+void H264VideoStream::removeSink(const std::string& name)
+{
+    std::lock_guard<std::mutex> guard(sinksLock);
+    sinks.erase(name);
+}
+
 bool H264VideoStream::hasTrack()
 {
     bool ret;
@@ -214,7 +616,7 @@ NALUnit H264VideoStream::getInitialNALUS()
     return units;
 }
 
-void H264VideoStream::onDataHandle(std::byte *data, size_t len)
+void H264VideoStream::onDataHandle(std::byte *data, size_t len, uint64_t captureTime_us)
 {
     if(memcmp(data, start_code, sizeof(start_code)) == 0)
     {
@@ -222,6 +624,11 @@ void H264VideoStream::onDataHandle(std::byte *data, size_t len)
         if(len > sizeof(start_code))
         {
             auto nalu = NALUnit(data, data+len);
+            if(isLowDelaySps)
+            {
+                rewriteSps(nalu);
+            }
+            auto frame = reinterpret_cast<const uint8_t *>(nalu.data());
             char type = uint8_t(nalu[sizeof(start_code)]) & 0x1f;
             switch (type)
             {
@@ -236,18 +643,140 @@ void H264VideoStream::onDataHandle(std::byte *data, size_t len)
                     break;
             }
 
+            bool isJoinPoint = false;
+            if(isJoinAtRecoveryPoint)
+            {
+                // only the NAL units in front of the first slice are parsed
+                ForEachLeadingNalUnit(frame, nalu.size(),
+                    [this, &isJoinPoint](const uint8_t *nal, size_t nalLen)
+                    {
+                        auto nalType = NalTypeOf(nal);
+                        auto unit = reinterpret_cast<const std::byte *>(nal);
+                        if(nalType == H264NalType::SPS)
+                        {
+                            sps.assign(reinterpret_cast<const std::byte *>(start_code),
+                                       reinterpret_cast<const std::byte *>(start_code) + sizeof(start_code));
+                            sps.insert(sps.end(), unit, unit + nalLen);
+                        }else if(nalType == H264NalType::PPS)
+                        {
+                            pps.assign(reinterpret_cast<const std::byte *>(start_code),
+                                       reinterpret_cast<const std::byte *>(start_code) + sizeof(start_code));
+                            pps.insert(pps.end(), unit, unit + nalLen);
+                        }else if(nalType == H264NalType::IDR
+                                 || (nalType == H264NalType::SEI && HasRecoveryPoint(nal, nalLen)))
+                        {
+                            isJoinPoint = true;
+                        }
+                    }
+                );
+            }
+
+            // a slice up to the payload size is a single NAL unit packet
+            uint64_t frameSlices = 0, frameFragmented = 0, framePackets = 0;
+            bool isIdr = false, isReference = false;
+            ForEachNalUnit(frame, nalu.size(),
+                [&](const uint8_t *nal, size_t nalLen)
+                {
+                    if(IsVclNal(nal))
+                    {
+                        frameSlices++;
+                        frameFragmented += nalLen > rtp_payload_size;
+                        isIdr = isIdr || NalTypeOf(nal) == H264NalType::IDR;
+                        isReference = isReference || NalRefIdcOf(nal) != 0;
+                    }
+                    framePackets += (nalLen + rtp_payload_size - 1) / rtp_payload_size;
+                }
+            );
+            // a sample without a slice, e.g. the parameter sets, is never dropped
+            unsigned int layer = frameSlices > 0 ? layerTracker.next(isIdr, isReference) : 0;
+
+            statsLock.lock();
+            frames++;
+            frameBytes += nalu.size();
+            peakFrameBytes = std::max(peakFrameBytes, uint64_t(nalu.size()));
+            joinPoints += isJoinPoint;
+            slices += frameSlices;
+            fragmentedSlices += frameFragmented;
+            packets += framePackets;
+            peakPackets = std::max(peakPackets, framePackets);
+            layerFrames[layer]++;
+            statsLock.unlock();
+
             lock.lock();
+            frameNumber = nextFrameId++;
+            layerBytes[layer] += nalu.size();
+            if(layerWindowStart_us == 0)
+            {
+                layerWindowStart_us = sampleTime_us;
+            }else if(sampleTime_us - layerWindowStart_us >= 1000 * 1000)
+            {
+                for(unsigned int i = 0; i < maxTemporalLayers; i++)
+                {
+                    layerRates[i] = layerBytes[i] * 8 * 1e6 / (sampleTime_us - layerWindowStart_us);
+                    layerBytes[i] = 0;
+                }
+                layerWindowStart_us = sampleTime_us;
+            }
+            uint64_t dropped = 0, switched = 0;
+            if(!pendingTracks.empty())
+            {
+                startPendingTracks(isJoinPoint);
+            }
+            if(!switchingTracks.empty() && isIdr)
+            {
+                switched = takeOverSwitchingTracks(type == 7);
+            }
+            // the tracks which are gone or fed by another encoding
+            std::vector<std::string> leftTracks;
             for(auto i: tracks)
             {
-                auto wkt = i.second;
-                if(wkt.expired()){
-                    deleteById(i.first);
-                }else
+                auto track = i.second.lock();
+                if(!track || !track->isFedBy(this))
+                {
+                    leftTracks.push_back(i.first);
+                    continue;
+                }
+                if(track->dropsFrame(layer, layerRates))
                 {
-                    wkt.lock()->send(nalu, sampleTime_us);
+                    dropped++;
+                    continue;
                 }
+                if(!track->sendFrom(this, nalu, sampleTime_us, captureTime_us, frameNumber))
+                {
+                    leftTracks.push_back(i.first);
+                }
+            }
+            for(auto& id: leftTracks)
+            {
+                tracks.erase(id);
             }
             lock.unlock();
+            if(dropped > 0 || switched > 0)
+            {
+                statsLock.lock();
+                droppedFrames += dropped;
+                switchedTracks += switched;
+                statsLock.unlock();
+            }
+
+            if(captureTime_us > 0)
+            {
+                uint64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+                uint64_t latency_us = now_us > captureTime_us ? now_us - captureTime_us : 0;
+                statsLock.lock();
+                latencyFrames++;
+                latencySum_us += latency_us;
+                peakLatency_us = std::max(peakLatency_us, latency_us);
+                statsLock.unlock();
+            }
+
+            sinksLock.lock();
+            for(auto& [name, sink]: sinks)
+            {
+                sink(nalu, sampleTime_us);
+            }
+            sinksLock.unlock();
         }else
         {
             ERROR_MESSAGE("this sample is too small.");
@@ -257,6 +786,51 @@ void H264VideoStream::onDataHandle(std::byte *data, size_t len)
     }
 }
 
+std::string H264VideoStream::getStatistics()
+{
+    nlohmann::ordered_json json;
+    size_t waiting;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        waiting = pendingTracks.size();
+    }
+    std::lock_guard<std::mutex> guard(statsLock);
+    double meanBytes = frames > 0 ? double(frameBytes) / frames : 0.0;
+    json["frames"] = frames;
+    json["meanFrameBytes"] = uint64_t(meanBytes);
+    json["peakFrameBytes"] = peakFrameBytes;
+    json["peakToMean"] = meanBytes > 0 ? peakFrameBytes / meanBytes : 0.0;
+    json["meanPackets"] = frames > 0 ? double(packets) / frames : 0.0;
+    json["peakPackets"] = peakPackets;
+    json["meanSlices"] = frames > 0 ? double(slices) / frames : 0.0;
+    json["fragmentedSlices"] = fragmentedSlices;
+    json["meanLatency_ms"] = latencyFrames > 0 ? latencySum_us / 1000.0 / latencyFrames : 0.0;
+    json["peakLatency_ms"] = peakLatency_us / 1000.0;
+    json["joinPoints"] = joinPoints;
+    json["pendingTracks"] = waiting;
+    if(layerTracker.getLayers() > 1)
+    {
+        json["layerFrames"] = layerFrames;
+        json["droppedFrames"] = droppedFrames;
+    }
+    json["switchedTracks"] = switchedTracks;
+    frames = 0;
+    frameBytes = 0;
+    peakFrameBytes = 0;
+    joinPoints = 0;
+    slices = 0;
+    fragmentedSlices = 0;
+    packets = 0;
+    peakPackets = 0;
+    latencyFrames = 0;
+    latencySum_us = 0;
+    peakLatency_us = 0;
+    layerFrames = {};
+    droppedFrames = 0;
+    switchedTracks = 0;
+    return json.dump();
+}
+
 std::string H264VideoStream::getProfileLevelId(
     H264Profile profile, H264Level level)
 {
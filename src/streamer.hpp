@@ -15,14 +15,33 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <ctime>
 
 #include <rtc/rtc.hpp>
 
 #include "capture.hpp"
+#include "pacer.hpp"
+#include "fec.hpp"
+#include "retransmission.hpp"
+#include "rate_control.hpp"
+#include "rtp_extension.hpp"
 
 using NALUnit = std::vector<std::byte>;
+/* a consumer of the stream beside the tracks, it gets every sample */
+using StreamSink = std::function<void(const NALUnit& sample, uint64_t sampleTime_us)>;
 
+class H264VideoStream;
+
+/**
+ * @brief what a track has cost, the CPU time is spent in the sending thread
+ */
+struct TrackUsage
+{
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> cpu_ns{0};
+};
 
 class H264VideoTrack
 {
@@ -30,16 +49,132 @@ class H264VideoTrack
         std::shared_ptr<rtc::Track> track;
         std::shared_ptr<rtc::RtcpSrReporter> srReporter;
         std::function<void()> startHandler;
+        std::shared_ptr<TrackUsage> usage;
+        std::shared_ptr<RtpHeaderExtender> extender;
+        std::shared_ptr<RtpPacer> pacer;
+        std::shared_ptr<UlpfecEncoder> fec;
+        std::shared_ptr<RetransmissionStore> retransmissions;
+        std::shared_ptr<SharedNackResponder> nackResponder;
+        std::shared_ptr<BandwidthEstimator> estimator;
+        TemporalLayerSelector layerSelector;
+        bool hasPlayoutDelay = false;
+        std::atomic<int64_t> timeOffset_us{0};
         const double frameDuration_s;
+        /* the encoding which feeds the track and the one it switches to */
+        std::mutex sourceLock;
+        const H264VideoStream *source = nullptr;
+        const H264VideoStream *nextSource = nullptr;
+        std::atomic<bool> isSourceChanged{false};
+        /* the last sample time, the next encoding continues after it */
+        bool hasSent = false;
+        uint64_t lastTime_us = 0;
+        uint64_t lastInterval_us = 0;
+
+        void sendMeasured(const rtc::binary& data);
     public:
         H264VideoTrack(double frameDuration);
         ~H264VideoTrack()=default;
     
-        void addVideo(rtc::PeerConnection& pc);
+        /**
+         * @brief add the send only track, an answerer takes the mid and the
+         * payload type from the offer
+         */
+        void addVideo(rtc::PeerConnection& pc, const std::string& mid="camera",
+                      int payloadType=100);
+        /**
+         * @brief offer the playout-delay extension with this hint, call it
+         * before addVideo
+         */
+        void setPlayoutDelay(uint32_t min_ms, uint32_t max_ms);
+        /**
+         * @brief spread the packets of a frame instead of sending them in
+         * one burst, call it before addVideo
+         */
+        void setPacer(const std::shared_ptr<RtpPacer>& p);
+        /**
+         * @brief offer ULPFEC in RED, the tracks of a stream share the
+         * FEC of a frame in the cache. Call it before addVideo
+         */
+        void setFec(const std::shared_ptr<FecCache>& cache);
+        /**
+         * @brief keep the payloads for NACKs in the store of the stream,
+         * call it before addVideo. Without it the track has its own store
+         */
+        void setRetransmissionStore(const std::shared_ptr<RetransmissionStore>& store);
+        /**
+         * @brief take the RED and ULPFEC payload types of the remote
+         * description, without them the packets are sent without FEC
+         */
+        void acceptFec(const std::string& remoteSdp);
+        /**
+         * @brief the frame of the layer is not sent, the layers above the
+         * base are dropped when the stream is faster than the bandwidth
+         * estimate of the viewer
+         */
+        bool dropsFrame(unsigned int layer, const LayerRates& rates);
+        unsigned int getMaxTemporalLayer();
+        /**
+         * @return the bandwidth estimate of the viewer in bit/s, 0 if there
+         * is none
+         */
+        double getEstimate_bps();
+        /**
+         * @brief switch to another encoding of the camera, the current one
+         * feeds the track until the next one takes it over at an IDR
+         */
+        void setNextSource(const H264VideoStream *stream);
+        /**
+         * @brief the stream of setNextSource feeds the track from now on,
+         * its timeline continues after the last sample of the previous one
+         *
+         * @param interval_us the time to the last sample if the track has
+         * not measured it
+         * @return false if the track switches to another stream
+         */
+        bool takeOver(const H264VideoStream *stream, uint64_t interval_us);
+        /**
+         * @brief whether the samples of the stream go to the track, nothing
+         * is sent
+         *
+         * @return true if the stream feeds the track or no stream has taken
+         * it over yet
+         */
+        bool isFedBy(const H264VideoStream *stream);
+        /**
+         * @brief send a sample of the stream if it feeds the track
+         *
+         * @return false if another stream has taken the track over
+         */
+        bool sendFrom(const H264VideoStream *stream, NALUnit data, uint64_t time,
+                      uint64_t captureTime_us=0, uint64_t frameId=0);
+        /**
+         * @brief send only the header extensions of the remote description,
+         * with the ids which it has given them
+         */
+        void acceptExtensions(const std::string& remoteSdp);
         void onStart(std::function<void()> callback);
         void sendKeyframe(rtc::binary initalNALUs);
-        void send(NALUnit data, uint64_t time);
+        /**
+         * @brief send the keyframe of the stream if it feeds the track
+         *
+         * @return false if another stream has taken the track over
+         */
+        bool sendKeyframeFrom(const H264VideoStream *stream, rtc::binary initalNALUs);
+        /**
+         * @param captureTime_us steady clock time of the capture for the
+         * abs-capture-time extension, 0 if it is unknown
+         * @param frameId the number of the frame in the live stream, the
+         * tracks share its FEC and its stored payloads. 0 if it is not shared
+         */
+        void send(NALUnit data, uint64_t time, uint64_t captureTime_us=0,
+                  uint64_t frameId=0);
         void start();
+        std::shared_ptr<TrackUsage> getUsage();
+        /**
+         * @brief added to the sample time, a track which has played the
+         * time shift buffer continues its own timeline in the live stream.
+         */
+        void setTimeOffset(int64_t offset_us);
 };
 
 class H264VideoStream
@@ -52,9 +187,68 @@ class H264VideoStream
         uint64_t sampleTime_us = 0;
         std::map<std::string, std::weak_ptr<H264VideoTrack>> tracks;
         std::mutex lock;
+        std::map<std::string, StreamSink> sinks;
+        std::mutex sinksLock;
         std::optional<NALUnit> previousUnitType5 = std::nullopt;
         std::optional<NALUnit> previousUnitType7 = std::nullopt;
         std::optional<NALUnit> previousUnitType8 = std::nullopt;
+
+        struct PendingTrack
+        {
+            std::weak_ptr<H264VideoTrack> track;
+            uint64_t since_us;
+        };
+        /* the tracks which wait for a join point */
+        std::map<std::string, PendingTrack> pendingTracks;
+        bool isJoinAtRecoveryPoint = false;
+        uint64_t maxJoinWait_us = 0;
+        /* the last SPS and PPS with start codes, sent in front of a recovery point */
+        NALUnit sps;
+        NALUnit pps;
+        /* the id of the current frame, unique among the encodings of all
+           cameras. The FEC of a frame is shared by it */
+        uint64_t frameNumber = 0;
+        TemporalLayerTracker layerTracker;
+        /* the bit rate of each temporal layer, measured in windows of a second */
+        LayerRates layerRates{};
+        std::array<uint64_t, maxTemporalLayers> layerBytes{};
+        uint64_t layerWindowStart_us = 0;
+
+        /* the tracks which switch to this encoding at its next IDR */
+        std::map<std::string, std::weak_ptr<H264VideoTrack>> switchingTracks;
+        std::function<void()> keyframeRequest;
+
+        /* the frame sizes since the last statistics */
+        std::mutex statsLock;
+        uint64_t frames = 0;
+        uint64_t frameBytes = 0;
+        uint64_t peakFrameBytes = 0;
+        uint64_t joinPoints = 0;
+        uint64_t slices = 0;
+        /* slices which are larger than a packet, they are sent as FU-A */
+        uint64_t fragmentedSlices = 0;
+        uint64_t packets = 0;
+        uint64_t peakPackets = 0;
+        /* from the capture of a frame until it has been sent to all tracks */
+        uint64_t latencyFrames = 0;
+        uint64_t latencySum_us = 0;
+        uint64_t peakLatency_us = 0;
+        std::array<uint64_t, maxTemporalLayers> layerFrames{};
+        /* the frames which were not sent to a track, summed over the tracks */
+        uint64_t droppedFrames = 0;
+        uint64_t switchedTracks = 0;
+
+        /* the rewritten SPS by the SPS of the encoder */
+        static constexpr size_t maxSpsRewrites = 8;
+        std::map<NALUnit, NALUnit> spsRewrites;
+        std::atomic<bool> isLowDelaySps{false};
+
+        /* called with lock */
+        void startPendingTracks(bool isJoinPoint);
+        /* called with lock at an IDR, the number of tracks taken over */
+        uint64_t takeOverSwitchingTracks(bool hasParameterSets);
+        /* replace the SPS of a sample by its rewritten one */
+        void rewriteSps(NALUnit& sample);
     public:
         H264VideoStream()=default;
         ~H264VideoStream()=default;
@@ -65,10 +259,69 @@ class H264VideoStream
         void start();
         void stop();
         void addTrack(std::string id, const std::shared_ptr<H264VideoTrack>& track);
+        /**
+         * @brief start a new viewer. Its track gets the last IDR at once or,
+         * with setJoinAtRecoveryPoint, it waits for the next IDR or recovery
+         * point SEI.
+         */
+        void joinTrack(const std::string& id, const std::shared_ptr<H264VideoTrack>& track);
+        /**
+         * @brief for encoders with intra refresh, their IDRs are rare. A
+         * track which has found no join point in maxWait gets the last IDR.
+         */
+        void setJoinAtRecoveryPoint(bool enable,
+                                    std::chrono::milliseconds maxWait=std::chrono::milliseconds(3000));
         void deleteById(std::string id);
-        void onDataHandle(std::byte *data, size_t len);
+        /**
+         * @brief move a track from another encoding of the camera to this
+         * one. It is fed by the other encoding until the next IDR of this
+         * one, which is requested by the callback of onKeyframeRequest.
+         */
+        void switchTrack(const std::string& id, const std::shared_ptr<H264VideoTrack>& track);
+        /**
+         * @brief called in the thread of switchTrack, e.g. to force an IDR
+         * of the encoder. It must not block
+         */
+        void onKeyframeRequest(std::function<void()> callback);
+        /**
+         * @return the bit rate of all temporal layers, 0 until it is measured
+         */
+        double getBitrate_bps();
+        /**
+         * @brief rewrite the SPS of the samples for decoders which output
+         * every frame at once, see RewriteSpsForLowDelay. The tracks and
+         * the sinks get the rewritten SPS.
+         */
+        void setLowDelaySps(bool enable);
+        /**
+         * @brief the temporal layers of the encoder, see TemporalLayerTracker.
+         * 2 drops the non-reference frames for slow viewers, 3 also the
+         * middle layer of hierarchical-P. 1 sends every frame to every track
+         */
+        void setTemporalLayers(unsigned int layers);
+        unsigned int getTemporalLayers();
+        /**
+         * @brief add a consumer which is called in the capture thread after
+         * the tracks, it must not block.
+         */
+        void addSink(const std::string& name, StreamSink sink);
+        void removeSink(const std::string& name);
+        /**
+         * @brief send a frame to the tracks and sinks
+         * 
+         * @param captureTime_us steady clock time of the capture for the
+         * latency statistics, 0 if it is unknown
+         */
+        void onDataHandle(std::byte *data, size_t len, uint64_t captureTime_us=0);
         bool hasTrack();
         NALUnit getInitialNALUS();
+        /**
+         * @brief the frame sizes since the last call as JSON, the peak to
+         * mean ratio shows the bursts of IDR frames. The RTP packets and
+         * slices per frame and the capture to send latency compare single
+         * and multi slice encoding.
+         */
+        std::string getStatistics();
         static std::string getProfileLevelId(H264Profile profile,
                                              H264Level level);
 };
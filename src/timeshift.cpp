@@ -0,0 +1,322 @@
+/**
+ * @file timeshift.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "timeshift.hpp"
+#include "h264_bitstream.hpp"
+#include "utility.h"
+
+#include <string.h>
+
+#include <stdexcept>
+
+constexpr size_t start_code_size = 4;
+
+TimeShiftBuffer::TimeShiftBuffer(size_t bytes, size_t maxUnits, size_t maxJoinPoints):
+arena(bytes), writeOffset(0), units(maxUnits), head(0), tail(0),
+joinPoints(maxJoinPoints), joinHead(0), joinTail(0), nextHandoverId(0)
+{
+    if(bytes == 0 || maxUnits == 0 || maxJoinPoints == 0)
+    {
+        throw std::invalid_argument("the time shift buffer cannot be empty.");
+    }
+}
+
+void TimeShiftBuffer::addJoinPoint(uint64_t seq, uint64_t time_us)
+{
+    if(joinHead - joinTail == joinPoints.size())
+    {
+        joinTail++;
+    }
+    joinPoints[joinHead % joinPoints.size()] = {seq, time_us};
+    joinHead++;
+}
+
+void TimeShiftBuffer::append(const NALUnit& sample, uint64_t time_us)
+{
+    const size_t capacity = arena.size();
+    size_t size = sample.size();
+    if(size > capacity || size <= start_code_size)
+    {
+        ERROR_MESSAGE("the sample (%zu bytes) does not fit into the time shift buffer.", size);
+        return;
+    }
+
+    // the handovers are locked first, they must not be cancelled while
+    // they are called
+    std::lock_guard<std::mutex> handoverGuard(handoverLock);
+    std::map<uint64_t, Handover> ready;
+
+    lock.lock();
+    // keep the sample contiguous, skip the rest of the arena
+    size_t pos = writeOffset % capacity;
+    if(pos + size > capacity)
+    {
+        writeOffset += capacity - pos;
+        pos = 0;
+    }
+    uint64_t start = writeOffset;
+    writeOffset += size;
+
+    // drop the samples which will be overwritten
+    while(tail < head && (units[tail % units.size()].offset + capacity < writeOffset
+                          || head - tail >= units.size()))
+    {
+        tail++;
+    }
+    while(joinTail < joinHead && joinPoints[joinTail % joinPoints.size()].seq < tail)
+    {
+        joinTail++;
+    }
+
+    memcpy(arena.data() + pos, sample.data(), size);
+    units[head % units.size()] = {start, uint32_t(size), time_us};
+
+    // a join point is the SPS and PPS in front of an IDR, they can be in
+    // the samples before it or in the access unit of the IDR (AUD, SPS,
+    // PPS, SEI and the slice)
+    bool hasParameterSet = false;
+    bool hasIdr = false;
+    ForEachLeadingNalUnit(reinterpret_cast<const uint8_t *>(sample.data()), size,
+        [&hasParameterSet, &hasIdr](const uint8_t *nal, size_t len)
+        {
+            switch(NalTypeOf(nal))
+            {
+                case H264NalType::SPS:
+                case H264NalType::PPS:
+                {
+                    hasParameterSet = true;
+                    break;
+                }
+                case H264NalType::IDR:
+                {
+                    hasIdr = true;
+                    break;
+                }
+                default:
+                {
+                    break;
+                }
+            }
+        }
+    );
+    if(hasIdr)
+    {
+        addJoinPoint(joinCandidate.value_or(head), time_us);
+        joinCandidate.reset();
+    }else if(hasParameterSet)
+    {
+        if(!joinCandidate)
+        {
+            joinCandidate = head;
+        }
+    }else
+    {
+        joinCandidate.reset();
+    }
+    head++;
+    ready.swap(handovers);
+    lock.unlock();
+
+    for(auto& [id, handover]: ready)
+    {
+        handover(sample, time_us);
+    }
+}
+
+std::optional<uint64_t> TimeShiftBuffer::seek(uint64_t time_us)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(joinTail == joinHead)
+    {
+        return std::nullopt;
+    }
+
+    // the first join point after the time, the one before it is the result
+    uint64_t low = joinTail, high = joinHead;
+    while(low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        if(joinPoints[mid % joinPoints.size()].time_us <= time_us)
+        {
+            low = mid + 1;
+        }else
+        {
+            high = mid;
+        }
+    }
+    if(low > joinTail)
+    {
+        low--;
+    }
+    return joinPoints[low % joinPoints.size()].seq;
+}
+
+bool TimeShiftBuffer::read(uint64_t seq, NALUnit& sample, uint64_t& time_us)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(seq < tail || seq >= head)
+    {
+        return false;
+    }
+    auto& unit = units[seq % units.size()];
+    auto data = arena.data() + unit.offset % arena.size();
+    sample.assign(data, data + unit.size);
+    time_us = unit.time_us;
+    return true;
+}
+
+uint64_t TimeShiftBuffer::getHead()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return head;
+}
+
+uint64_t TimeShiftBuffer::getTail()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return tail;
+}
+
+uint64_t TimeShiftBuffer::getLiveTime()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return head > tail ? units[(head - 1) % units.size()].time_us : 0;
+}
+
+std::optional<uint64_t> TimeShiftBuffer::requestHandover(uint64_t seq, Handover handover)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(seq != head)
+    {
+        return std::nullopt;
+    }
+    auto id = nextHandoverId++;
+    handovers[id] = std::move(handover);
+    return id;
+}
+
+void TimeShiftBuffer::cancelHandover(uint64_t id)
+{
+    std::lock_guard<std::mutex> handoverGuard(handoverLock);
+    std::lock_guard<std::mutex> guard(lock);
+    handovers.erase(id);
+}
+
+TimeShiftPlayer::TimeShiftPlayer(const std::shared_ptr<TimeShiftBuffer>& b,
+                                 const std::shared_ptr<H264VideoTrack>& t,
+                                 uint64_t delay, double r):
+buffer(b), track(t), delay_us(delay), rate(r < 1 ? 1 : r), isStopped(false)
+{}
+
+TimeShiftPlayer::~TimeShiftPlayer()
+{
+    stop();
+}
+
+void TimeShiftPlayer::start(std::function<void(bool hasPlayed)> live)
+{
+    onLive = std::move(live);
+    player = std::thread(&TimeShiftPlayer::play, this);
+}
+
+void TimeShiftPlayer::stop()
+{
+    lock.lock();
+    isStopped = true;
+    lock.unlock();
+    wakeup.notify_all();
+    if(player.joinable())
+    {
+        player.join();
+    }
+    if(handoverId)
+    {
+        buffer->cancelHandover(handoverId.value());
+        handoverId.reset();
+    }
+}
+
+void TimeShiftPlayer::play()
+{
+    uint64_t liveTime = buffer->getLiveTime();
+    auto seq = buffer->seek(liveTime > delay_us ? liveTime - delay_us : 0);
+    if(!seq)
+    {
+        // nothing to rewind to, play live
+        onLive(false);
+        return;
+    }
+
+    NALUnit sample;
+    uint64_t sampleTime_us;
+    uint64_t next = seq.value();
+    std::optional<uint64_t> firstTime;
+    auto startTime = std::chrono::steady_clock::now();
+    // the time of the track continues from the live time when it starts
+    auto playTime = [liveTime, rate = rate](uint64_t first, uint64_t time_us)
+    {
+        return liveTime + uint64_t(double(time_us - first) / rate);
+    };
+
+    while(true)
+    {
+        if(!buffer->read(next, sample, sampleTime_us))
+        {
+            if(next < buffer->getTail())
+            {
+                // overtaken by the writer, continue at the oldest join point
+                seq = buffer->seek(0);
+                next = seq.value_or(buffer->getHead());
+                continue;
+            }
+            // caught up, the next sample goes to this track and then live
+            uint64_t first = firstTime.value_or(buffer->getLiveTime());
+            auto id = buffer->requestHandover(next,
+                [this, playTime, first](const NALUnit& sample, uint64_t time_us)
+                {
+                    uint64_t time = playTime(first, time_us);
+                    track->send(sample, time);
+                    track->setTimeOffset(int64_t(time) - int64_t(time_us));
+                    onLive(true);
+                }
+            );
+            std::lock_guard<std::mutex> guard(lock);
+            if(id)
+            {
+                handoverId = id;
+                APP_MESSAGE("time shift has caught up with the live stream.");
+                return;
+            }
+            if(isStopped)
+            {
+                return;
+            }
+            continue;
+        }
+        if(!firstTime)
+        {
+            firstTime = sampleTime_us;
+        }
+
+        // wait until the sample is due at the rate
+        auto due = startTime + std::chrono::microseconds(
+            uint64_t(double(sampleTime_us - firstTime.value()) / rate));
+        std::unique_lock<std::mutex> guard(lock);
+        if(wakeup.wait_until(guard, due, [this](){ return isStopped; }))
+        {
+            return;
+        }
+        guard.unlock();
+
+        track->send(sample, playTime(firstTime.value(), sampleTime_us));
+        next++;
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * @file timeshift.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __TIMESHIFT_H
+#define __TIMESHIFT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "streamer.hpp"
+
+/**
+ * @brief the recent samples of a stream in a ring of fixed size.
+ *
+ * the samples are copied into one arena, every sample is contiguous. The
+ * samples and the join points (SPS, PPS and IDR) are indexed by rings
+ * of fixed size, so no memory is allocated after the construction. The
+ * samples are numbered from the start, a number stays valid until its
+ * sample is overwritten.
+ */
+class TimeShiftBuffer
+{
+    public:
+        /* called in the capture thread with the sample that has just been added */
+        using Handover = std::function<void(const NALUnit& sample, uint64_t time_us)>;
+    private:
+        struct Unit
+        {
+            uint64_t offset;
+            uint32_t size;
+            uint64_t time_us;
+        };
+        struct JoinPoint
+        {
+            uint64_t seq;
+            uint64_t time_us;
+        };
+        std::vector<std::byte> arena;
+        uint64_t writeOffset;
+        std::vector<Unit> units;
+        uint64_t head;
+        uint64_t tail;
+        std::vector<JoinPoint> joinPoints;
+        uint64_t joinHead;
+        uint64_t joinTail;
+        std::optional<uint64_t> joinCandidate;
+
+        std::map<uint64_t, Handover> handovers;
+        uint64_t nextHandoverId;
+        std::mutex lock;
+        std::mutex handoverLock;
+
+        void addJoinPoint(uint64_t seq, uint64_t time_us);
+    public:
+        TimeShiftBuffer(size_t bytes, size_t maxUnits, size_t maxJoinPoints=1024);
+        ~TimeShiftBuffer()=default;
+
+        /**
+         * @brief add a sample, it can be fed as a sink of H264VideoStream
+         */
+        void append(const NALUnit& sample, uint64_t time_us);
+        /**
+         * @brief the number of the join point at or before the time, the
+         * oldest one if the time is not in the buffer any more.
+         */
+        std::optional<uint64_t> seek(uint64_t time_us);
+        /**
+         * @brief copy a sample, false if it is overwritten or not added yet
+         */
+        bool read(uint64_t seq, NALUnit& sample, uint64_t& time_us);
+        /* the number of the next sample */
+        uint64_t getHead();
+        uint64_t getTail();
+        /* the time of the latest sample */
+        uint64_t getLiveTime();
+        /**
+         * @brief call the handover with the next sample if the reader has
+         * read all samples before it. A reader uses it to switch to the
+         * live stream without losing a sample.
+         *
+         * @return the id of the handover, nothing if seq is not the head
+         */
+        std::optional<uint64_t> requestHandover(uint64_t seq, Handover handover);
+        /**
+         * @brief after it returns, the handover will not be called any more
+         */
+        void cancelHandover(uint64_t id);
+};
+
+/**
+ * @brief play the buffer from a join point in the past into a track, at
+ * real time or faster. The track is handed over to the live stream when
+ * the player has caught up.
+ */
+class TimeShiftPlayer
+{
+    private:
+        std::shared_ptr<TimeShiftBuffer> buffer;
+        std::shared_ptr<H264VideoTrack> track;
+        uint64_t delay_us;
+        double rate;
+        std::function<void(bool hasPlayed)> onLive;
+
+        std::thread player;
+        std::mutex lock;
+        std::condition_variable wakeup;
+        bool isStopped;
+        std::optional<uint64_t> handoverId;
+
+        void play();
+    public:
+        TimeShiftPlayer(const std::shared_ptr<TimeShiftBuffer>& b,
+                        const std::shared_ptr<H264VideoTrack>& t,
+                        uint64_t delay, double r);
+        ~TimeShiftPlayer();
+
+        /**
+         * @brief start to play, the callback adds the track to the live
+         * stream. It is called in the capture thread after the player has
+         * caught up, or at once with false if there is nothing to play.
+         */
+        void start(std::function<void(bool hasPlayed)> live);
+        void stop();
+};
+
+#endif /* __TIMESHIFT_H */
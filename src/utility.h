@@ -12,7 +12,9 @@
 #ifndef __UTILITY_H
 #define __UTILITY_H
 
+#include <stdint.h>
 #include <stdio.h>
+#include <time.h>
 
 #define ERROR_MESSAGE(...)  do{\
                                 fprintf(stderr, "ERROR: ");\
@@ -25,4 +27,13 @@
                                 fprintf(stderr, __VA_ARGS__);\
                                 fprintf(stderr, "\n");\
                             }while (0)
+
+/* the CPU time of the calling thread, for the cost of a frame */
+inline uint64_t ThreadCpuTime_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000UL + ts.tv_nsec;
+}
+
 #endif /* __UTILITY_H */
\ No newline at end of file
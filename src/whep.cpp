@@ -0,0 +1,461 @@
+/**
+ * @file whep.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "whep.hpp"
+#include "utility.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#include <nlohmann/json.hpp>
+
+const std::string WhepServer::pathPrefix = "/whep/";
+
+/* a viewer which sends its request slower is dropped */
+constexpr int requestTimeout_s = 5;
+
+static const char *statusText(int status)
+{
+    switch(status)
+    {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 415: return "Unsupported Media Type";
+        case 503: return "Service Unavailable";
+        default: return "Internal Server Error";
+    }
+}
+
+static std::string toLower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(),
+        [](unsigned char c){ return char(tolower(c)); });
+    return s;
+}
+
+/* %XX and + of a query component */
+static std::string urlDecode(const std::string& s)
+{
+    std::string decoded;
+    for(size_t i = 0; i < s.size(); i++)
+    {
+        if(s[i] == '+')
+        {
+            decoded += ' ';
+        }else if(s[i] == '%' && i + 2 < s.size() && isxdigit((unsigned char)s[i + 1])
+                 && isxdigit((unsigned char)s[i + 2]))
+        {
+            decoded += char(std::stoi(s.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }else
+        {
+            decoded += s[i];
+        }
+    }
+    return decoded;
+}
+
+WhepServer::WhepServer(uint16_t port, const std::string& address, size_t maxConn):
+listenFd(-1), wakeFd(-1), maxConnections(maxConn)
+{
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if(inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+    {
+        throw std::invalid_argument("Invalid address of the WHEP server: " + address);
+    }
+
+    int on = 1;
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    wakeFd = eventfd(0, EFD_CLOEXEC);
+    if(listenFd < 0 || wakeFd < 0
+       || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0
+       || bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+       || listen(listenFd, 16) < 0)
+    {
+        int error = errno;
+        if(listenFd >= 0) close(listenFd);
+        if(wakeFd >= 0) close(wakeFd);
+        throw std::system_error(error, std::generic_category(),
+                                "cannot listen on port " + std::to_string(port));
+    }
+    server = std::thread(&WhepServer::serverLoop, this);
+    APP_MESSAGE("WHEP server listens on %s:%u.", address.c_str(), unsigned(port));
+}
+
+WhepServer::~WhepServer()
+{
+    uint64_t one = 1;
+    if(write(wakeFd, &one, sizeof(one)) < 0)
+    {
+        ERROR_MESSAGE("cannot stop the WHEP server: %s", strerror(errno));
+    }
+    server.join();
+    for(auto& worker: workers)
+    {
+        worker.thread.join();
+    }
+    close(listenFd);
+    close(wakeFd);
+}
+
+void WhepServer::addStream(const std::string& name, RTCPeerSessionManager *peers)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    streams[name] = peers;
+}
+
+void WhepServer::removeStream(const std::string& name)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    streams.erase(name);
+}
+
+void WhepServer::serverLoop()
+{
+    while(true)
+    {
+        pollfd fds[] = {{wakeFd, POLLIN, 0}, {listenFd, POLLIN, 0}};
+        if(poll(fds, 2, 1000) < 0 && errno != EINTR)
+        {
+            ERROR_MESSAGE("the WHEP server stops: %s", strerror(errno));
+            return;
+        }
+        if(fds[0].revents)
+        {
+            return;
+        }
+
+        // join the finished requests
+        for(auto it = workers.begin(); it != workers.end();)
+        {
+            if(*it->isDone)
+            {
+                it->thread.join();
+                it = workers.erase(it);
+            }else
+            {
+                ++it;
+            }
+        }
+
+        if(!(fds[1].revents & POLLIN))
+        {
+            continue;
+        }
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if(fd < 0)
+        {
+            ERROR_MESSAGE("cannot accept a WHEP request: %s", strerror(errno));
+            continue;
+        }
+        if(workers.size() >= maxConnections)
+        {
+            Response response;
+            response.status = 503;
+            sendResponse(fd, response);
+            close(fd);
+            continue;
+        }
+        timeval timeout{requestTimeout_s, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        auto isDone = std::make_shared<std::atomic<bool>>(false);
+        workers.push_back({std::thread(
+            [this, fd, isDone]()
+            {
+                this->handleConnection(fd);
+                close(fd);
+                *isDone = true;
+            }), isDone});
+    }
+}
+
+void WhepServer::handleConnection(int fd)
+{
+    Request request;
+    Response response;
+    try
+    {
+        if(!readRequest(fd, request))
+        {
+            response.status = 400;
+        }else if(request.isTooLarge)
+        {
+            response.status = 413;
+        }else
+        {
+            response = handleRequest(request);
+        }
+    }catch(const std::exception& e)
+    {
+        ERROR_MESSAGE("WHEP %s %s: %s", request.method.c_str(),
+            request.path.c_str(), e.what());
+        response = Response();
+        response.status = 400;
+    }
+    sendResponse(fd, response);
+}
+
+bool WhepServer::readRequest(int fd, Request& request)
+{
+    std::string data;
+    size_t headerEnd;
+    char buffer[4096];
+    while((headerEnd = data.find("\r\n\r\n")) == std::string::npos)
+    {
+        if(data.size() > maxHeaderSize)
+        {
+            return false;
+        }
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+        if(len <= 0)
+        {
+            return false;
+        }
+        data.append(buffer, len);
+    }
+
+    // request line: METHOD SP target SP version
+    size_t lineEnd = data.find("\r\n");
+    std::string line = data.substr(0, lineEnd);
+    size_t first = line.find(' ');
+    size_t second = line.find(' ', first + 1);
+    if(first == std::string::npos || second == std::string::npos)
+    {
+        return false;
+    }
+    request.method = line.substr(0, first);
+    std::string target = line.substr(first + 1, second - first - 1);
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    if(question != std::string::npos)
+    {
+        std::string query = target.substr(question + 1);
+        size_t start = 0;
+        while(start < query.size())
+        {
+            size_t end = query.find('&', start);
+            std::string item = query.substr(start, end - start);
+            size_t equal = item.find('=');
+            request.query[urlDecode(item.substr(0, equal))] =
+                equal == std::string::npos ? "" : urlDecode(item.substr(equal + 1));
+            if(end == std::string::npos)
+            {
+                break;
+            }
+            start = end + 1;
+        }
+    }
+
+    size_t pos = lineEnd + 2;
+    while(pos < headerEnd)
+    {
+        size_t end = data.find("\r\n", pos);
+        std::string header = data.substr(pos, end - pos);
+        size_t colon = header.find(':');
+        if(colon != std::string::npos)
+        {
+            size_t value = header.find_first_not_of(" \t", colon + 1);
+            request.headers[toLower(header.substr(0, colon))] =
+                value == std::string::npos ? "" : header.substr(value);
+        }
+        pos = end + 2;
+    }
+
+    size_t length = 0;
+    auto it = request.headers.find("content-length");
+    if(it != request.headers.end())
+    {
+        length = std::stoul(it->second);
+    }
+    if(length > maxBodySize)
+    {
+        // nothing is allocated for a length from the client
+        request.isTooLarge = true;
+        return true;
+    }
+    request.body = data.substr(headerEnd + 4);
+    while(request.body.size() < length)
+    {
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+        if(len <= 0)
+        {
+            return false;
+        }
+        request.body.append(buffer, len);
+    }
+    request.body.resize(length);
+    return true;
+}
+
+WhepServer::Response WhepServer::handleRequest(const Request& request)
+{
+    Response response;
+    if(request.method == "OPTIONS")
+    {
+        // the preflight of a browser, the headers are in sendResponse
+        response.status = 204;
+        return response;
+    }
+    if(request.path.compare(0, pathPrefix.size(), pathPrefix) != 0)
+    {
+        response.status = 404;
+        return response;
+    }
+
+    // <name> or <name>/<id>
+    std::string resource = request.path.substr(pathPrefix.size());
+    size_t separator = resource.find('/');
+    std::string name = resource.substr(0, separator);
+    std::string id = separator == std::string::npos ? "" : resource.substr(separator + 1);
+
+    RTCPeerSessionManager *peers;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = streams.find(name);
+        if(it == streams.end())
+        {
+            response.status = 404;
+            return response;
+        }
+        peers = it->second;
+    }
+
+    if(id.empty() && request.method == "POST")
+    {
+        return postOffer(peers, name, request);
+    }else if(!id.empty() && request.method == "DELETE")
+    {
+        response.status = peers->closeRTCPeerSession(id) ? 200 : 404;
+        return response;
+    }
+    response.status = 405;
+    return response;
+}
+
+WhepServer::Response WhepServer::postOffer(RTCPeerSessionManager *peers,
+                                           const std::string& name,
+                                           const Request& request)
+{
+    Response response;
+    auto it = request.headers.find("content-type");
+    if(it == request.headers.end()
+       || toLower(it->second).compare(0, 15, "application/sdp") != 0)
+    {
+        response.status = 415;
+        return response;
+    }
+
+    // the same options as the notify message of ROAP
+    nlohmann::json options = nlohmann::json::object();
+    for(auto& [key, value]: request.query)
+    {
+        if(key == "class")
+        {
+            options["class"] = value;
+        }else if(key == "timeshift")
+        {
+            options["timeshift"] = std::stoul(value);
+        }else if(key == "rate")
+        {
+            options["rate"] = std::stod(value);
+        }else if(key == "minDelay")
+        {
+            options["playoutDelay"]["min"] = std::stoi(value);
+        }else if(key == "maxDelay")
+        {
+            options["playoutDelay"]["max"] = std::stoi(value);
+        }else if(key == "width")
+        {
+            options["viewport"]["width"] = std::stoul(value);
+        }else if(key == "height")
+        {
+            options["viewport"]["height"] = std::stoul(value);
+        }
+    }
+    NotifyMessage notify;
+    notify.parser(options.dump());
+
+    std::string id, answer;
+    if(!peers->answerRTCPeerSession(notify, request.body, id, answer))
+    {
+        response.status = 503;
+        return response;
+    }
+    APP_MESSAGE("WHEP viewer joins %s in session %s.", name.c_str(), id.c_str());
+    response.status = 201;
+    response.contentType = "application/sdp";
+    response.location = pathPrefix + name + "/" + id;
+    response.body = answer;
+    return response;
+}
+
+void WhepServer::sendResponse(int fd, const Response& response)
+{
+    std::string data = "HTTP/1.1 " + std::to_string(response.status) + " "
+                       + statusText(response.status) + "\r\n";
+    if(!response.contentType.empty())
+    {
+        data += "Content-Type: " + response.contentType + "\r\n";
+    }
+    if(!response.location.empty())
+    {
+        data += "Location: " + response.location + "\r\n";
+    }
+    if(response.status == 503)
+    {
+        data += "Retry-After: 5\r\n";
+    }
+    // players on other origins
+    data += "Access-Control-Allow-Origin: *\r\n"
+            "Access-Control-Allow-Methods: POST, DELETE, OPTIONS\r\n"
+            "Access-Control-Allow-Headers: Content-Type\r\n"
+            "Access-Control-Expose-Headers: Location\r\n";
+    data += "Content-Length: " + std::to_string(response.body.size()) + "\r\n"
+            "Connection: close\r\n\r\n";
+    data += response.body;
+
+    size_t done = 0;
+    while(done < data.size())
+    {
+        ssize_t len = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if(len <= 0)
+        {
+            if(len < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            ERROR_MESSAGE("cannot send the WHEP response: %s", strerror(errno));
+            return;
+        }
+        done += len;
+    }
+}
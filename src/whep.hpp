@@ -0,0 +1,97 @@
+/**
+ * @file whep.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __WHEP_H
+#define __WHEP_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "session.hpp"
+
+/**
+ * @brief a small HTTP server for WHEP (WebRTC-HTTP egress protocol), a
+ * viewer joins with one request instead of the ROAP exchange over MQTT.
+ *
+ *  POST   /whep/<name>[?class=&timeshift=&rate=&minDelay=&maxDelay=&width=&height=]
+ *                                                  body: SDP offer
+ *         201 Created, body: SDP answer, Location: /whep/<name>/<id>
+ *  DELETE /whep/<name>/<id>                        200 OK
+ *
+ * The answer contains all ICE candidates, trickle ICE (PATCH) is not
+ * supported. One connection carries one request, every request has its
+ * own thread because the answer waits for the ICE gathering.
+ */
+class WhepServer
+{
+    private:
+        struct Request
+        {
+            std::string method;
+            std::string path;
+            std::map<std::string, std::string> query;
+            std::map<std::string, std::string> headers;
+            std::string body;
+            /* the content length is over maxBodySize, the body is not read */
+            bool isTooLarge = false;
+        };
+        struct Response
+        {
+            int status = 500;
+            std::string contentType;
+            std::string location;
+            std::string body;
+        };
+        struct Worker
+        {
+            std::thread thread;
+            std::shared_ptr<std::atomic<bool>> isDone;
+        };
+
+        int listenFd;
+        int wakeFd;
+        size_t maxConnections;
+        std::thread server;
+        std::vector<Worker> workers;
+        std::unordered_map<std::string, RTCPeerSessionManager *> streams;
+        std::mutex lock;
+
+        void serverLoop();
+        void handleConnection(int fd);
+        bool readRequest(int fd, Request& request);
+        Response handleRequest(const Request& request);
+        Response postOffer(RTCPeerSessionManager *peers, const std::string& name,
+                           const Request& request);
+        void sendResponse(int fd, const Response& response);
+    public:
+        static constexpr size_t maxHeaderSize = 8 * 1024;
+        static constexpr size_t maxBodySize = 64 * 1024;
+        static const std::string pathPrefix;
+
+        WhepServer(uint16_t port, const std::string& address="0.0.0.0",
+                   size_t maxConnections=8);
+        ~WhepServer();
+        WhepServer(const WhepServer&)=delete;
+        WhepServer& operator=(const WhepServer&)=delete;
+
+        void addStream(const std::string& name, RTCPeerSessionManager *peers);
+        void removeStream(const std::string& name);
+};
+
+#endif /* __WHEP_H */
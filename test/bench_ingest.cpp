@@ -0,0 +1,165 @@
+/**
+ * @file bench_ingest.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief measure the Annex-B ingest against the V4L2 path. The same
+ * synthetic stream is handed on once directly in access units, like the
+ * buffers of the V4L2 encoder, and once written as a byte stream into a
+ * FIFO and reassembled by AnnexBSource. Every reassembled access unit is
+ * compared with the original.
+ *
+ * usage: bench_ingest [frames] [fps] [kbit/s]
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "ingest.hpp"
+#include "utility.h"
+
+using namespace std::chrono;
+
+const std::string fifoPath = "/tmp/bench_ingest.fifo";
+
+/* Constrained Baseline 640x480, level 3.0 */
+const uint8_t sps[] = {0x67, 0x42, 0xc0, 0x1e, 0x56, 0x80, 0xa0, 0x3d, 0x90};
+const uint8_t pps[] = {0x68, 0xce, 0x3c, 0x80};
+
+void appendNal(std::vector<uint8_t>& out, const uint8_t *nal, size_t len, bool isLong)
+{
+    static const uint8_t code[] = {0x00, 0x00, 0x00, 0x01};
+    out.insert(out.end(), isLong ? code : code + 1, code + 4);
+    out.insert(out.end(), nal, nal + len);
+}
+
+std::vector<uint8_t> makeSlice(std::mt19937& rng, bool isIdr, size_t size)
+{
+    std::vector<uint8_t> nal(size);
+    for(auto& b: nal)
+    {
+        // no start code inside the payload
+        b = uint8_t(rng()) | 0x80;
+    }
+    nal[0] = isIdr ? 0x65 : 0x41;
+    // first_mb_in_slice 0, slice type 7 or 5
+    nal[1] = isIdr ? 0x88 : 0x9a;
+    return nal;
+}
+
+double threadCpu_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 3000;
+    int fps = argc > 2 ? atoi(argv[2]) : 30;
+    int kbps = argc > 3 ? atoi(argv[3]) : 8000;
+
+    // the expected access units with 4 byte start codes and the byte stream
+    // of an encoder, which uses 3 byte start codes inside an access unit
+    std::mt19937 rng(1);
+    size_t pBytes = size_t(kbps) * 1000 / 8 / (fps + 3);
+    std::vector<std::vector<uint8_t>> units;
+    std::vector<uint8_t> stream;
+    for(int i = 0; i < frames; i++)
+    {
+        std::vector<uint8_t> unit;
+        if(i % fps == 0)
+        {
+            auto idr = makeSlice(rng, true, pBytes * 4);
+            appendNal(unit, sps, sizeof(sps), true);
+            appendNal(unit, pps, sizeof(pps), true);
+            appendNal(unit, idr.data(), idr.size(), true);
+            appendNal(stream, sps, sizeof(sps), true);
+            appendNal(stream, pps, sizeof(pps), false);
+            appendNal(stream, idr.data(), idr.size(), false);
+        }else
+        {
+            auto p = makeSlice(rng, false, pBytes);
+            appendNal(unit, p.data(), p.size(), true);
+            appendNal(stream, p.data(), p.size(), true);
+        }
+        units.push_back(std::move(unit));
+    }
+
+    size_t received = 0, mismatches = 0;
+    auto check = [&](void *data, size_t len)
+    {
+        auto& unit = units[received++ % units.size()];
+        if(len != unit.size() || memcmp(data, unit.data(), len) != 0)
+        {
+            mismatches++;
+        }
+    };
+
+    // the V4L2 path: one buffer per access unit
+    auto start = steady_clock::now();
+    double cpu = threadCpu_us();
+    for(auto& unit: units)
+    {
+        check(unit.data(), unit.size());
+    }
+    double directCpu = threadCpu_us() - cpu;
+    double direct = duration<double>(steady_clock::now() - start).count();
+
+    // the ingest path through a FIFO
+    received = 0;
+    AnnexBSource source(fifoPath);
+    source.onSample = check;
+    source.open();
+    std::thread writer([&stream]()
+    {
+        int fd = open(fifoPath.c_str(), O_WRONLY);
+        size_t done = 0;
+        while(fd >= 0 && done < stream.size())
+        {
+            // an encoder writes a few KiB at once
+            ssize_t len = write(fd, stream.data() + done, std::min(stream.size() - done, size_t(16384)));
+            if(len <= 0)
+            {
+                break;
+            }
+            done += len;
+        }
+        close(fd);
+    });
+    start = steady_clock::now();
+    cpu = threadCpu_us();
+    while(received < units.size() && steady_clock::now() - start < seconds(60))
+    {
+        source.handleLoop();
+    }
+    double ingestCpu = threadCpu_us() - cpu;
+    double ingest = duration<double>(steady_clock::now() - start).count();
+    writer.join();
+    source.close();
+    unlink(fifoPath.c_str());
+
+    double mbytes = stream.size() / 1e6;
+    printf("%d frames, %.1f MB, %.0f kbit/s at %d fps\n", frames, mbytes, double(kbps), fps);
+    printf("direct: %.1f MB/s, %.2f us cpu per frame\n",
+        mbytes / direct, directCpu / frames);
+    printf("ingest: %.1f MB/s, %.2f us cpu per frame, %.0f times real time\n",
+        mbytes / ingest, ingestCpu / frames, frames / double(fps) / ingest);
+    printf("access units: %zu of %d, %zu mismatches\n", received, frames, mismatches);
+    printf("ingest: %s\n", source.getStatistics().c_str());
+    return received == units.size() && mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,303 @@
+/**
+ * @file bench_join.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief measure how long a viewer needs to join a running camera, once
+ * with WHEP over HTTP and once with ROAP over the MQTT broker. For every
+ * join the time until the answer is set (signaling) and until the peer
+ * connection is connected is measured, then the session is closed again.
+ *
+ * usage: bench_join stream mqttUrl whepHost:port [joins]
+ * e.g.   bench_join camera tcp://127.0.0.1:1883 127.0.0.1:8080 50
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rtc/rtc.hpp>
+
+#include "mqtt_connect.hpp"
+#include "roaprotocol.hpp"
+#include "utility.h"
+
+using namespace std::chrono;
+
+constexpr auto joinTimeout = seconds(10);
+
+struct JoinTimes
+{
+    double signaling_ms;
+    double connected_ms;
+};
+
+static double elapsed_ms(steady_clock::time_point start)
+{
+    return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+/* one request per connection, the answer is read until the server closes */
+static bool httpRequest(const std::string& hostPort, const std::string& method,
+                        const std::string& path, const std::string& body,
+                        int& status, std::string& location, std::string& responseBody)
+{
+    size_t colon = hostPort.find(':');
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(uint16_t(std::stoi(hostPort.substr(colon + 1))));
+    inet_pton(AF_INET, hostPort.substr(0, colon).c_str(), &addr.sin_addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        if(fd >= 0) close(fd);
+        return false;
+    }
+    std::string request = method + " " + path + " HTTP/1.1\r\nHost: " + hostPort
+                          + "\r\nContent-Type: application/sdp\r\nContent-Length: "
+                          + std::to_string(body.size()) + "\r\n\r\n" + body;
+    send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    std::string response;
+    char buffer[4096];
+    ssize_t len;
+    while((len = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        response.append(buffer, len);
+    }
+    close(fd);
+
+    size_t headerEnd = response.find("\r\n\r\n");
+    if(response.size() < 12 || headerEnd == std::string::npos)
+    {
+        return false;
+    }
+    status = std::stoi(response.substr(9, 3));
+    size_t pos = response.find("\r\nLocation: ");
+    if(pos != std::string::npos && pos < headerEnd)
+    {
+        pos += 12;
+        location = response.substr(pos, response.find("\r\n", pos) - pos);
+    }
+    responseBody = response.substr(headerEnd + 4);
+    return true;
+}
+
+/* a viewer which receives the video and waits for its connection */
+class Viewer
+{
+    public:
+        rtc::PeerConnection pc;
+        std::shared_ptr<rtc::Track> track;
+        std::promise<void> gathered;
+        std::promise<void> connected;
+
+        Viewer(const rtc::Configuration& config): pc(config)
+        {
+            pc.onGatheringStateChange([this](rtc::PeerConnection::GatheringState state)
+            {
+                if(state == rtc::PeerConnection::GatheringState::Complete)
+                {
+                    gathered.set_value();
+                }
+            });
+            pc.onStateChange([this](rtc::PeerConnection::State state)
+            {
+                if(state == rtc::PeerConnection::State::Connected)
+                {
+                    connected.set_value();
+                }
+            });
+            pc.onTrack([this](std::shared_ptr<rtc::Track> t){ track = t; });
+        }
+};
+
+bool joinWhep(const rtc::Configuration& config, const std::string& hostPort,
+              const std::string& stream, JoinTimes& times)
+{
+    auto start = steady_clock::now();
+    Viewer viewer(config);
+    rtc::Description::Video media("video", rtc::Description::Direction::RecvOnly);
+    media.addH264Codec(102);
+    viewer.track = viewer.pc.addTrack(media);
+    viewer.pc.setLocalDescription(rtc::Description::Type::Offer);
+    if(viewer.gathered.get_future().wait_for(joinTimeout) != std::future_status::ready)
+    {
+        return false;
+    }
+
+    int status = 0;
+    std::string location, answer;
+    if(!httpRequest(hostPort, "POST", "/whep/" + stream,
+                    std::string(viewer.pc.localDescription().value()),
+                    status, location, answer) || status != 201)
+    {
+        ERROR_MESSAGE("WHEP POST failed with %d.", status);
+        return false;
+    }
+    viewer.pc.setRemoteDescription(rtc::Description(answer, rtc::Description::Type::Answer));
+    times.signaling_ms = elapsed_ms(start);
+    bool isConnected = viewer.connected.get_future().wait_for(joinTimeout)
+                       == std::future_status::ready;
+    times.connected_ms = elapsed_ms(start);
+
+    std::string body;
+    httpRequest(hostPort, "DELETE", location, "", status, location, body);
+    return isConnected;
+}
+
+bool joinRoap(const rtc::Configuration& config, MqttConnect& mqtt,
+              std::mutex& handlerLock, std::function<void(ROAPMessage&)>& handler,
+              const std::string& stream, int n, JoinTimes& times)
+{
+    std::string viewerId = "bench" + std::to_string(n);
+    std::string requestTopic = "webrtc/roap/" + stream + "/" + viewerId;
+    std::promise<void> completed;
+    std::unique_ptr<Viewer> viewer;
+    std::string offererId;
+    uint32_t seq = 0;
+
+    auto start = steady_clock::now();
+    {
+        std::lock_guard<std::mutex> guard(handlerLock);
+        handler = [&](ROAPMessage& in)
+        {
+            if(in.messageType == ROAPMessageType::Offer && !viewer)
+            {
+                offererId = in.offererSessionId;
+                seq = in.seq;
+                viewer = std::make_unique<Viewer>(config);
+                viewer->pc.setRemoteDescription(rtc::Description(in.sdp, rtc::Description::Type::Offer));
+                viewer->gathered.get_future().wait_for(joinTimeout);
+                ROAPMessage out;
+                out.messageType = ROAPMessageType::Answer;
+                out.offererSessionId = offererId;
+                out.answererSessionId = viewerId;
+                out.seq = seq;
+                out.sdp = std::string(viewer->pc.localDescription().value());
+                mqtt.publishMessage(requestTopic, out.toString());
+            }else if(in.messageType == ROAPMessageType::Ok && viewer)
+            {
+                completed.set_value();
+            }
+        };
+    }
+    mqtt.publishMessage("webrtc/notify/" + stream, "{\"viewerId\":\"" + viewerId + "\"}");
+
+    bool isJoined = completed.get_future().wait_for(joinTimeout) == std::future_status::ready;
+    times.signaling_ms = elapsed_ms(start);
+    if(isJoined)
+    {
+        isJoined = viewer->connected.get_future().wait_for(joinTimeout)
+                   == std::future_status::ready;
+    }
+    times.connected_ms = elapsed_ms(start);
+
+    {
+        std::lock_guard<std::mutex> guard(handlerLock);
+        handler = nullptr;
+    }
+    if(!offererId.empty())
+    {
+        ROAPMessage out;
+        out.messageType = ROAPMessageType::Shutdown;
+        out.offererSessionId = offererId;
+        out.answererSessionId = viewerId;
+        out.seq = seq + 1;
+        mqtt.publishMessage(requestTopic, out.toString());
+    }
+    return isJoined;
+}
+
+void report(const char *name, std::vector<JoinTimes>& joins, int failed)
+{
+    if(joins.empty())
+    {
+        printf("%s: all %d joins failed\n", name, failed);
+        return;
+    }
+    auto percentile = [&joins](double JoinTimes::*field, int p)
+    {
+        std::vector<double> values;
+        for(auto& item: joins)
+        {
+            values.push_back(item.*field);
+        }
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, values.size() * p / 100)];
+    };
+    printf("%s: %zu joins, %d failed\n", name, joins.size(), failed);
+    printf("  signaling: median %.1f ms, p95 %.1f ms\n",
+        percentile(&JoinTimes::signaling_ms, 50), percentile(&JoinTimes::signaling_ms, 95));
+    printf("  connected: median %.1f ms, p95 %.1f ms\n",
+        percentile(&JoinTimes::connected_ms, 50), percentile(&JoinTimes::connected_ms, 95));
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 4)
+    {
+        ERROR_MESSAGE("usage: %s stream mqttUrl whepHost:port [joins]", argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::string stream = argv[1];
+    int joins = argc > 4 ? atoi(argv[4]) : 20;
+    rtc::Configuration config;
+    rtc::InitLogger(rtc::LogLevel::Error);
+
+    std::mutex handlerLock;
+    std::function<void(ROAPMessage&)> handler;
+    MqttConnect mqtt(argv[2], "bench_join", "", "");
+    mqtt.onMessage = [&handlerLock, &handler](std::string topic, std::string message)
+    {
+        ROAPMessage in;
+        in.parser(message);
+        std::lock_guard<std::mutex> guard(handlerLock);
+        if(handler)
+        {
+            handler(in);
+        }
+    };
+    mqtt.subscribeTopic(ROAPBroadcastTopic + "/" + stream + "/+");
+
+    std::vector<JoinTimes> whepJoins, roapJoins;
+    int whepFailed = 0, roapFailed = 0;
+    for(int i = 0; i < joins; i++)
+    {
+        JoinTimes times;
+        if(joinWhep(config, argv[3], stream, times))
+        {
+            whepJoins.push_back(times);
+        }else
+        {
+            whepFailed++;
+        }
+        if(joinRoap(config, mqtt, handlerLock, handler, stream, i, times))
+        {
+            roapJoins.push_back(times);
+        }else
+        {
+            roapFailed++;
+        }
+        // the reaper of the camera erases the closed sessions
+        std::this_thread::sleep_for(milliseconds(200));
+    }
+    report("WHEP", whepJoins, whepFailed);
+    report("ROAP", roapJoins, roapFailed);
+    rtc::Cleanup();
+    return 0;
+}
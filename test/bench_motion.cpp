@@ -0,0 +1,81 @@
+/**
+ * @file bench_motion.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief feed a recorded H.264 stream into the motion detector and measure
+ * the cost per frame, the motion events are printed with their time.
+ *
+ * usage: bench_motion file.h264 [fps]
+ * the file is an Annex-B stream, e.g. recorded by
+ * v4l2-ctl --stream-mmap --stream-to=file.h264
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "h264_bitstream.hpp"
+#include "motion.hpp"
+#include "utility.h"
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        ERROR_MESSAGE("usage: %s file.h264 [fps]", argv[0]);
+        return EXIT_FAILURE;
+    }
+    unsigned int fps = argc > 2 ? atoi(argv[2]) : 30;
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    if(data.empty())
+    {
+        ERROR_MESSAGE("cannot read %s.", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    MotionDetector detector;
+    detector.onEvent = [](bool start, double score, uint64_t time_us)
+    {
+        printf("%8.2f s: motion %s, activity %.2f\n",
+            double(time_us) / 1000000, start ? "starts" : "stops", score);
+    };
+
+    // one sample per NAL unit like the V4L2 path, a picture per VCL NAL
+    const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+    uint64_t time_us = 0;
+    size_t units = 0;
+    auto start = std::chrono::steady_clock::now();
+    ForEachNalUnit(data.data(), data.size(),
+        [&](const uint8_t *nal, size_t len)
+        {
+            NALUnit sample(len + sizeof(startCode));
+            memcpy(sample.data(), startCode, sizeof(startCode));
+            memcpy(sample.data() + sizeof(startCode), nal, len);
+            if(IsVclNal(nal))
+            {
+                time_us += 1000000 / fps;
+            }
+            detector.onSample(sample, time_us);
+            units++;
+        }
+    );
+    auto elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    printf("%zu NAL units, %.2f s of video in %.2f ms\n",
+        units, double(time_us) / 1000000, elapsed);
+    printf("%s\n", detector.getStatistics().c_str());
+    return 0;
+}
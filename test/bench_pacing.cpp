@@ -0,0 +1,156 @@
+/**
+ * @file bench_pacing.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief send a camera stream through an emulated bottleneck, e.g. a cheap
+ * Wi-Fi access point with a small drop tail buffer, once in bursts and
+ * once paced by the token bucket of RtpPacer. The loss and the delay of
+ * the packets (pacer queue and bottleneck) are compared.
+ *
+ * usage: bench_pacing [linkMbps] [bufferPackets] [fraction] [rateKbps]
+ * e.g.   bench_pacing 20 64 0.5 4000
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "pacer.hpp"
+
+constexpr size_t packetSize = 1200;
+constexpr unsigned int fps = 30;
+constexpr uint64_t frameInterval_us = 1000000 / fps;
+constexpr unsigned int frames = 30 * fps;
+/* an IDR every 2 s, the P frames are small */
+constexpr unsigned int idrInterval = 2 * fps;
+constexpr size_t idrBytes = 150 * 1000;
+constexpr size_t pBytes = 8 * 1000;
+/* the camera's network interface */
+constexpr double senderRate_Bps = 100e6 / 8;
+
+struct Packet
+{
+    uint64_t sent_us;
+    uint64_t captured_us;
+    bool isIdr;
+};
+
+struct Result
+{
+    size_t packets = 0;
+    size_t lost = 0;
+    size_t idrLost = 0;
+    size_t damagedIdrs = 0;
+    double delaySum_ms = 0;
+    double peakDelay_ms = 0;
+};
+
+/* the send times of all packets, every frame is split into full packets */
+std::vector<Packet> sendStream(bool isPaced, const PacingConfig& config)
+{
+    std::vector<Packet> packets;
+    TokenBucket bucket(config.rate_kbps * 1000.0 / 8, config.burst_bytes);
+    uint64_t senderFree_us = 0;
+    for(unsigned int i = 0; i < frames; i++)
+    {
+        uint64_t captured_us = i * frameInterval_us;
+        bool isIdr = i % idrInterval == 0;
+        size_t count = ((isIdr ? idrBytes : pBytes) + packetSize - 1) / packetSize;
+        uint64_t now_us = std::max(captured_us, senderFree_us);
+        if(isPaced)
+        {
+            bucket.refill(now_us);
+            double spread_s = config.fraction * frameInterval_us / 1e6;
+            bucket.setRate(std::max(config.rate_kbps * 1000.0 / 8,
+                                    count * packetSize / spread_s));
+        }
+        for(size_t n = 0; n < count; n++)
+        {
+            if(isPaced)
+            {
+                bucket.refill(now_us);
+                while(!bucket.consume(packetSize))
+                {
+                    now_us += bucket.waitFor(packetSize);
+                    bucket.refill(now_us);
+                }
+            }
+            packets.push_back({now_us, captured_us, isIdr});
+            now_us += uint64_t(packetSize / senderRate_Bps * 1e6);
+        }
+        senderFree_us = now_us;
+    }
+    return packets;
+}
+
+/* a drop tail queue in front of a link */
+Result bottleneck(const std::vector<Packet>& packets, double link_Bps, size_t buffer)
+{
+    Result result;
+    std::deque<uint64_t> departures;
+    uint64_t linkFree_us = 0;
+    uint64_t damagedFrame = UINT64_MAX;
+    for(auto& packet: packets)
+    {
+        while(!departures.empty() && departures.front() <= packet.sent_us)
+        {
+            departures.pop_front();
+        }
+        result.packets++;
+        if(departures.size() >= buffer)
+        {
+            result.lost++;
+            if(packet.isIdr)
+            {
+                result.idrLost++;
+                if(damagedFrame != packet.captured_us)
+                {
+                    damagedFrame = packet.captured_us;
+                    result.damagedIdrs++;
+                }
+            }
+            continue;
+        }
+        linkFree_us = std::max(linkFree_us, packet.sent_us)
+                      + uint64_t(packetSize / link_Bps * 1e6);
+        departures.push_back(linkFree_us);
+        double delay_ms = (linkFree_us - packet.captured_us) / 1000.0;
+        result.delaySum_ms += delay_ms;
+        result.peakDelay_ms = std::max(result.peakDelay_ms, delay_ms);
+    }
+    return result;
+}
+
+void report(const char *name, const Result& result)
+{
+    size_t received = result.packets - result.lost;
+    printf("%-8s loss %5.2f %% (%zu of %zu), IDR packets lost %zu, IDRs damaged %zu,"
+           " delay mean %.1f ms peak %.1f ms\n",
+        name, 100.0 * result.lost / result.packets, result.lost, result.packets,
+        result.idrLost, result.damagedIdrs,
+        received > 0 ? result.delaySum_ms / received : 0.0, result.peakDelay_ms);
+}
+
+int main(int argc, char *argv[])
+{
+    double link_Bps = (argc > 1 ? atof(argv[1]) : 20) * 1e6 / 8;
+    size_t buffer = argc > 2 ? atoi(argv[2]) : 64;
+    PacingConfig config;
+    config.fraction = argc > 3 ? atof(argv[3]) : config.fraction;
+    config.rate_kbps = argc > 4 ? atoi(argv[4]) : config.rate_kbps;
+
+    printf("link %.0f Mbit/s, buffer %zu packets, IDR %zu bytes, pacing over %.0f %% of %llu ms\n",
+        link_Bps * 8 / 1e6, buffer, idrBytes, config.fraction * 100,
+        (unsigned long long)(frameInterval_us / 1000));
+    report("burst", bottleneck(sendStream(false, config), link_Bps, buffer));
+    report("paced", bottleneck(sendStream(true, config), link_Bps, buffer));
+    return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file bench_recorder.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief feed a synthetic stream in real time into the recorder and measure
+ * the write throughput and how much the recorder delays the capture loop.
+ *
+ * usage: bench_recorder directory [seconds] [fps] [kbit/s] [IDR period in s]
+ *
+ * an IDR period of 0 sends only the first IDR, like an encoder with intra
+ * refresh, the fragments are then closed after maxFragmentDuration.
+ *
+ * run it on a slow file system to see that the capture is not blocked,
+ * e.g. with the write bandwidth of the SD card limited to 1 MB/s:
+ * systemd-run --scope -p "IOWriteBandwidthMax=/dev/mmcblk0 1M" \
+ *     ./bench_recorder /mnt/sd/recordings 60 30 8000
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "recorder.hpp"
+#include "utility.h"
+
+using namespace std::chrono;
+
+/* Constrained Baseline 640x480, level 3.0 */
+const uint8_t sps[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1e, 0x56, 0x80, 0xa0, 0x3d, 0x90};
+const uint8_t pps[] = {0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x3c, 0x80};
+
+NALUnit makeSlice(std::mt19937& rng, bool isIdr, size_t size)
+{
+    NALUnit unit(size);
+    for(auto& b: unit)
+    {
+        b = std::byte(rng());
+    }
+    const uint8_t header[] = {0x00, 0x00, 0x00, 0x01, uint8_t(isIdr ? 0x65 : 0x41),
+                              uint8_t(isIdr ? 0x88 : 0x9a)};
+    memcpy(unit.data(), header, sizeof(header));
+    // no start code inside the payload
+    for(size_t i = sizeof(header); i < size; i++)
+    {
+        if(unit[i] == std::byte(0))
+        {
+            unit[i] = std::byte(0x80);
+        }
+    }
+    return unit;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        ERROR_MESSAGE("usage: %s directory [seconds] [fps] [kbit/s] [IDR period]", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int seconds = argc > 2 ? atoi(argv[2]) : 30;
+    int fps = argc > 3 ? atoi(argv[3]) : 30;
+    int kbps = argc > 4 ? atoi(argv[4]) : 4000;
+    int idrPeriod = argc > 5 ? atoi(argv[5]) : 1;
+
+    RecorderConfig config;
+    config.directory = argv[1];
+    config.name = "bench";
+    config.segmentDuration = std::chrono::seconds(10);
+
+    std::mt19937 rng(1);
+    // one IDR per period with 4 times the size of a P frame
+    size_t frameBytes = size_t(kbps) * 1000 / 8 / fps;
+    size_t pBytes = frameBytes * fps / (fps + 3);
+    std::vector<NALUnit> idr, p;
+    for(int i = 0; i < 4; i++)
+    {
+        idr.push_back(makeSlice(rng, true, pBytes * 4));
+        p.push_back(makeSlice(rng, false, pBytes));
+    }
+    NALUnit spsUnit(reinterpret_cast<const std::byte *>(sps),
+                    reinterpret_cast<const std::byte *>(sps) + sizeof(sps));
+    NALUnit ppsUnit(reinterpret_cast<const std::byte *>(pps),
+                    reinterpret_cast<const std::byte *>(pps) + sizeof(pps));
+
+    std::vector<double> costs, lateness;
+    auto start = steady_clock::now();
+    {
+        Recorder recorder(config);
+        for(int i = 0; i < seconds * fps; i++)
+        {
+            auto due = start + microseconds(uint64_t(i) * 1000000 / fps);
+            std::this_thread::sleep_until(due);
+            auto now = steady_clock::now();
+            lateness.push_back(duration<double, std::micro>(now - due).count());
+
+            uint64_t time_us = uint64_t(i) * 1000000 / fps;
+            if(idrPeriod > 0 ? i % (idrPeriod * fps) == 0 : i == 0)
+            {
+                recorder.onSample(spsUnit, time_us);
+                recorder.onSample(ppsUnit, time_us);
+                recorder.onSample(idr[i % idr.size()], time_us);
+            }else
+            {
+                recorder.onSample(p[i % p.size()], time_us);
+            }
+            costs.push_back(duration<double, std::micro>(steady_clock::now() - now).count());
+        }
+        printf("recorder: %s\n", recorder.getStatistics().c_str());
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    std::sort(costs.begin(), costs.end());
+    std::sort(lateness.begin(), lateness.end());
+    auto p99 = [](std::vector<double>& v){ return v[v.size() * 99 / 100]; };
+    printf("%d frames in %.2f s, %.1f kbit/s\n", seconds * fps, elapsed,
+        double(kbps));
+    printf("capture cost per frame: median %.1f us, p99 %.1f us, max %.1f us\n",
+        costs[costs.size() / 2], p99(costs), costs.back());
+    printf("capture jitter: median %.1f us, p99 %.1f us, max %.1f us\n",
+        lateness[lateness.size() / 2], p99(lateness), lateness.back());
+    return 0;
+}
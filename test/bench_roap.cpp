@@ -0,0 +1,129 @@
+/**
+ * @file bench_roap.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief parse/serialize microbenchmark of ROAP messages carrying a real SDP,
+ * compares the DOM based JSON codec with the single pass codec and the
+ * compact encodings.
+ *
+ * usage: bench_roap [iterations]
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "roaprotocol.hpp"
+
+/* answer of Chrome 118 to an offer of the camera */
+const std::string answerSdp =
+    "v=0\r\n"
+    "o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\n"
+    "s=-\r\n"
+    "t=0 0\r\n"
+    "a=group:BUNDLE camera\r\n"
+    "a=extmap-allow-mixed\r\n"
+    "a=msid-semantic: WMS\r\n"
+    "m=video 9 UDP/TLS/RTP/SAVPF 100\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=rtcp:9 IN IP4 0.0.0.0\r\n"
+    "a=candidate:1467250027 1 udp 2122260223 192.168.5.21 53745 typ host generation 0 network-id 1\r\n"
+    "a=candidate:3719485329 1 udp 1686052607 84.151.22.3 53745 typ srflx raddr 192.168.5.21 rport 53745 generation 0 network-id 1\r\n"
+    "a=candidate:435653019 1 tcp 1518280447 192.168.5.21 9 typ host tcptype active generation 0 network-id 1\r\n"
+    "a=ice-ufrag:ZB0r\r\n"
+    "a=ice-pwd:hH7zaS3D8Vtq1cxEW2xsUeL0\r\n"
+    "a=ice-options:trickle\r\n"
+    "a=fingerprint:sha-256 8D:5E:71:0A:4B:1E:6F:63:17:C8:27:95:BB:21:E9:4A:1E:D6:C5:86:64:0A:4F:32:21:5F:AE:76:0A:3D:55:2B\r\n"
+    "a=setup:active\r\n"
+    "a=mid:camera\r\n"
+    "a=recvonly\r\n"
+    "a=rtcp-mux\r\n"
+    "a=rtcp-rsize\r\n"
+    "a=rtpmap:100 H264/90000\r\n"
+    "a=rtcp-fb:100 goog-remb\r\n"
+    "a=rtcp-fb:100 transport-cc\r\n"
+    "a=rtcp-fb:100 ccm fir\r\n"
+    "a=rtcp-fb:100 nack\r\n"
+    "a=rtcp-fb:100 nack pli\r\n"
+    "a=fmtp:100 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n";
+
+/**
+ * @brief the codec before: validate, build a DOM, copy every field and
+ * pretty print
+ */
+void legacyRoundTrip(const std::string& data, std::string& out)
+{
+    if(nlohmann::json::accept(data))
+    {
+        auto rootJson = nlohmann::json::parse(data);
+        ROAPMessage message;
+        message.offererSessionId = rootJson["offererSessionId"].get<std::string>();
+        message.answererSessionId = rootJson["answererSessionId"].get<std::string>();
+        message.seq = rootJson["seq"].get<unsigned>();
+        message.sdp = rootJson["sdp"].get<std::string>();
+        nlohmann::ordered_json json;
+        json["messageType"] = "ANSWER";
+        json["offererSessionId"] = message.offererSessionId;
+        json["answererSessionId"] = message.answererSessionId;
+        json["seq"] = message.seq;
+        json["sdp"] = message.sdp;
+        out = json.dump(4);
+    }
+}
+
+template<typename F>
+double measure(int iterations, F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++)
+    {
+        f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+    const char *names[] = {"json", "cbor", "msgpack"};
+    ROAPMessage answer;
+    std::string out;
+
+    answer.messageType = ROAPMessageType::Answer;
+    answer.offererSessionId = "Jd0-4sRcBfUuq2Wx";
+    answer.answererSessionId = "b1c87a90e5c94f37";
+    answer.seq = 1;
+    answer.sdp = answerSdp;
+
+    std::string legacy = answer.toString();
+    double legacyUs = measure(iterations, [&](){ legacyRoundTrip(legacy, out); });
+    printf("%-8s size: %5zu bytes, parse+serialize: %8.3f us\n",
+        "legacy", out.size(), legacyUs);
+
+    for(int i = 0; i < 3; i++)
+    {
+        auto encoding = ROAPEncoding(i);
+        std::string data = answer.toString(encoding);
+        double encodeUs = measure(iterations, [&](){ out = answer.toString(encoding); });
+        double decodeUs = measure(iterations,
+            [&]()
+            {
+                ROAPMessage in;
+                in.parser(data);
+            }
+        );
+        printf("%-8s size: %5zu bytes, parse: %8.3f us, serialize: %8.3f us\n",
+            names[i], data.size(), decodeUs, encodeUs);
+    }
+    return 0;
+}
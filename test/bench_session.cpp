@@ -0,0 +1,94 @@
+/**
+ * @file bench_session.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief measure how long it takes until a new session has its local offer,
+ * with and without a shared DTLS certificate.
+ *
+ * usage: bench_session [count] [cert.pem key.pem]
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rtc/rtc.hpp>
+
+#include "certificate.hpp"
+#include "utility.h"
+
+/**
+ * @brief create a peer connection with a video track and wait for its offer
+ *
+ * @return double latency in ms
+ */
+double createSession(const rtc::Configuration& config)
+{
+    std::promise<void> offered;
+    auto start = std::chrono::steady_clock::now();
+
+    auto pc = std::make_unique<rtc::PeerConnection>(config);
+    pc->onLocalDescription(
+        [&offered](rtc::Description)
+        {
+            offered.set_value();
+        }
+    );
+    rtc::Description::Video media("video", rtc::Description::Direction::SendOnly);
+    media.addH264Codec(100);
+    pc->addTrack(media);
+    pc->setLocalDescription(rtc::Description::Type::Offer);
+
+    offered.get_future().wait();
+    auto end = std::chrono::steady_clock::now();
+    pc->close();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 10;
+    rtc::Configuration config;
+    std::vector<double> latency;
+
+    if(argc > 3)
+    {
+        DtlsCertificate certificate(argv[2], argv[3]);
+        certificate.applyTo(config);
+        APP_MESSAGE("use the shared certificate %s.", argv[2]);
+    }else
+    {
+        APP_MESSAGE("every session generates its own certificate.");
+    }
+
+    rtc::Preload();
+    for(int i = 0; i < count; i++)
+    {
+        latency.push_back(createSession(config));
+    }
+
+    double sum = 0;
+    for(int i = 0; i < count; i++)
+    {
+        printf("session %d: %.3f ms\n", i, latency[i]);
+        sum += latency[i];
+    }
+    if(count > 0)
+    {
+        printf("first: %.3f ms, mean: %.3f ms\n", latency[0], sum / count);
+    }
+
+    rtc::Cleanup();
+    return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file bench_slices.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief compare the loss resilience of single slice and multi slice
+ * frames. The frames are packetized like H264VideoStream counts them: a
+ * slice over one RTP payload is sent as FU-A, a byte limited slice fits one
+ * packet. The packets are lost at random. A slice with a lost packet cannot
+ * be decoded, a P frame shows the damage of its reference until the next
+ * IDR (no NACK, no motion of the damaged area).
+ *
+ * The picture area of a slice is taken as its part of the frame bytes, and
+ * a slice costs sliceOverhead bytes more. The coding loss of the intra
+ * prediction over the slice borders is not modelled.
+ *
+ * build: g++ -std=c++17 test/bench_slices.cpp
+ *
+ * usage: bench_slices [kbit/s] [fps] [seconds]
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <vector>
+
+/* rtp_payload_size of the stream */
+constexpr size_t payloadSize = 1220;
+/* the byte limit of the encoder, a slice and its NAL header fit a packet */
+constexpr size_t sliceLimit = 1200;
+/* slice header and the cabac/cavlc alignment of a slice */
+constexpr size_t sliceOverhead = 8;
+constexpr unsigned int idrSeconds = 2;
+constexpr double lossRates[] = {0.001, 0.005, 0.01, 0.02, 0.05};
+
+struct Result
+{
+    double packets = 0;
+    /* frames with a lost packet */
+    double damagedFrames = 0;
+    /* the area of a frame which is lost, of the damaged frames */
+    double lostArea = 0;
+    /* the area of every shown frame which is wrong, with the propagation */
+    double wrongArea = 0;
+};
+
+/**
+ * @param isMultiSlice split the frames by sliceLimit
+ */
+static Result simulate(bool isMultiSlice, double loss, size_t pBytes, unsigned int fps,
+                       unsigned int frames, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution isLost(loss);
+    Result result;
+    double wrong = 0;
+    size_t damaged = 0;
+    for(unsigned int i = 0; i < frames; i++)
+    {
+        bool isIdr = i % (idrSeconds * fps) == 0;
+        size_t bytes = isIdr ? 4 * pBytes : pBytes;
+
+        std::vector<size_t> slices;
+        if(isMultiSlice)
+        {
+            size_t count = (bytes + sliceLimit - sliceOverhead - 1) / (sliceLimit - sliceOverhead);
+            slices.assign(count, bytes / count + sliceOverhead);
+        }else
+        {
+            slices.push_back(bytes);
+        }
+
+        double lostArea = 0;
+        for(auto slice: slices)
+        {
+            size_t packets = (slice + payloadSize - 1) / payloadSize;
+            bool isSliceLost = false;
+            for(size_t p = 0; p < packets; p++)
+            {
+                isSliceLost = isLost(rng) || isSliceLost;
+            }
+            result.packets += packets;
+            lostArea += isSliceLost ? 1.0 / slices.size() : 0;
+        }
+        if(lostArea > 0)
+        {
+            damaged++;
+            result.lostArea += lostArea;
+        }
+        // an IDR repairs the picture, a P frame keeps the damage
+        wrong = isIdr ? lostArea : 1 - (1 - wrong) * (1 - lostArea);
+        result.wrongArea += wrong;
+    }
+    result.packets /= frames;
+    result.damagedFrames = double(damaged) / frames;
+    result.lostArea = damaged > 0 ? result.lostArea / damaged : 0;
+    result.wrongArea /= frames;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int kbps = argc > 1 ? atoi(argv[1]) : 4000;
+    unsigned int fps = argc > 2 ? atoi(argv[2]) : 30;
+    unsigned int seconds = argc > 3 ? atoi(argv[3]) : 3600;
+    unsigned int frames = seconds * fps;
+    // one IDR with 4 times the size of a P frame per IDR period
+    size_t periodFrames = idrSeconds * fps;
+    size_t pBytes = size_t(kbps) * 1000 / 8 * idrSeconds / (periodFrames + 3);
+
+    printf("%u kbit/s, %u fps, P frame %zu bytes, IDR %zu bytes, an IDR every %u s\n",
+        kbps, fps, pBytes, 4 * pBytes, idrSeconds);
+    printf("%6s %-7s %13s %14s %15s %16s\n", "loss", "slices", "packets/frame",
+        "damaged frames", "lost of damaged", "wrong area shown");
+    for(double loss: lossRates)
+    {
+        for(bool isMultiSlice: {false, true})
+        {
+            auto result = simulate(isMultiSlice, loss, pBytes, fps, frames, 1);
+            printf("%5.1f%% %-7s %13.2f %13.2f%% %14.1f%% %15.2f%%\n", loss * 100,
+                isMultiSlice ? "multi" : "single", result.packets,
+                result.damagedFrames * 100, result.lostArea * 100, result.wrongArea * 100);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file check.hpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief the checks of the tests which print one line per check
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef __CHECK_H
+#define __CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* the number of failed checks */
+inline int failures = 0;
+
+/**
+ * @brief print the check with ok or FAILED and count it if it fails
+ */
+inline void check(bool condition, const char *what)
+{
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    failures += !condition;
+}
+
+/**
+ * @brief print the result of all checks
+ *
+ * @return the exit code of the test
+ */
+inline int checkResult()
+{
+    printf("%s\n", failures == 0 ? "passed" : "FAILED");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* __CHECK_H */
@@ -0,0 +1,112 @@
+/**
+ * @file test_bandwidth_recovery.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief a viewer with a REMB of 3 Mbit/s gets 2 Mbit/s until its receiver
+ * reports 25 % loss. The sender falls back to 1 Mbit/s like a stream which
+ * drops a layer or an encoding while the estimate is below 2 Mbit/s. When
+ * the loss stops, the estimate must come back to the REMB after the
+ * recovery period, although the send rate does not rise before.
+ *
+ * usage: test_bandwidth_recovery
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <thread>
+
+#include "rate_control.hpp"
+#include "check.hpp"
+
+constexpr uint64_t recovery_us = 1000 * 1000;
+constexpr double rembRate_bps = 3000000;
+constexpr double highRate_bps = 2000000;
+constexpr double lowRate_bps = 1000000;
+constexpr unsigned int tick_ms = 10;
+/* a receiver report every 10 ticks */
+constexpr unsigned int reportTicks = 10;
+
+static rtc::message_ptr makeControl(const uint8_t *data, size_t size)
+{
+    auto message = rtc::make_message(size, rtc::Message::Control);
+    for(size_t i = 0; i < size; i++)
+    {
+        (*message)[i] = std::byte(data[i]);
+    }
+    return message;
+}
+
+static rtc::message_ptr makeRemb(uint32_t bitrate_bps)
+{
+    uint8_t exponent = 0;
+    while((bitrate_bps >> exponent) > 0x3ffff)
+    {
+        exponent++;
+    }
+    uint32_t mantissa = bitrate_bps >> exponent;
+    uint8_t remb[24] = {0x8f, 206, 0, 5, 0, 0, 0, 1, 0, 0, 0, 0, 'R', 'E', 'M', 'B', 1,
+                        uint8_t((exponent << 2) | (mantissa >> 16)),
+                        uint8_t(mantissa >> 8), uint8_t(mantissa), 0, 0, 0, 1};
+    return makeControl(remb, sizeof(remb));
+}
+
+/* a receiver report with one report block, the fraction lost of 256 */
+static rtc::message_ptr makeReport(double loss)
+{
+    uint8_t report[32] = {0x81, 201, 0, 7, 0, 0, 0, 1, 0, 0, 0, 2, uint8_t(loss * 256)};
+    return makeControl(report, sizeof(report));
+}
+
+/**
+ * @brief send at 2 Mbit/s while the estimate allows it, else at 1 Mbit/s,
+ * and report the loss periodically
+ */
+static void run(BandwidthEstimator& estimator, double loss, unsigned int duration_ms)
+{
+    for(unsigned int elapsed = 0; elapsed < duration_ms; elapsed += tick_ms)
+    {
+        double rate_bps = estimator.getEstimate_bps() >= highRate_bps ? highRate_bps
+                                                                       : lowRate_bps;
+        size_t bytes = size_t(rate_bps / 8 * tick_ms / 1000);
+        auto packets = std::make_shared<std::vector<rtc::binary>>();
+        packets->emplace_back(bytes / 2);
+        packets->emplace_back(bytes - bytes / 2);
+        estimator.processOutgoingBinaryMessage(packets, nullptr);
+        if((elapsed / tick_ms) % reportTicks == reportTicks - 1)
+        {
+            estimator.processIncomingControlMessage(makeReport(loss));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(tick_ms));
+    }
+    printf("  estimate %4.2f Mbit/s, send rate %4.2f Mbit/s\n",
+           estimator.getEstimate_bps() / 1e6, estimator.getSendRate_bps() / 1e6);
+}
+
+int main()
+{
+    BandwidthEstimator estimator(recovery_us);
+    estimator.processIncomingControlMessage(makeRemb(uint32_t(rembRate_bps)));
+
+    printf("no loss\n");
+    run(estimator, 0, 1000);
+    check(estimator.getEstimate_bps() == rembRate_bps, "the REMB is the estimate");
+
+    printf("25 %% loss\n");
+    run(estimator, 0.25, 1000);
+    check(estimator.getEstimate_bps() < highRate_bps, "the estimate falls below the send rate");
+
+    printf("the loss stops\n");
+    run(estimator, 0, recovery_us / 2000);
+    check(estimator.getEstimate_bps() < rembRate_bps, "the estimate is limited for a while");
+    run(estimator, 0, recovery_us / 1000);
+    check(estimator.getEstimate_bps() == rembRate_bps, "the REMB is the estimate again");
+
+    return checkResult();
+}
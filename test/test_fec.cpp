@@ -0,0 +1,302 @@
+/**
+ * @file test_fec.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief send a camera stream through UlpfecEncoder to two tracks which
+ * share the FEC cache, drop packets randomly or in bursts and recover
+ * them like a receiver (RFC 5109 10.2). Every recovered packet is compared
+ * with the sent one, the recovery rate and the overhead are reported for
+ * each loss rate.
+ *
+ * usage: test_fec [seconds]
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "fec.hpp"
+
+constexpr size_t payloadSize = 1200;
+constexpr unsigned int fps = 30;
+constexpr unsigned int idrInterval = 2 * fps;
+constexpr size_t idrBytes = 150 * 1000;
+constexpr size_t pBytes = 8 * 1000;
+constexpr int h264PayloadType = 100;
+constexpr size_t extensionSize = 12;
+
+using Frame = std::vector<rtc::binary>;
+
+struct Result
+{
+    size_t frames = 0;
+    size_t media = 0;
+    size_t fec = 0;
+    size_t lost = 0;
+    size_t recovered = 0;
+    size_t wrong = 0;
+    size_t damagedFrames = 0;
+    size_t repairedFrames = 0;
+};
+
+/* the packets of the packetizer, the first one has a header extension */
+Frame packetize(size_t bytes, uint32_t timestamp, std::mt19937& random, uint8_t track)
+{
+    Frame frame;
+    size_t count = (bytes + payloadSize - 1) / payloadSize;
+    for(size_t i = 0; i < count; i++)
+    {
+        size_t size = i + 1 < count ? payloadSize : bytes - i * payloadSize;
+        bool hasExtension = i == 0;
+        rtc::binary packet(12 + (hasExtension ? extensionSize : 0) + size);
+        packet[0] = std::byte(hasExtension ? 0x90 : 0x80);
+        packet[1] = std::byte((i + 1 == count ? 0x80 : 0x00) | h264PayloadType);
+        for(int b = 0; b < 4; b++)
+        {
+            packet[4 + b] = std::byte(timestamp >> (24 - 8 * b));
+            packet[8 + b] = std::byte(b == 3);
+        }
+        size_t pos = 12;
+        if(hasExtension)
+        {
+            // 0xBEDE, 2 words, the capture time differs per track
+            uint8_t extension[extensionSize] = {0xbe, 0xde, 0x00, 0x02, 0x67, track};
+            for(size_t b = 0; b < extensionSize; b++)
+            {
+                packet[pos++] = std::byte(extension[b]);
+            }
+        }
+        for(; pos < packet.size(); pos++)
+        {
+            packet[pos] = std::byte(random() & 0xff);
+        }
+        frame.push_back(std::move(packet));
+    }
+    return frame;
+}
+
+/* the media packet or the FEC packet of a RED packet */
+rtc::binary unwrapRed(const rtc::binary& packet)
+{
+    size_t header = 12;
+    if((uint8_t(packet[0]) & 0x10) != 0)
+    {
+        header += 4 + 4 * ((uint8_t(packet[14]) << 8) | uint8_t(packet[15]));
+    }
+    rtc::binary out(packet.begin(), packet.begin() + header);
+    out.insert(out.end(), packet.begin() + header + 1, packet.end());
+    out[1] = (packet[1] & std::byte(0x80)) | (packet[header] & std::byte(0x7f));
+    return out;
+}
+
+uint16_t sequenceOf(const rtc::binary& packet)
+{
+    return uint16_t((uint8_t(packet[2]) << 8) | uint8_t(packet[3]));
+}
+
+/* recover the one lost packet which the FEC packet protects */
+rtc::binary recover(const rtc::binary& fec, const std::map<uint16_t, rtc::binary>& received,
+                    uint16_t lost)
+{
+    auto f = reinterpret_cast<const uint8_t *>(fec.data()) + 12;
+    bool isLongMask = (f[0] & 0x40) != 0;
+    uint16_t base = uint16_t((f[2] << 8) | f[3]);
+    size_t maskSize = isLongMask ? 6 : 2;
+    const uint8_t *level = f + 10;
+    size_t protection = (level[0] << 8) | level[1];
+    const uint8_t *data = level + 2 + maskSize;
+
+    uint8_t header[8];
+    std::copy(f, f + 8, header);
+    uint16_t length = uint16_t((f[8] << 8) | f[9]);
+    std::vector<uint8_t> block(data, data + protection);
+    for(size_t i = 0; i < maskSize * 8; i++)
+    {
+        if((level[2 + i / 8] & (0x80 >> (i % 8))) == 0 || uint16_t(base + i) == lost)
+        {
+            continue;
+        }
+        auto& packet = received.at(uint16_t(base + i));
+        auto p = reinterpret_cast<const uint8_t *>(packet.data());
+        header[0] ^= p[0];
+        header[1] ^= p[1];
+        for(int b = 4; b < 8; b++)
+        {
+            header[b] ^= p[b];
+        }
+        length ^= uint16_t(packet.size() - 12);
+        for(size_t b = 12; b < packet.size(); b++)
+        {
+            block[b - 12] ^= p[b];
+        }
+    }
+    rtc::binary packet(12 + length);
+    packet[0] = std::byte(0x80 | (header[0] & 0x3f));
+    packet[1] = std::byte(header[1]);
+    packet[2] = std::byte(lost >> 8);
+    packet[3] = std::byte(lost & 0xff);
+    for(int b = 4; b < 8; b++)
+    {
+        packet[b] = std::byte(header[b]);
+    }
+    std::copy(fec.begin() + 8, fec.begin() + 12, packet.begin() + 8);
+    for(size_t b = 0; b < length && b < block.size(); b++)
+    {
+        packet[12 + b] = std::byte(block[b]);
+    }
+    return packet;
+}
+
+/* a Gilbert-Elliott channel, burst 1 gives random loss */
+class Channel
+{
+    private:
+        std::mt19937 random;
+        double enterBad;
+        double leaveBad;
+        bool isBad = false;
+    public:
+        Channel(double loss, double burst): random(7), leaveBad(1.0 / burst)
+        {
+            enterBad = loss * leaveBad / (1 - loss);
+        }
+        bool drops()
+        {
+            std::uniform_real_distribution<double> uniform(0, 1);
+            isBad = isBad ? uniform(random) >= leaveBad : uniform(random) < enterBad;
+            return isBad;
+        }
+};
+
+void receive(const Frame& sent, Channel& channel, Result& result)
+{
+    std::map<uint16_t, rtc::binary> media;
+    std::map<uint16_t, rtc::binary> lostMedia;
+    std::vector<rtc::binary> fecPackets;
+    for(auto& red: sent)
+    {
+        auto packet = unwrapRed(red);
+        bool isFec = (uint8_t(packet[1]) & 0x7f) != h264PayloadType;
+        (isFec ? result.fec : result.media)++;
+        if(channel.drops())
+        {
+            if(!isFec)
+            {
+                lostMedia[sequenceOf(packet)] = packet;
+                result.lost++;
+            }
+            continue;
+        }
+        if(isFec)
+        {
+            fecPackets.push_back(packet);
+        }else
+        {
+            media[sequenceOf(packet)] = packet;
+        }
+    }
+    size_t recovered = 0;
+    for(auto& fec: fecPackets)
+    {
+        auto f = reinterpret_cast<const uint8_t *>(fec.data()) + 12;
+        uint16_t base = uint16_t((f[2] << 8) | f[3]);
+        size_t maskSize = (f[0] & 0x40) ? 6 : 2;
+        std::vector<uint16_t> missing;
+        for(size_t i = 0; i < maskSize * 8; i++)
+        {
+            uint16_t sequence = uint16_t(base + i);
+            if((f[12 + i / 8] & (0x80 >> (i % 8))) && media.count(sequence) == 0)
+            {
+                missing.push_back(sequence);
+            }
+        }
+        if(missing.size() != 1)
+        {
+            continue;
+        }
+        auto packet = recover(fec, media, missing[0]);
+        if(packet == lostMedia.at(missing[0]))
+        {
+            recovered++;
+        }else
+        {
+            result.wrong++;
+        }
+    }
+    result.frames++;
+    result.recovered += recovered;
+    if(!lostMedia.empty())
+    {
+        result.damagedFrames++;
+        result.repairedFrames += recovered == lostMedia.size();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int frames = (argc > 1 ? atoi(argv[1]) : 60) * fps;
+    const double losses[] = {0.01, 0.03, 0.05, 0.10, 0.20};
+    const double bursts[] = {1, 3};
+    bool isPassed = true;
+
+    printf("%-6s %-5s %-5s %9s %9s %9s %10s %9s %11s\n", "loss", "burst", "group",
+           "overhead", "lost", "recovered", "residual", "frames", "repaired");
+    for(double burst: bursts)
+    {
+        for(double loss: losses)
+        {
+            auto cache = std::make_shared<FecCache>();
+            UlpfecEncoder first(cache), second(cache);
+            first.setPayloadTypes(UlpfecEncoder::defaultRedPayloadType,
+                                  UlpfecEncoder::defaultFecPayloadType);
+            second.setPayloadTypes(UlpfecEncoder::defaultRedPayloadType,
+                                   UlpfecEncoder::defaultFecPayloadType);
+            // like a receiver report which tells this loss
+            first.setLossFraction(loss);
+            second.setLossFraction(loss);
+
+            Channel channel(loss, burst);
+            Result result;
+            std::mt19937 random(1), copy(1);
+            for(unsigned int i = 0; i < frames; i++)
+            {
+                size_t bytes = i % idrInterval == 0 ? idrBytes : pBytes;
+                uint32_t timestamp = i * 90000 / fps;
+                auto sent = std::make_shared<Frame>(packetize(bytes, timestamp, random, 1));
+                // the same payloads with another extension for the other track
+                auto other = std::make_shared<Frame>(packetize(bytes, timestamp, copy, 2));
+                first.setFrame(i + 1);
+                second.setFrame(i + 1);
+                sent = first.processOutgoingBinaryMessage(sent, nullptr).messages;
+                other = second.processOutgoingBinaryMessage(other, nullptr).messages;
+                receive(*(i % 2 ? other : sent), channel, result);
+            }
+
+            double residual = result.media > 0
+                              ? double(result.lost - result.recovered) / result.media : 0;
+            printf("%4.0f %% %5.0f %5u %8.1f %% %8.2f %% %8.1f %% %8.2f %% %9zu %10.1f %%\n",
+                   loss * 100, burst, first.getGroupSize(),
+                   100.0 * result.fec / result.media,
+                   100.0 * result.lost / result.media,
+                   result.lost > 0 ? 100.0 * result.recovered / result.lost : 0.0,
+                   100.0 * residual, result.damagedFrames,
+                   result.damagedFrames > 0
+                   ? 100.0 * result.repairedFrames / result.damagedFrames : 0.0);
+            if(result.wrong > 0)
+            {
+                printf("  %zu packets were recovered wrong\n", result.wrong);
+                isPassed = false;
+            }
+        }
+    }
+    printf("%s\n", isPassed ? "passed" : "FAILED");
+    return isPassed ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file test_framebus.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief publish samples on the frame bus to a fast and a slow reader,
+ * the fast one must get every sample intact, the slow one may only lose
+ * its own samples and must never see a torn one.
+ *
+ * usage: test_framebus [samples]
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "framebus.hpp"
+#include "utility.h"
+
+const std::string busPath = "/tmp/test_framebus.sock";
+
+/* the bytes of sample n are n + i, so a torn sample can be seen */
+bool checkSample(const FrameBusReader::Sample& sample)
+{
+    for(size_t i = 0; i < sample.size; i++)
+    {
+        if(sample.data[i] != uint8_t(sample.time_us + i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+    FrameBus bus(busPath, 256 * 1024, 64);
+    FrameBusReader fast(busPath);
+    FrameBusReader slow(busPath);
+    std::atomic<bool> isDone{false};
+    std::atomic<int> fastReceived{0}, slowReceived{0}, torn{0};
+
+    // the server has to register the clients before the first sample
+    while(bus.getClientCount() < 2)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto reader = [&](FrameBusReader& reader, std::atomic<int>& received, int delay_us)
+    {
+        FrameBusReader::Sample sample;
+        while(!isDone || reader.next(sample))
+        {
+            reader.wait(10);
+            while(reader.next(sample))
+            {
+                if(delay_us > 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+                }
+                // a torn sample is only a failure if the reader thinks it is valid
+                bool intact = checkSample(sample);
+                if(reader.isValid(sample))
+                {
+                    received++;
+                    if(!intact)
+                    {
+                        torn++;
+                    }
+                }
+            }
+        }
+    };
+    std::thread fastThread(reader, std::ref(fast), std::ref(fastReceived), 0);
+    std::thread slowThread(reader, std::ref(slow), std::ref(slowReceived), 2000);
+
+    std::vector<uint8_t> sample(16 * 1024);
+    for(int n = 0; n < count; n++)
+    {
+        size_t len = 1024 + (n * 7919) % (sample.size() - 1024);
+        for(size_t i = 0; i < len; i++)
+        {
+            sample[i] = uint8_t(n + i);
+        }
+        bus.publish(sample.data(), len, n, n % 30 == 0 ? FrameBusKeyFrame : 0);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    isDone = true;
+    fastThread.join();
+    slowThread.join();
+
+    printf("fast reader: %d of %d, lost %lu\n", fastReceived.load(), count,
+        (unsigned long)fast.getLost());
+    printf("slow reader: %d of %d, lost %lu\n", slowReceived.load(), count,
+        (unsigned long)slow.getLost());
+    printf("torn samples: %d\n", torn.load());
+
+    bool ok = fastReceived == count && fast.getLost() == 0 && torn == 0
+              && slowReceived + slow.getLost() <= uint64_t(count);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
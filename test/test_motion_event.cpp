@@ -0,0 +1,90 @@
+/**
+ * @file test_motion_event.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief a still scene of small P frames, a burst of large ones and the
+ * still scene again must start and stop one motion. The event handler asks
+ * the detector for its statistics like the MQTT event of the camera, it
+ * must not block the capture thread.
+ *
+ * usage: test_motion_event
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "motion.hpp"
+
+constexpr unsigned int fps = 30;
+constexpr size_t stillBytes = 1000;
+constexpr size_t motionBytes = 6000;
+
+/* a P slice with first_mb_in_slice 0, slice_type P and PPS 0 */
+NALUnit pFrame(size_t bytes)
+{
+    NALUnit sample(4 + bytes, std::byte(0xaa));
+    sample[0] = std::byte(0x00);
+    sample[1] = std::byte(0x00);
+    sample[2] = std::byte(0x00);
+    sample[3] = std::byte(0x01);
+    sample[4] = std::byte(0x41);
+    sample[5] = std::byte(0xe0);
+    return sample;
+}
+
+int main()
+{
+    MotionDetector detector;
+    std::vector<std::string> events;
+    detector.onEvent = [&detector, &events](bool start, double score, uint64_t time_us)
+    {
+        // the camera publishes the statistics with the event
+        events.push_back(std::string(start ? "start " : "stop ") + detector.getStatistics());
+    };
+
+    auto feeding = std::async(std::launch::async,
+        [&detector]()
+        {
+            uint64_t time_us = 0;
+            auto feed = [&](size_t bytes, unsigned int count)
+            {
+                for(unsigned int i = 0; i < count; i++)
+                {
+                    time_us += 1000000 / fps;
+                    detector.onSample(pFrame(bytes), time_us);
+                }
+            };
+            feed(stillBytes, 2 * fps);
+            feed(motionBytes, fps);
+            feed(stillBytes, 4 * fps);
+            // the last frame ends with the next one
+            feed(stillBytes, 1);
+        }
+    );
+    if(feeding.wait_for(std::chrono::seconds(10)) != std::future_status::ready)
+    {
+        printf("the capture thread is blocked in the event handler\nFAILED\n");
+        fflush(stdout);
+        _Exit(EXIT_FAILURE);
+    }
+
+    for(auto& event: events)
+    {
+        printf("%s\n", event.c_str());
+    }
+    bool isPassed = events.size() == 2 && events[0].compare(0, 6, "start ") == 0
+                    && events[1].compare(0, 5, "stop ") == 0;
+    printf("%s\n", isPassed ? "passed" : "FAILED");
+    return isPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file test_mqtt_reconnect.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief stop a local broker, publish more messages during the outage than
+ * may be pending while connected, start the broker again and measure how
+ * long it takes until the signaling works again. The messages sent during
+ * the outage must not be lost.
+ *
+ * usage: test_mqtt_reconnect url "stop command" "start command" [rounds]
+ * for example: test_mqtt_reconnect tcp://127.0.0.1:1883 "systemctl stop mosquitto"
+ *              "systemctl start mosquitto" 5
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "mqtt_connect.hpp"
+#include "utility.h"
+
+using namespace std::chrono;
+
+const std::string echoTopic = "test/reconnect/echo";
+constexpr size_t maxPending = 64;
+constexpr size_t maxBuffered = 256;
+/* more than may be pending, all of them fit in the buffer */
+constexpr unsigned int outageMessages = 100;
+
+int main(int argc, char *argv[])
+{
+    if(argc < 4)
+    {
+        ERROR_MESSAGE("usage: %s url \"stop command\" \"start command\" [rounds]", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int rounds = argc > 4 ? atoi(argv[4]) : 3;
+    std::atomic<unsigned int> receivedAfterLost{0};
+    std::atomic<unsigned int> delivered{0};
+    std::atomic<unsigned int> dropped{0};
+    std::atomic<bool> lost{false};
+    int failed = 0;
+
+    auto conn = std::make_shared<MqttConnect>(argv[1], "reconnect-test", "", "",
+                                              maxPending, maxBuffered);
+    conn->setDefaultQos(1);
+    conn->onMessage = [&](std::string topic, std::string msg)
+    {
+        if(lost)
+        {
+            receivedAfterLost++;
+        }
+    };
+    conn->onConnection = [&lost](bool connected)
+    {
+        if(!connected)
+        {
+            lost = true;
+        }
+    };
+    conn->subscribeTopic(echoTopic);
+    auto onDelivered = [&](bool ok)
+    {
+        ok ? delivered++ : dropped++;
+    };
+
+    for(int i = 0; i < rounds; i++)
+    {
+        unsigned int sent = 0;
+        lost = false;
+        receivedAfterLost = 0;
+        delivered = 0;
+        dropped = 0;
+
+        if(system(argv[2]) != 0)
+        {
+            ERROR_MESSAGE("cannot run '%s'.", argv[2]);
+            return EXIT_FAILURE;
+        }
+        auto deadline = steady_clock::now() + seconds(30);
+        while(steady_clock::now() < deadline && !lost)
+        {
+            std::this_thread::sleep_for(milliseconds(50));
+        }
+
+        // they are buffered by paho, not limited by the pending messages
+        for(; sent < outageMessages; sent++)
+        {
+            conn->publishMessage(echoTopic, std::to_string(sent), onDelivered);
+        }
+
+        auto start = steady_clock::now();
+        if(system(argv[3]) != 0)
+        {
+            ERROR_MESSAGE("cannot run '%s'.", argv[3]);
+            return EXIT_FAILURE;
+        }
+
+        // keep signaling until the echo comes back
+        deadline = start + seconds(60);
+        while(steady_clock::now() < deadline && receivedAfterLost == 0)
+        {
+            sent++;
+            conn->publishMessage(echoTopic, std::to_string(sent), onDelivered);
+            std::this_thread::sleep_for(milliseconds(50));
+        }
+        auto recovery = duration_cast<milliseconds>(steady_clock::now() - start);
+
+        // wait for the results of the buffered messages
+        while(steady_clock::now() < deadline && delivered + dropped < sent)
+        {
+            std::this_thread::sleep_for(milliseconds(50));
+        }
+
+        if(!lost || receivedAfterLost == 0 || dropped > 0 || delivered < sent)
+        {
+            failed++;
+        }
+        printf("round %d: connection %s, signaling recovered after %lld ms, "
+               "%u sent (%u in the outage), %u delivered, %u dropped\n",
+               i, lost ? "lost" : "not lost", (long long)recovery.count(),
+               sent, outageMessages, delivered.load(), dropped.load());
+    }
+
+    return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file test_nack_store.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief send one second of a camera stream to 1 to 100 tracks, each with
+ * its own RTP header and extension, through SharedNackResponder with one
+ * RetransmissionStore. The heap which the history holds is compared with
+ * a copy of every packet per track, like rtc::RtcpNackResponder keeps.
+ * Every packet is requested by a NACK and compared with the sent one.
+ *
+ * usage: test_nack_store
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "retransmission.hpp"
+
+constexpr size_t payloadSize = 1200;
+constexpr unsigned int fps = 30;
+constexpr size_t idrBytes = 150 * 1000;
+constexpr size_t pBytes = 8 * 1000;
+constexpr size_t extensionSize = 12;
+
+/* the heap in use, the history is measured by it */
+static std::atomic<int64_t> heapBytes{0};
+
+void *operator new(size_t size)
+{
+    auto block = static_cast<size_t *>(malloc(size + sizeof(size_t)));
+    if(!block)
+    {
+        throw std::bad_alloc();
+    }
+    *block = size;
+    heapBytes += size;
+    return block + 1;
+}
+
+void operator delete(void *p) noexcept
+{
+    if(p)
+    {
+        auto block = static_cast<size_t *>(p) - 1;
+        heapBytes -= *block;
+        free(block);
+    }
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+/* the packets of a frame for a track, the first one has an extension */
+std::vector<rtc::binary> packetize(size_t bytes, unsigned int frame, uint16_t& sequence,
+                                   uint8_t track)
+{
+    std::vector<rtc::binary> packets;
+    std::mt19937 random(frame);
+    uint32_t timestamp = frame * 90000 / fps + track * 1000;
+    size_t count = (bytes + payloadSize - 1) / payloadSize;
+    for(size_t i = 0; i < count; i++)
+    {
+        size_t size = i + 1 < count ? payloadSize : bytes - i * payloadSize;
+        bool hasExtension = i == 0;
+        rtc::binary packet(12 + (hasExtension ? extensionSize : 0) + size);
+        packet[0] = std::byte(hasExtension ? 0x90 : 0x80);
+        packet[1] = std::byte((i + 1 == count ? 0x80 : 0x00) | 100);
+        packet[2] = std::byte(sequence >> 8);
+        packet[3] = std::byte(sequence & 0xff);
+        sequence++;
+        for(int b = 0; b < 4; b++)
+        {
+            packet[4 + b] = std::byte(timestamp >> (24 - 8 * b));
+            packet[8 + b] = std::byte(b == 3 ? track : 0);
+        }
+        size_t pos = 12;
+        if(hasExtension)
+        {
+            uint8_t extension[extensionSize] = {0xbe, 0xde, 0x00, 0x02, 0x67, track};
+            for(size_t b = 0; b < extensionSize; b++)
+            {
+                packet[pos++] = std::byte(extension[b]);
+            }
+        }
+        for(; pos < packet.size(); pos++)
+        {
+            packet[pos] = std::byte(random() & 0xff);
+        }
+        packets.push_back(std::move(packet));
+    }
+    return packets;
+}
+
+rtc::message_ptr makeNack(uint16_t sequence)
+{
+    // RTPFB, FMT 1, one FCI entry without BLP bits
+    auto nack = rtc::make_message(16, rtc::Message::Control);
+    uint8_t header[16] = {0x81, 205, 0, 3, 0, 0, 0, 1, 0, 0, 0, 1,
+                          uint8_t(sequence >> 8), uint8_t(sequence & 0xff), 0, 0};
+    for(size_t i = 0; i < sizeof(header); i++)
+    {
+        (*nack)[i] = std::byte(header[i]);
+    }
+    return nack;
+}
+
+int main()
+{
+    const unsigned int viewerCounts[] = {1, 10, 50, 100};
+    bool isPassed = true;
+    int64_t firstHistory = 0;
+
+    printf("%7s %12s %12s %20s %9s\n", "viewers", "history MB", "copies MB",
+           "per more viewer kB", "requests");
+    for(unsigned int viewers: viewerCounts)
+    {
+        size_t copies = 0;
+        size_t requests = 0;
+        std::vector<std::vector<rtc::binary>> sent(viewers);
+        {
+            auto store = std::make_shared<RetransmissionStore>();
+            std::vector<std::shared_ptr<SharedNackResponder>> responders;
+            std::vector<uint16_t> sequences;
+            for(unsigned int v = 0; v < viewers; v++)
+            {
+                responders.push_back(std::make_shared<SharedNackResponder>(store));
+                sequences.push_back(uint16_t(v * 977));
+            }
+            int64_t history = 0;
+            for(unsigned int frame = 0; frame < fps; frame++)
+            {
+                size_t bytes = frame == 0 ? idrBytes : pBytes;
+                for(unsigned int v = 0; v < viewers; v++)
+                {
+                    auto packets = std::make_shared<std::vector<rtc::binary>>(
+                        packetize(bytes, frame, sequences[v], uint8_t(v + 1)));
+                    for(auto& packet: *packets)
+                    {
+                        copies += packet.size();
+                        sent[v].push_back(packet);
+                    }
+                    responders[v]->setFrame(frame + 1);
+                    // the heap of the history only, not of the sent packets
+                    int64_t heap = heapBytes;
+                    responders[v]->processOutgoingBinaryMessage(packets, nullptr);
+                    history += heapBytes - heap;
+                }
+            }
+
+            for(unsigned int v = 0; v < viewers; v++)
+            {
+                for(auto& packet: sent[v])
+                {
+                    uint16_t sequence = uint16_t((uint8_t(packet[2]) << 8) | uint8_t(packet[3]));
+                    auto product = responders[v]->processIncomingControlMessage(makeNack(sequence));
+                    requests++;
+                    if(!product.outgoing || product.outgoing->messages->size() != 1
+                       || product.outgoing->messages->front() != packet)
+                    {
+                        isPassed = false;
+                    }
+                }
+            }
+            firstHistory = viewers == 1 ? history : firstHistory;
+            printf("%7u %12.2f %12.2f %20.1f %9zu\n", viewers, history / 1e6, copies / 1e6,
+                   viewers > 1 ? (history - firstHistory) / 1e3 / (viewers - 1) : 0.0,
+                   requests);
+        }
+    }
+    printf("%s\n", isPassed ? "passed" : "FAILED");
+    return isPassed ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file test_roap_glare.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief the re-offer state machine of OfferSession without a broker: an
+ * established session sends a re-offer and the viewer sends its own offer
+ * at the same time. The larger tie breaker wins, equal ones are a double
+ * conflict which is offered again later. A re-offer which is not delivered
+ * is sent again up to maxOfferRetries times.
+ *
+ * MqttConnect is replaced by this file, the messages are kept in a list.
+ * build: g++ -std=c++17 -Isrc test/test_roap_glare.cpp src/roaprotocol.cpp
+ *
+ * usage: test_roap_glare
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "roaprotocol.hpp"
+#include "check.hpp"
+
+/* the published messages, and whether the broker takes them */
+static std::vector<ROAPMessage> published;
+static bool isDelivered = true;
+
+MqttConnect::MqttConnect(const std::string& url, const std::string& clientId,
+                         const std::string& username, const std::string& password,
+                         size_t maxPending, size_t maxBuffered):
+isConnected(true), isFailed(false), isLost(false), defaultQos(0),
+maxPendingMessages(maxPending), pendingMessages(0)
+{}
+
+MqttConnect::~MqttConnect()
+{}
+
+int MqttConnect::publishMessage(std::string topic, std::string message,
+                                onDeliveredCallback onDelivered) noexcept
+{
+    ROAPMessage out;
+    out.parser(message);
+    published.push_back(out);
+    if(onDelivered)
+    {
+        onDelivered(isDelivered);
+    }
+    return 0;
+}
+
+static ROAPMessage message(ROAPMessageType type, uint32_t seq, uint32_t tieBreaker=0)
+{
+    ROAPMessage in;
+    in.messageType = type;
+    in.offererSessionId = "camera";
+    in.answererSessionId = "viewer";
+    in.seq = seq;
+    in.tieBreaker = tieBreaker;
+    if(type == ROAPMessageType::Offer || type == ROAPMessageType::Answer)
+    {
+        in.sdp = "v=0\r\n";
+    }
+    return in;
+}
+
+static ROAPMessage error(ROAPMessageErrorType type, uint32_t seq)
+{
+    auto in = message(ROAPMessageType::Error, seq);
+    in.errorType = type;
+    return in;
+}
+
+/**
+ * @brief a session after the first offer and answer, the next seq is 2
+ */
+struct Peer
+{
+    OfferSession session;
+    unsigned int rollbacks = 0;
+    unsigned int remoteOffers = 0;
+
+    Peer(const std::shared_ptr<MqttConnect>& conn):
+    session("camera", conn)
+    {
+        session.onRemoteSDP = [](std::string sdp){};
+        session.onRemoteOffer = [this](std::string sdp)
+        {
+            remoteOffers++;
+            session.sendAnswer("v=0\r\n");
+        };
+        session.onRollback = [this](){ rollbacks++; };
+        session.onClose = [](){};
+        session.sendOffer("v=0\r\n");
+        auto answer = message(ROAPMessageType::Answer, 1);
+        session.processMessage(answer);
+    }
+
+    /* the tie breaker of the last offer */
+    uint32_t reoffer()
+    {
+        session.sendOffer("v=0\r\n");
+        return published.back().tieBreaker;
+    }
+};
+
+int main()
+{
+    auto conn = std::make_shared<MqttConnect>("tcp://127.0.0.1:1883", "test", "", "");
+
+    printf("established\n");
+    {
+        Peer peer(conn);
+        check(peer.session.isEstablished(), "the first exchange is completed");
+        check(published.back().messageType == ROAPMessageType::Ok, "the answer is acknowledged");
+    }
+
+    printf("glare, the viewer wins\n");
+    {
+        Peer peer(conn);
+        uint32_t tieBreaker = peer.reoffer();
+        while(tieBreaker == UINT32_MAX)
+        {
+            tieBreaker = peer.reoffer();
+        }
+        auto offer = message(ROAPMessageType::Offer, 2, tieBreaker + 1);
+        peer.session.processMessage(offer);
+        check(peer.rollbacks == 1 && peer.remoteOffers == 1,
+              "the local offer is rolled back, the remote one is answered");
+        check(published.back().messageType == ROAPMessageType::Answer,
+              "the answer is sent");
+        auto ok = message(ROAPMessageType::Ok, 2);
+        peer.session.processMessage(ok);
+        check(peer.session.getState() == ROAPSessionState::Completed
+              && !peer.session.needRenegotiation(), "completed, nothing to offer again");
+    }
+
+    printf("glare, the camera wins\n");
+    {
+        Peer peer(conn);
+        uint32_t tieBreaker = peer.reoffer();
+        auto offer = message(ROAPMessageType::Offer, 2, tieBreaker - 1);
+        peer.session.processMessage(offer);
+        check(published.back().messageType == ROAPMessageType::Error
+              && published.back().errorType == ROAPMessageErrorType::Conflict,
+              "the remote offer gets CONFLICT");
+        check(peer.rollbacks == 0 && peer.session.getState() == ROAPSessionState::WaitAnswer,
+              "the local offer waits for its answer");
+        auto answer = message(ROAPMessageType::Answer, 2);
+        peer.session.processMessage(answer);
+        check(peer.session.getState() == ROAPSessionState::Completed, "the re-offer is answered");
+    }
+
+    printf("glare, the viewer has won\n");
+    {
+        Peer peer(conn);
+        peer.reoffer();
+        auto conflict = error(ROAPMessageErrorType::Conflict, 2);
+        peer.session.processMessage(conflict);
+        check(peer.rollbacks == 1 && peer.session.getState() == ROAPSessionState::Completed
+              && !peer.session.needRenegotiation(),
+              "CONFLICT rolls back, the viewer's offer comes");
+        auto offer = message(ROAPMessageType::Offer, 3, 1);
+        peer.session.processMessage(offer);
+        check(peer.remoteOffers == 1, "the viewer's offer is answered");
+    }
+
+    printf("double conflict\n");
+    {
+        Peer peer(conn);
+        uint32_t tieBreaker = peer.reoffer();
+        auto offer = message(ROAPMessageType::Offer, 2, tieBreaker);
+        peer.session.processMessage(offer);
+        check(published.back().messageType == ROAPMessageType::Error
+              && published.back().errorType == ROAPMessageErrorType::DoubleConflict,
+              "equal tie breakers get DOUBLECONFLICT");
+        check(peer.rollbacks == 1 && peer.session.needRenegotiation(),
+              "the local offer is rolled back and offered again later");
+        uint32_t next = peer.reoffer();
+        check(!peer.session.needRenegotiation() && next != 0,
+              "the new offer has a new tie breaker");
+    }
+
+    printf("lost re-offer\n");
+    {
+        Peer peer(conn);
+        isDelivered = false;
+        size_t before = published.size();
+        uint32_t tieBreaker = peer.reoffer();
+        unsigned int retries = 0;
+        while(peer.session.retryLostOffer())
+        {
+            retries++;
+            if(retries > OfferSession::maxOfferRetries)
+            {
+                break;
+            }
+        }
+        bool isSame = true;
+        for(size_t i = before; i < published.size(); i++)
+        {
+            isSame = isSame && published[i].messageType == ROAPMessageType::Offer
+                     && published[i].seq == 2 && published[i].tieBreaker == tieBreaker;
+        }
+        check(published.size() - before == 1 + OfferSession::maxOfferRetries && isSame,
+              "the same offer is sent again up to maxOfferRetries");
+        check(retries == OfferSession::maxOfferRetries, "then the session gives up");
+
+        isDelivered = true;
+        Peer second(conn);
+        isDelivered = false;
+        second.reoffer();
+        isDelivered = true;
+        before = published.size();
+        second.session.retryLostOffer();
+        second.session.retryLostOffer();
+        check(published.size() - before == 1, "a delivered retry is not sent again");
+        auto answer = message(ROAPMessageType::Answer, 2);
+        second.session.processMessage(answer);
+        check(second.session.getState() == ROAPSessionState::Completed,
+              "the retried offer is answered");
+    }
+
+    return checkResult();
+}
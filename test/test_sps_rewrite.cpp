@@ -0,0 +1,162 @@
+/**
+ * @file test_sps_rewrite.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief rewrite the SPSes of real cameras and encoders for an output
+ * without delay. The rewritten SPS must describe the same stream, have a
+ * bitstream_restriction without reordering and be rewritten to itself
+ * again. An SPS which declares reordering (B-frames) in its
+ * bitstream_restriction must be left unchanged. For every SPS the output
+ * delay of a decoder is printed: without
+ * bitstream_restriction a decoder may hold as many frames as its DPB
+ * has (A.3.1, C.4.5.3), with it max_num_reorder_frames.
+ *
+ * usage: test_sps_rewrite [fps]
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "h264_bitstream.hpp"
+
+struct Sample
+{
+    const char *name;
+    std::vector<uint8_t> sps;
+};
+
+/* from the sprop-parameter-sets of cameras and the avcC of files */
+const Sample corpus[] = {
+    {"IP camera, baseline",
+     {0x67, 0x42, 0x00, 0x29, 0xe2, 0x90, 0x14, 0x07, 0xb6, 0x02, 0xdc, 0x04,
+      0x04, 0x06, 0x90, 0x78, 0x91, 0x15}},
+    {"IP camera, main 1080p",
+     {0x67, 0x4d, 0x00, 0x2a, 0x9d, 0xa8, 0x1e, 0x00, 0x89, 0xf9, 0x66, 0xe0,
+      0x20, 0x20, 0x20, 0x40}},
+    {"IP camera, baseline substream",
+     {0x67, 0x42, 0x00, 0x1f, 0x95, 0xa8, 0x14, 0x01, 0x6e, 0x40}},
+    {"x264, high 720p",
+     {0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xba, 0x10, 0x00,
+      0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0x28, 0xf1, 0x83, 0x19,
+      0x60}},
+    {"x264, constrained baseline 720p",
+     {0x67, 0x42, 0xc0, 0x1e, 0xd9, 0x00, 0x50, 0x05, 0xbb, 0x01, 0x10, 0x00,
+      0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0xc8, 0xf1, 0x62, 0xe4,
+      0x80}},
+    {"x264, high 4K",
+     {0x67, 0x64, 0x00, 0x33, 0xac, 0x2c, 0xa4, 0x00, 0xf0, 0x01, 0x0f, 0xb0,
+      0x16, 0xa0, 0x20, 0x20, 0x28, 0x00, 0x00, 0x1f, 0x48, 0x00, 0x07, 0x53,
+      0x04, 0xed, 0x0b, 0x16, 0x89}},
+};
+
+/* MaxDpbMbs of Table A-1 by level_idc */
+uint32_t maxDpbMbsOf(uint8_t levelIdc)
+{
+    switch(levelIdc)
+    {
+        case 9: case 10: return 396;
+        case 11: return 900;
+        case 12: case 13: case 20: return 2376;
+        case 21: return 4752;
+        case 22: case 30: return 8100;
+        case 31: return 18000;
+        case 32: return 20480;
+        case 40: case 41: return 32768;
+        case 42: return 34816;
+        case 50: return 110400;
+        default: return 184320;
+    }
+}
+
+/* the frames a decoder may hold before it outputs the first one */
+uint32_t outputDelayOf(const H264Sps& sps)
+{
+    if(sps.hasBitstreamRestriction)
+    {
+        return sps.maxNumReorderFrames;
+    }
+    uint32_t mbs = ((sps.width + 15) / 16) * ((sps.height + 15) / 16);
+    return std::min<uint32_t>(maxDpbMbsOf(sps.levelIdc) / std::max<uint32_t>(mbs, 1), 16);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int fps = argc > 1 ? atoi(argv[1]) : 30;
+    int failed = 0;
+
+    for(auto& sample: corpus)
+    {
+        H264Sps before, after;
+        std::vector<uint8_t> rewritten, again;
+        if(!ParseSps(sample.sps.data(), sample.sps.size(), before)
+           || !RewriteSpsForLowDelay(sample.sps.data(), sample.sps.size(), fps, rewritten)
+           || !ParseSps(rewritten.data(), rewritten.size(), after)
+           || !RewriteSpsForLowDelay(rewritten.data(), rewritten.size(), fps, again))
+        {
+            printf("FAIL %s: cannot parse or rewrite\n", sample.name);
+            failed++;
+            continue;
+        }
+
+        bool isSame = before.profileIdc == after.profileIdc
+                      && before.levelIdc == after.levelIdc
+                      && before.width == after.width && before.height == after.height
+                      && before.maxNumRefFrames == after.maxNumRefFrames
+                      && before.timeScale == (before.hasTimingInfo ? after.timeScale : 0);
+        // the frames of a stream with B-frames come out of order
+        if(before.hasBitstreamRestriction && before.maxNumReorderFrames > 0)
+        {
+            bool isKept = rewritten == sample.sps && again == rewritten;
+            printf("%s %-32s %4ux%-4u output delay %2u frames, reordering is kept\n",
+                isKept ? "ok  " : "FAIL", sample.name, before.width, before.height,
+                outputDelayOf(before));
+            failed += !isKept;
+            continue;
+        }
+        bool isLowDelay = after.hasVui && after.hasTimingInfo
+                          && after.hasBitstreamRestriction
+                          && after.maxNumReorderFrames == 0
+                          && after.maxDecFrameBuffering >= 1
+                          && after.maxDecFrameBuffering >= after.maxNumRefFrames;
+        // a second rewrite must copy every field unchanged
+        bool isStable = again == rewritten;
+        if(!isSame || !isLowDelay || !isStable)
+        {
+            printf("FAIL %s: same %d, low delay %d, stable %d\n",
+                sample.name, isSame, isLowDelay, isStable);
+            failed++;
+            continue;
+        }
+
+        uint32_t delayBefore = outputDelayOf(before), delayAfter = outputDelayOf(after);
+        printf("ok   %-32s %4ux%-4u %2zu -> %2zu bytes, output delay %2u -> %u frames"
+               " (%.0f -> %.0f ms)\n",
+            sample.name, before.width, before.height, sample.sps.size(), rewritten.size(),
+            delayBefore, delayAfter, delayBefore * 1000.0 / fps, delayAfter * 1000.0 / fps);
+    }
+
+    // the stream rewrites an SPS once, this is what a cache miss costs
+    auto start = std::chrono::steady_clock::now();
+    const int rounds = 100000;
+    std::vector<uint8_t> out;
+    for(int i = 0; i < rounds; i++)
+    {
+        auto& sample = corpus[i % (sizeof(corpus) / sizeof(corpus[0]))];
+        RewriteSpsForLowDelay(sample.sps.data(), sample.sps.size(), fps, out);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    printf("rewrite: %.2f us per SPS\n", elapsed.count() / rounds);
+
+    printf("%s: %d of %zu SPS failed\n", failed ? "FAILED" : "PASSED", failed,
+        sizeof(corpus) / sizeof(corpus[0]));
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
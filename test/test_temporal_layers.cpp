@@ -0,0 +1,150 @@
+/**
+ * @file test_temporal_layers.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief a hierarchical-P stream with 3 temporal layers and an IPPP stream
+ * with every second frame not referenced (2 layers) are sent to viewers
+ * with different bandwidth estimates (from a REMB). The frame rate of each
+ * viewer is reported, and every frame which a viewer gets must have its
+ * reference.
+ *
+ * usage: test_temporal_layers
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "rate_control.hpp"
+
+constexpr unsigned int fps = 30;
+constexpr unsigned int seconds = 20;
+constexpr unsigned int idrInterval = 2 * fps;
+constexpr size_t idrBytes = 60 * 1000;
+constexpr size_t layerBytes[maxTemporalLayers] = {12 * 1000, 8 * 1000, 5 * 1000};
+
+struct Frame
+{
+    bool isIdr;
+    bool isReference;
+    /* the frame which it refers to, -1 for an IDR */
+    int reference;
+    size_t bytes;
+};
+
+/* 0 2 1 2: the top layer is not referenced, the middle refers to the base */
+std::vector<Frame> hierarchicalP()
+{
+    std::vector<Frame> frames;
+    int base = -1, previous = -1;
+    for(unsigned int i = 0; i < seconds * fps; i++)
+    {
+        unsigned int phase = i % 4;
+        Frame frame{i % idrInterval == 0, phase != 1 && phase != 3, 0, 0};
+        unsigned int layer = phase == 0 ? 0 : phase == 2 ? 1 : 2;
+        frame.reference = frame.isIdr ? -1 : layer == 2 ? previous : base;
+        frame.bytes = frame.isIdr ? idrBytes : layerBytes[layer];
+        frames.push_back(frame);
+        if(layer == 0)
+        {
+            base = int(i);
+        }
+        previous = int(i);
+    }
+    return frames;
+}
+
+/* every second frame is not referenced, the others refer to the last one */
+std::vector<Frame> nonReferenceMarked()
+{
+    std::vector<Frame> frames;
+    int last = -1;
+    for(unsigned int i = 0; i < seconds * fps; i++)
+    {
+        Frame frame{i % idrInterval == 0, i % 2 == 0, 0, 0};
+        frame.reference = frame.isIdr ? -1 : last;
+        frame.bytes = frame.isIdr ? idrBytes : frame.isReference ? layerBytes[0] : layerBytes[2];
+        frames.push_back(frame);
+        if(frame.isReference)
+        {
+            last = int(i);
+        }
+    }
+    return frames;
+}
+
+rtc::message_ptr makeRemb(uint32_t bitrate_bps)
+{
+    uint8_t exponent = 0;
+    while((bitrate_bps >> exponent) > 0x3ffff)
+    {
+        exponent++;
+    }
+    uint32_t mantissa = bitrate_bps >> exponent;
+    uint8_t remb[24] = {0x8f, 206, 0, 5, 0, 0, 0, 1, 0, 0, 0, 0, 'R', 'E', 'M', 'B', 1,
+                        uint8_t((exponent << 2) | (mantissa >> 16)),
+                        uint8_t(mantissa >> 8), uint8_t(mantissa), 0, 0, 0, 1};
+    auto message = rtc::make_message(sizeof(remb), rtc::Message::Control);
+    for(size_t i = 0; i < sizeof(remb); i++)
+    {
+        (*message)[i] = std::byte(remb[i]);
+    }
+    return message;
+}
+
+bool run(const char *name, const std::vector<Frame>& frames, unsigned int layers)
+{
+    const uint32_t estimates_bps[] = {3000000, 2000000, 1000000};
+    bool isPassed = true;
+    printf("%s, %u layers\n", name, layers);
+    for(uint32_t estimate: estimates_bps)
+    {
+        BandwidthEstimator estimator;
+        estimator.processIncomingControlMessage(makeRemb(estimate));
+        TemporalLayerTracker tracker(layers);
+        TemporalLayerSelector selector;
+        LayerRates rates{};
+        std::array<uint64_t, maxTemporalLayers> bytes{};
+        std::vector<bool> isSent(frames.size());
+        size_t sent = 0, broken = 0;
+        for(size_t i = 0; i < frames.size(); i++)
+        {
+            auto& frame = frames[i];
+            unsigned int layer = tracker.next(frame.isIdr, frame.isReference);
+            bytes[layer] += frame.bytes;
+            if(i % fps == fps - 1)
+            {
+                for(unsigned int l = 0; l < maxTemporalLayers; l++)
+                {
+                    rates[l] = bytes[l] * 8.0;
+                    bytes[l] = 0;
+                }
+            }
+            if(selector.drops(layer, estimator.getEstimate_bps(), rates))
+            {
+                continue;
+            }
+            isSent[i] = true;
+            sent++;
+            broken += frame.reference >= 0 && !isSent[frame.reference];
+        }
+        printf("  estimate %4.1f Mbit/s: %5.1f fps, %zu frames without reference\n",
+               estimator.getEstimate_bps() / 1e6, double(sent) / seconds, broken);
+        isPassed = isPassed && broken == 0;
+    }
+    return isPassed;
+}
+
+int main()
+{
+    bool isPassed = run("hierarchical-P", hierarchicalP(), 3);
+    // an encoder without hierarchical-P, only the non-reference frames are dropped
+    isPassed = run("non-reference frames", nonReferenceMarked(), 2) && isPassed;
+    printf("%s\n", isPassed ? "passed" : "FAILED");
+    return isPassed ? 0 : 1;
+}
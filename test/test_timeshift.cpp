@@ -0,0 +1,138 @@
+/**
+ * @file test_timeshift.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief a time shift buffer is fed with access units of several NAL units
+ * like the encoder sends them: AUD, SPS, PPS and the IDR slice in one
+ * sample, AUD and a P slice in the others. After the arena has wrapped a
+ * few times, a seek must return the last IDR at or before the time and the
+ * samples in the buffer must fit into the arena and the unit ring.
+ *
+ * build: g++ -std=c++17 -Isrc test/test_timeshift.cpp src/timeshift.cpp
+ *        src/h264_bitstream.cpp src/streamer.cpp -ldatachannel -pthread
+ *
+ * usage: test_timeshift
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <map>
+#include <vector>
+
+#include "timeshift.hpp"
+#include "check.hpp"
+
+constexpr unsigned int fps = 30;
+constexpr unsigned int seconds = 60;
+constexpr unsigned int idrInterval = 2 * fps;
+constexpr size_t idrBytes = 20 * 1000;
+constexpr size_t pBytes = 2 * 1000;
+constexpr size_t arenaBytes = 512 * 1000;
+constexpr size_t maxUnits = 8 * fps;
+
+static void appendNal(NALUnit& sample, std::initializer_list<uint8_t> nal, size_t payload,
+                      uint8_t fill)
+{
+    for(uint8_t byte: {0x00, 0x00, 0x00, 0x01})
+    {
+        sample.push_back(std::byte(byte));
+    }
+    for(uint8_t byte: nal)
+    {
+        sample.push_back(std::byte(byte));
+    }
+    sample.insert(sample.end(), payload, std::byte(fill));
+}
+
+/* the slice is filled with the frame number, so the samples differ */
+static NALUnit accessUnit(unsigned int frame, bool isIdr)
+{
+    NALUnit sample;
+    uint8_t fill = 0x80 | (frame & 0x7f);
+    appendNal(sample, {0x09, 0xf0}, 0, 0);
+    if(isIdr)
+    {
+        appendNal(sample, {0x67, 0x42, 0xc0, 0x1f}, 8, 0xda);
+        appendNal(sample, {0x68, 0xce, 0x3c, 0x80}, 0, 0);
+        appendNal(sample, {0x65, 0x88}, idrBytes, fill);
+    }else
+    {
+        appendNal(sample, {0x41, 0x9a}, pBytes, fill);
+    }
+    return sample;
+}
+
+int main()
+{
+    TimeShiftBuffer buffer(arenaBytes, maxUnits);
+    // the sample number of every IDR by its time
+    std::map<uint64_t, uint64_t> idrs;
+    std::vector<NALUnit> sent;
+
+    for(unsigned int frame = 0; frame < seconds * fps; frame++)
+    {
+        uint64_t time_us = uint64_t(frame) * 1000000 / fps;
+        bool isIdr = frame % idrInterval == 0;
+        auto sample = accessUnit(frame, isIdr);
+        if(isIdr)
+        {
+            idrs[time_us] = buffer.getHead();
+        }
+        sent.push_back(sample);
+        buffer.append(sample, time_us);
+    }
+
+    uint64_t head = buffer.getHead();
+    uint64_t tail = buffer.getTail();
+    printf("samples %llu to %llu in the buffer\n", (unsigned long long)tail,
+           (unsigned long long)head);
+
+    printf("memory\n");
+    size_t bytes = 0;
+    bool isSame = true;
+    NALUnit sample;
+    uint64_t time_us;
+    for(uint64_t seq = tail; seq < head; seq++)
+    {
+        isSame = isSame && buffer.read(seq, sample, time_us) && sample == sent[seq];
+        bytes += sample.size();
+    }
+    check(tail > 0, "the arena has wrapped");
+    check(head - tail <= maxUnits, "the samples fit into the unit ring");
+    check(bytes <= arenaBytes, "the samples fit into the arena");
+    check(isSame, "every sample in the buffer is unchanged");
+    check(!buffer.read(tail - 1, sample, time_us), "an overwritten sample is not read");
+
+    printf("seek\n");
+    uint64_t liveTime = buffer.getLiveTime();
+    bool isFound = true;
+    bool isInBuffer = true;
+    for(auto& [idrTime, seq]: idrs)
+    {
+        if(seq < tail)
+        {
+            continue;
+        }
+        // the time of the IDR and the time just before the next one
+        for(uint64_t time: {idrTime, idrTime + (idrInterval - 1) * 1000000 / fps})
+        {
+            auto found = buffer.seek(std::min(time, liveTime));
+            isFound = isFound && found && found.value() == seq;
+        }
+    }
+    auto oldest = buffer.seek(0);
+    isInBuffer = oldest && oldest.value() >= tail && buffer.read(oldest.value(), sample, time_us)
+                 && idrs.count(time_us) && idrs[time_us] == oldest.value();
+    check(isFound, "a seek returns the last IDR access unit at the time");
+    check(isInBuffer, "the oldest join point is an IDR in the buffer");
+
+    return checkResult();
+}
@@ -0,0 +1,68 @@
+/**
+ * @file test_topic_match.cpp
+ * @author Weigen Huang (weigen.huang.k7e@fh-zwickau.de)
+ * @brief the topic filters of the QoS configuration are matched like the
+ * subscriptions of a broker (MQTT 3.1.1, 4.7). A trailing "/#" also
+ * matches its parent level.
+ *
+ * build: g++ -std=c++17 -Isrc test/test_topic_match.cpp src/mqtt_connect.cpp
+ *        -lpaho-mqtt3as
+ *
+ * usage: test_topic_match
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mqtt_connect.hpp"
+
+struct Case
+{
+    const char *filter;
+    const char *topic;
+    bool isMatched;
+};
+
+const Case cases[] = {
+    {"a/#", "a", true},
+    {"a/#", "a/", true},
+    {"a/#", "a/b", true},
+    {"a/#", "a/b/c", true},
+    {"a/#", "ab", false},
+    {"a/#", "b", false},
+    {"#", "a/b", true},
+    {"webrtc/roap/#", "webrtc/roap", true},
+    {"webrtc/roap/#", "webrtc/roap/app/camera/viewer", true},
+    {"webrtc/roap/#", "webrtc/notify/camera", false},
+    {"a/+", "a/b", true},
+    {"a/+", "a", false},
+    {"a/+", "a/b/c", false},
+    {"a/+/c", "a/b/c", true},
+    {"a/+/c", "a//c", true},
+    {"+/+", "a/b", true},
+    {"a/b", "a/b", true},
+    {"a/b", "a/b/c", false},
+    {"a/b/c", "a/b", false},
+};
+
+int main()
+{
+    int failed = 0;
+    for(auto& item: cases)
+    {
+        bool isMatched = IsTopicMatched(item.filter, item.topic);
+        bool isPassed = isMatched == item.isMatched;
+        printf("%s %-16s %-32s %s\n", isPassed ? "ok  " : "FAIL", item.filter, item.topic,
+            isMatched ? "matched" : "not matched");
+        failed += !isPassed;
+    }
+    printf("%s: %d of %zu cases failed\n", failed ? "FAILED" : "PASSED", failed,
+        sizeof(cases) / sizeof(cases[0]));
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}